@@ -0,0 +1,314 @@
+/* gendata: write a benchmark dataset, the same bytes every time.
+ *
+ * usage: gendata kind megabytes [seed]
+ *   log      server log lines: time, host, level, request, status,
+ *            size, latency and a message, some of it UTF-8
+ *   rpn      reverse Polish expressions for the calculator, one a line
+ *   columns  tab-separated numbers, integers and decimals
+ *   dates    one date a line in the forms dates.h reads, a tenth of
+ *            them wrong
+ *   points   points ("p x y") and rectangles ("r x1 y1 x2 y2")
+ *   ipranges a JSON list of address ranges laid out like AWS's
+ *            ip-ranges.json: IPv4 prefixes for the first half, then
+ *            IPv6 ones
+ *   flows    flow log lines like a VPC's: account, interface, source
+ *            and destination address (a fifth of them IPv6), ports,
+ *            protocol, packets, bytes, times and action
+ *   blob     random bytes
+ * Text stops at the end of the line (for ipranges, the prefix) that
+ * reaches the size; a blob is exactly the size. The data depends only
+ * on kind, size and seed, so runs on different machines and days
+ * measure the same work.
+ */
+#define _GNU_SOURCE 1
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "benchutil.h"
+#include "blockio.h"
+
+#define BUFSIZE (1 << 20)
+#define LINEMAX 512
+
+static uint64_t seed;
+static size_t size;         /* how many bytes to write */
+
+/* a random number from 0 to n - 1 */
+static unsigned pick(unsigned n)
+{
+    return next_random(&seed) % n;
+}
+
+static const char *const words[] = {
+    "the", "request", "would", "could", "should", "not", "be", "served",
+    "cache", "miss", "retrying", "upstream", "timeout", "connection",
+    "reset", "by", "peer", "user", "session", "expired", "naïve", "Größe",
+    "café", "ok", "slow", "query", "on", "table", "items", "done"
+};
+#define NWORDS (sizeof(words) / sizeof(words[0]))
+
+static const char *const months[] = {
+    "January", "February", "March", "April", "May", "June", "July",
+    "August", "September", "October", "November", "December"
+};
+
+/* the fields of a line are drawn one statement at a time: the order a
+ * function's arguments are worked out in is up to the compiler, and it
+ * must not change the data */
+static int log_line(char *s)
+{
+    static const char *const levels[] = { "INFO", "INFO", "INFO", "WARN", "ERROR", "DEBUG" };
+    static const char *const methods[] = { "GET", "GET", "GET", "POST", "PUT", "DELETE" };
+    static const char *const paths[] = { "/api/items/", "/api/users/", "/static/img/", "/search?q=" };
+    int n, i, nw;
+
+    n = sprintf(s, "2024-%02u", pick(12) + 1);
+    n += sprintf(s + n, "-%02u", pick(28) + 1);
+    n += sprintf(s + n, "T%02u", pick(24));
+    n += sprintf(s + n, ":%02u", pick(60));
+    n += sprintf(s + n, ":%02u", pick(60));
+    n += sprintf(s + n, ".%03uZ", pick(1000));
+    n += sprintf(s + n, " host%02u", pick(32));
+    n += sprintf(s + n, " %s", levels[pick(6)]);
+    n += sprintf(s + n, " %s", methods[pick(6)]);
+    n += sprintf(s + n, " %s", paths[pick(4)]);
+    n += sprintf(s + n, "%u", pick(100000));
+    n += sprintf(s + n, " %u", pick(20) ? 200 : 500 + pick(5));
+    n += sprintf(s + n, " %uB", pick(1 << 20));
+    n += sprintf(s + n, " %u", pick(500));
+    n += sprintf(s + n, ".%ums", pick(10));
+    for (i = 0, nw = pick(8); i < nw; i++)
+        n += sprintf(s + n, " %s", words[pick(NWORDS)]);
+    s[n++] = '\n';
+    return n;
+}
+
+/* an expression of at most depth operators below the top; a '/' only
+ * ever divides by a number that is not 0 */
+static int expr(char *s, int depth)
+{
+    static const char ops[] = "+-*/";
+    int n, op;
+
+    if (depth == 0 || pick(3) == 0) {
+        if (pick(4))
+            return sprintf(s, "%u", pick(1000));
+        n = sprintf(s, "%u", pick(100));
+        return n + sprintf(s + n, ".%u", pick(100));
+    }
+    n = expr(s, depth - 1);
+    s[n++] = ' ';
+    op = ops[pick(4)];
+    n += op == '/' ? sprintf(s + n, "%u", pick(99) + 1) : expr(s + n, depth - 1);
+    s[n++] = ' ';
+    s[n++] = op;
+    return n;
+}
+
+static int rpn_line(char *s)
+{
+    int n = expr(s, 4);
+
+    s[n++] = '\n';
+    return n;
+}
+
+static int columns_line(char *s)
+{
+    int n;
+
+    n = sprintf(s, "%u", pick(100000));
+    n += sprintf(s + n, ".%02u", pick(100));
+    n += sprintf(s + n, "\t%d", (int)pick(2000001) - 1000000);
+    n += sprintf(s + n, "\t%u", pick(1u << 31));
+    n += sprintf(s + n, "\t%d", (int)pick(201) - 100);
+    n += sprintf(s + n, ".%03u\n", pick(1000));
+    return n;
+}
+
+static int dates_line(char *s)
+{
+    unsigned m, d, y, wrong;
+
+    m = pick(12);
+    d = pick(28) + 1;
+    y = 1970 + pick(100);
+    wrong = pick(10) == 0;
+    switch (pick(4)) {
+    case 0:
+        return sprintf(s, "%s %u %u\n", months[m], wrong ? 32 : d, y);
+    case 1:
+        return sprintf(s, "%.3s %u %u\n", wrong ? "Smarch" : months[m], d, y);
+    case 2:
+        return sprintf(s, "%02u/%02u/%u\n", wrong ? 13 : m + 1, d, y);
+    default:
+        return sprintf(s, "%u/%u/%02u\n", m + 1, wrong ? 0 : d, y % 100);
+    }
+}
+
+static int points_line(char *s)
+{
+    int x, y, w, h;
+
+    x = (int)pick(2000001) - 1000000;
+    y = (int)pick(2000001) - 1000000;
+    if (pick(4))
+        return sprintf(s, "p %d %d\n", x, y);
+    w = pick(5000);
+    h = pick(5000);
+    return sprintf(s, "r %d %d %d %d\n", x, y, x + w, y + h);
+}
+
+static const char *const regions[] = {
+    "af-south-1", "ap-east-1", "ap-northeast-1", "ap-northeast-2",
+    "ap-south-1", "ap-southeast-1", "ap-southeast-2", "ca-central-1",
+    "eu-central-1", "eu-north-1", "eu-south-1", "eu-west-1", "eu-west-2",
+    "eu-west-3", "me-south-1", "sa-east-1", "us-east-1", "us-east-2",
+    "us-west-1", "us-west-2", "GLOBAL"
+};
+#define NREGIONS (sizeof(regions) / sizeof(regions[0]))
+
+/* AMAZON is listed again so that about half the prefixes are its own */
+static const char *const services[] = {
+    "AMAZON", "AMAZON", "AMAZON", "AMAZON", "AMAZON", "AMAZON", "AMAZON",
+    "AMAZON", "EC2", "EC2", "S3", "CLOUDFRONT", "ROUTE53",
+    "ROUTE53_HEALTHCHECKS", "API_GATEWAY", "DYNAMODB", "GLOBALACCELERATOR",
+    "AMAZON_CONNECT", "CLOUD9", "CODEBUILD", "EC2_INSTANCE_CONNECT",
+    "WORKSPACES_GATEWAYS"
+};
+#define NSERVICES (sizeof(services) / sizeof(services[0]))
+
+/* the first 16 bits of the IPv6 addresses */
+static const unsigned v6top[] = { 0x2600, 0x2406, 0x2a05, 0x2620, 0x2a01 };
+
+/* one prefix, after the start of the file or the list it opens */
+static int ipranges_line(char *s)
+{
+    static int list = 0;        /* 4 or 6 once a list is open */
+    static size_t written = 0;
+    const char *region;
+    uint32_t a;
+    unsigned len, g[4], i;
+    int n = 0;
+
+    if (list == 0) {
+        n = sprintf(s, "{\n  \"syncToken\": \"1700000000\",\n"
+                       "  \"createDate\": \"2024-01-01-00-00-00\",\n"
+                       "  \"prefixes\": [\n");
+        list = 4;
+    } else if (list == 4 && written >= size / 2) {
+        n = sprintf(s, "\n  ],\n  \"ipv6_prefixes\": [\n");
+        list = 6;
+    } else
+        n = sprintf(s, ",\n");
+    if (list == 4) {
+        len = 12 + pick(21);
+        a = next_random(&seed) >> 32;
+        a &= len < 32 ? ~(0xFFFFFFFFu >> len) : 0xFFFFFFFFu;
+        n += sprintf(s + n, "    {\n      \"ip_prefix\": \"%u.%u.%u.%u/%u\",\n",
+                     a >> 24, a >> 16 & 0xFF, a >> 8 & 0xFF, a & 0xFF, len);
+    } else {
+        len = 24 + pick(41);
+        g[0] = v6top[pick(5)];
+        for (i = 1; i < 4; i++)
+            g[i] = pick(0x10000);
+        for (i = 0; i < 4; i++)
+            if (len < 16 * (i + 1))
+                g[i] &= len <= 16 * i ? 0 : 0xFFFF & ~(0xFFFFu >> (len - 16 * i));
+        n += sprintf(s + n, "    {\n      \"ipv6_prefix\": \"%x:%x:%x:%x::/%u\",\n",
+                     g[0], g[1], g[2], g[3], len);
+    }
+    region = regions[pick(NREGIONS)];
+    n += sprintf(s + n, "      \"region\": \"%s\",\n", region);
+    n += sprintf(s + n, "      \"service\": \"%s\",\n", services[pick(NSERVICES)]);
+    n += sprintf(s + n, "      \"network_border_group\": \"%s\"\n    }", region);
+    written += n;
+    return n;
+}
+
+/* one flow, its source anywhere and its destination in a private range */
+static int flows_line(char *s)
+{
+    uint32_t a;
+    unsigned i, start;
+    int n;
+
+    n = sprintf(s, "2 123456789012 eni-%08x", pick(1 << 30));
+    if (pick(5) > 0) {
+        a = next_random(&seed) >> 32;
+        n += sprintf(s + n, " %u.%u.%u.%u", a >> 24, a >> 16 & 0xFF, a >> 8 & 0xFF, a & 0xFF);
+        a = pick(1 << 16);
+        n += sprintf(s + n, " 10.0.%u.%u", a >> 8, a & 0xFF);
+    } else {
+        n += sprintf(s + n, " %x", v6top[pick(5)]);
+        for (i = 1; i < 8; i++)
+            n += sprintf(s + n, ":%x", pick(0x10000));
+        n += sprintf(s + n, " fd00::%x", pick(0x10000));
+    }
+    n += sprintf(s + n, " %u", pick(65536));
+    n += sprintf(s + n, " %u", pick(4) ? 443 : 80);
+    n += sprintf(s + n, " %u", pick(8) ? 6 : 17);
+    n += sprintf(s + n, " %u", 1 + pick(100));
+    n += sprintf(s + n, " %u", 40 + pick(100000));
+    start = 1700000000 + pick(86400);
+    n += sprintf(s + n, " %u %u", start, start + 60);
+    n += sprintf(s + n, " %s OK\n", pick(10) ? "ACCEPT" : "REJECT");
+    return n;
+}
+
+static const struct {
+    const char *name;
+    int (*line)(char *s);   /* NULL for binary */
+    const char *tail;       /* written after the last line, if not NULL */
+} kinds[] = {
+    { "log", log_line, NULL },
+    { "rpn", rpn_line, NULL },
+    { "columns", columns_line, NULL },
+    { "dates", dates_line, NULL },
+    { "points", points_line, NULL },
+    { "ipranges", ipranges_line, "\n  ]\n}\n" },
+    { "flows", flows_line, NULL },
+    { "blob", NULL, NULL },
+};
+#define NKINDS (sizeof(kinds) / sizeof(kinds[0]))
+
+int main(int argc, char *argv[])
+{
+    static char buf[BUFSIZE + LINEMAX];
+    uint64_t r;
+    size_t done = 0, n = 0, k;
+    int i;
+    char *end;
+
+    for (k = 0; argc >= 3 && k < NKINDS; k++)
+        if (strcmp(argv[1], kinds[k].name) == 0)
+            break;
+    size = argc >= 3 ? strtoul(argv[2], &end, 10) * 1000000 : 0;
+    seed = argc >= 4 ? strtoull(argv[3], NULL, 10) : 1;
+    if (argc < 3 || argc > 4 || k == NKINDS || *end != '\0' || size == 0 || seed == 0) {
+        fprintf(stderr, "Usage: gendata log|rpn|columns|dates|points|ipranges|flows|blob megabytes [seed]\n");
+        return 1;
+    }
+    while (done < size) {
+        if (kinds[k].line != NULL)
+            n += kinds[k].line(buf + n);
+        else
+            for ( ; n < BUFSIZE && done + n < size; n += 8)
+                for (r = next_random(&seed), i = 0; i < 8; i++)
+                    buf[n + i] = r >> 8 * i;  /* the same on any byte order */
+        if (n >= BUFSIZE || done + n >= size) {
+            if (kinds[k].line == NULL && done + n > size)
+                n = size - done;
+            if (kinds[k].tail != NULL && done + n >= size)
+                n += sprintf(buf + n, "%s", kinds[k].tail);
+            if (write_all(1, buf, n) < 0) {
+                perror("gendata");
+                return 1;
+            }
+            done += n;
+            n = 0;
+        }
+    }
+    return 0;
+}
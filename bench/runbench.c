@@ -0,0 +1,239 @@
+/* runbench: run a command over and over and report how long it takes,
+ * with hardware counters, as one line of JSON.
+ *
+ * usage: runbench [-n name] [-t tag] [-w warmup] [-r reps] [-i infile]
+ *                 [-o outfile] command [arg ...]
+ *   -n  what to call the result (default: the command)
+ *   -t  a label stored with it, such as the commit measured
+ *   -w  runs first that are not counted, to warm the caches (default 2)
+ *   -r  runs that are counted (default 10)
+ *   -i  the command's standard input, opened afresh for each run
+ *       (default /dev/null)
+ *   -o  append the result to outfile (default: standard output)
+ * The command's output goes to /dev/null; only its time is of interest.
+ * It fails the benchmark if it cannot be run or is killed by a signal,
+ * but not for a non-zero exit status, which grep and find use to say
+ * how many lines they found.
+ *
+ * For each of time, cycles, instructions, cache misses and branch
+ * misses the result has the mean over the runs, the standard deviation,
+ * a 95% confidence interval for the mean (mean +- ci95, from Student's
+ * t), and the minimum and median. The counters are read through
+ * perf_event_open (see lib/perfctr.h) and count the command and every
+ * thread and child it starts; where they cannot be had they are null.
+ * A summary goes to standard error.
+ */
+#define _GNU_SOURCE 1
+#include <fcntl.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+#include "benchutil.h"
+#include "perfctr.h"
+
+#define MAXREPS 1000
+#define NMEASURES (1 + PC_COUNT)    /* time, then the counters */
+
+/* run argv once with its input from infile; set m[0] to the seconds it
+ * took and m[1...] to its counters. Return 0, or -1 if it could not be
+ * run or died of a signal. */
+static int run_once(char *argv[], const char *infile, double m[NMEASURES])
+{
+    struct perfctr pc;
+    long long v[PC_COUNT];
+    int go[2], status, fd, i;
+    double t;
+    pid_t pid;
+    char c;
+
+    if (pipe(go) < 0)
+        return -1;
+    t = now();
+    if ((pid = fork()) < 0)
+        return -1;
+    if (pid == 0) {
+        /* wait for the counters to be set up, so they see the exec */
+        close(go[1]);
+        if (read(go[0], &c, 1) != 0)
+            _exit(127);
+        if ((fd = open(infile, O_RDONLY)) < 0 || dup2(fd, 0) < 0)
+            _exit(127);
+        if ((fd = open("/dev/null", O_WRONLY)) < 0 || dup2(fd, 1) < 0 || dup2(fd, 2) < 0)
+            _exit(127);
+        execvp(argv[0], argv);
+        _exit(127);
+    }
+    close(go[0]);
+    perfctr_open(&pc, pid, 1);
+    close(go[1]);
+    if (waitpid(pid, &status, 0) < 0)
+        status = -1;
+    t = now() - t;
+    perfctr_read(&pc, v);
+    perfctr_close(&pc);
+    if (status == -1 || WIFSIGNALED(status) || (WIFEXITED(status) && WEXITSTATUS(status) == 127))
+        return -1;
+    m[0] = t;
+    for (i = 0; i < PC_COUNT; i++)
+        m[i + 1] = v[i];
+    return 0;
+}
+
+/* Student's t for a two-sided 95% interval with df degrees of freedom */
+static double student_t(int df)
+{
+    static const double t[] = {
+        0, 12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262,
+        2.228, 2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093,
+        2.086, 2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045,
+        2.042
+    };
+
+    if (df < (int)(sizeof(t) / sizeof(t[0])))
+        return t[df];
+    return df < 60 ? 2.000 : df < 120 ? 1.980 : 1.960;
+}
+
+static int compare(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+
+    return (x > y) - (x < y);
+}
+
+/* write s as a JSON string */
+static void json_str(FILE *fp, const char *s)
+{
+    putc('"', fp);
+    for ( ; *s != '\0'; s++)
+        if (*s == '"' || *s == '\\')
+            fprintf(fp, "\\%c", *s);
+        else if ((unsigned char)*s < 0x20)
+            fprintf(fp, "\\u%04x", *s);
+        else
+            putc(*s, fp);
+    putc('"', fp);
+}
+
+/* write the statistics of the n values at x (which get sorted) as a
+ * JSON object, or null if any of them is missing; set s[0] to the mean
+ * and s[1] to ci95, or both to -1 for null */
+static void json_stats(FILE *fp, double *x, int n, double s[2])
+{
+    double mean = 0, var = 0, ci;
+    int i;
+
+    s[0] = s[1] = -1;
+    for (i = 0; i < n; i++) {
+        if (x[i] < 0) {
+            fprintf(fp, "null");
+            return;
+        }
+        mean += x[i];
+    }
+    mean /= n;
+    for (i = 0; i < n; i++)
+        var += (x[i] - mean) * (x[i] - mean);
+    var = n > 1 ? var / (n - 1) : 0;
+    ci = n > 1 ? student_t(n - 1) * sqrt(var / n) : 0;
+    qsort(x, n, sizeof(x[0]), compare);
+    fprintf(fp, "{\"mean\": %.9g, \"stddev\": %.9g, \"ci95\": %.9g, \"min\": %.9g, \"median\": %.9g}",
+            mean, sqrt(var), ci, x[0], n % 2 ? x[n / 2] : (x[n / 2 - 1] + x[n / 2]) / 2);
+    s[0] = mean;
+    s[1] = ci;
+}
+
+int main(int argc, char *argv[])
+{
+    static double m[NMEASURES][MAXREPS];
+    const char *name = NULL, *tag = NULL, *infile = "/dev/null", *outfile = NULL;
+    double one[NMEASURES], stats[NMEASURES][2];
+    int warmup = 2, reps = 10, c, i, j;
+    struct stat st;
+    FILE *out = stdout;
+
+    while ((c = getopt(argc, argv, "+n:t:w:r:i:o:")) != -1)
+        switch (c) {
+        case 'n':
+            name = optarg;
+            break;
+        case 't':
+            tag = optarg;
+            break;
+        case 'w':
+            warmup = atoi(optarg);
+            break;
+        case 'r':
+            reps = atoi(optarg);
+            break;
+        case 'i':
+            infile = optarg;
+            break;
+        case 'o':
+            outfile = optarg;
+            break;
+        default:
+            argc = 0;
+        }
+    if (optind >= argc || warmup < 0 || reps < 1 || reps > MAXREPS) {
+        fprintf(stderr, "Usage: runbench [-n name] [-t tag] [-w warmup] [-r reps] [-i infile]\n"
+                        "                [-o outfile] command [arg ...]\n");
+        return 1;
+    }
+    argv += optind;
+    if (name == NULL)
+        name = argv[0];
+
+    for (i = -warmup; i < reps; i++) {
+        if (run_once(argv, infile, one) < 0) {
+            fprintf(stderr, "runbench: %s: could not run %s\n", name, argv[0]);
+            return 1;
+        }
+        for (j = 0; i >= 0 && j < NMEASURES; j++)
+            m[j][i] = one[j];
+    }
+
+    if (outfile != NULL && (out = fopen(outfile, "a")) == NULL) {
+        perror(outfile);
+        return 1;
+    }
+    fprintf(out, "{\"name\": ");
+    json_str(out, name);
+    fprintf(out, ", \"tag\": ");
+    if (tag != NULL && *tag != '\0')
+        json_str(out, tag);
+    else
+        fprintf(out, "null");
+    fprintf(out, ", \"command\": [");
+    for (i = 0; argv[i] != NULL; i++) {
+        fputs(i > 0 ? ", " : "", out);
+        json_str(out, argv[i]);
+    }
+    fprintf(out, "], \"input\": ");
+    json_str(out, infile);
+    fprintf(out, ", \"input_bytes\": %lld, \"time\": %lld, \"warmup\": %d, \"reps\": %d, \"seconds\": ",
+            stat(infile, &st) == 0 ? (long long)st.st_size : 0LL, (long long)time(NULL), warmup, reps);
+    json_stats(out, m[0], reps, stats[0]);
+    for (j = 1; j < NMEASURES; j++) {
+        fprintf(out, ", \"%s\": ", perfctr_names[j - 1]);
+        json_stats(out, m[j], reps, stats[j]);
+    }
+    fprintf(out, "}\n");
+    if (out != stdout && fclose(out) != 0) {
+        perror(outfile);
+        return 1;
+    }
+
+    fprintf(stderr, "%-28s %10.3f ms +- %.3f", name, stats[0][0] * 1e3, stats[0][1] * 1e3);
+    if (stats[1 + PC_CYCLES][0] > 0 && stats[1 + PC_INSTRUCTIONS][0] >= 0)
+        fprintf(stderr, "  %5.2f IPC", stats[1 + PC_INSTRUCTIONS][0] / stats[1 + PC_CYCLES][0]);
+    if (stats[1 + PC_CACHE_MISSES][0] >= 0)
+        fprintf(stderr, "  %.3g cache misses", stats[1 + PC_CACHE_MISSES][0]);
+    putc('\n', stderr);
+    return 0;
+}
@@ -1,9 +1,11 @@
 #include <stdio.h>
+#include "bounds.h"
+#include "strview.h"
 
 #define MAXLINE 1000 /* maximum input line length */
 
-int csc250_getline(char line[], int maxline);
-void copy(char to[], char from[]);
+int csc250_getline(struct charspan line, int maxline);
+void copy(struct charspan to, struct strview from);
 
 /* print the longest input line */
 int main(void)
@@ -16,7 +18,10 @@ int main(void)
     max = 0;
     /* a security issue?
      * what happens if a line is bigger than MAXLINE? */
-    while ((len = csc250_getline(line, MAXLINE)) > 0)
+    /* line and longest go in as spans, which carry their real size;
+     * make BOUNDS=1 checks, once a call, that the loops inside
+     * csc250_getline and copy stay within them */
+    while ((len = csc250_getline(BOUNDS_SPAN(line), MAXLINE)) > 0)
         if (len > max) {
             max = len;
             /* function call is still pass-by-value, but...
@@ -27,22 +32,25 @@ int main(void)
              * 
              * Hmmm...have you seen this in Java? 
              */
-            copy(longest, line);
+            /* csc250_getline already told us how long line is,
+             * so copy need not look for its '\0' again */
+            copy(BOUNDS_SPAN(longest), sv_make(line, len));
         }
     if (max > 0) /* there was a line */
-        printf("%s", longest);
+        fwrite(longest, 1, max, stdout);
     return 0;
 }
 
 /* read a line into s, return length */
-int csc250_getline(char s[],int lim)
+int csc250_getline(struct charspan s, int lim)
 {
     int c, i;
     
+    BOUNDS_RANGE(s, 0, lim);    /* the lim bytes below fit in s */
     for (i=0; i < lim-1 && (c=getchar())!=EOF && c!='\n'; ++i)
-        s[i] = c;
+        s.p[i] = c;
     if (c == '\n') {
-        s[i] = c;
+        s.p[i] = c;
         ++i;
     }
     /* we put the character '\0' (the null character, whose value is zero) 
@@ -50,16 +58,18 @@ int csc250_getline(char s[],int lim)
      * In a C program, a string is stored as an array of characters
      * terminated with a '\0' to mark the end. 
      * See discussion in the Strings section. */
-    s[i] = '\0';
+    s.p[i] = '\0';
     return i;
 }
 
-/* copy 'from' into 'to'; assume to is big enough */
-void copy(char to[], char from[])
+/* copy 'from' into 'to' and end it with '\0';
+ * make BOUNDS=1 checks that to is big enough */
+void copy(struct charspan to, struct strview from)
 {
-    int i;
+    size_t i;
 
-    i = 0;
-    while ((to[i] = from[i]) != '\0')
-        ++i;
+    BOUNDS_RANGE(to, 0, from.len + 1);
+    for (i = 0; i < from.len; ++i)
+        to.p[i] = from.ptr[i];
+    to.p[i] = '\0';
 }
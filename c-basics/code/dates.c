@@ -0,0 +1,157 @@
+#include <stdint.h>
+#include <string.h>
+#include "dates.h"
+
+/* Every month name, full or cut to three letters, lands in its own slot
+ * of a 64-entry table when hashed by its first three letters (lower
+ * case) and its length; the multipliers were found by trying them all.
+ * The table is filled in at compile time by designated initializers, so
+ * if two names ever shared a slot, -Wextra's -Woverride-init would say so.
+ */
+#define MHASH(a, b, c, len) (((a) + (b) + 6 * (c) + (len)) % 64)
+#define MONTH(name, a, b, c, m) \
+    [MHASH(a, b, c, sizeof(name) - 1)] = { name, sizeof(name) - 1, m }
+
+struct monthname {
+    char name[10];
+    unsigned char len;      /* 0 for an empty slot */
+    unsigned char month;
+};
+
+static const struct monthname months[64] = {
+    MONTH("january", 'j', 'a', 'n', 1), MONTH("jan", 'j', 'a', 'n', 1),
+    MONTH("february", 'f', 'e', 'b', 2), MONTH("feb", 'f', 'e', 'b', 2),
+    MONTH("march", 'm', 'a', 'r', 3), MONTH("mar", 'm', 'a', 'r', 3),
+    MONTH("april", 'a', 'p', 'r', 4), MONTH("apr", 'a', 'p', 'r', 4),
+    MONTH("may", 'm', 'a', 'y', 5),
+    MONTH("june", 'j', 'u', 'n', 6), MONTH("jun", 'j', 'u', 'n', 6),
+    MONTH("july", 'j', 'u', 'l', 7), MONTH("jul", 'j', 'u', 'l', 7),
+    MONTH("august", 'a', 'u', 'g', 8), MONTH("aug", 'a', 'u', 'g', 8),
+    MONTH("september", 's', 'e', 'p', 9), MONTH("sep", 's', 'e', 'p', 9),
+    MONTH("october", 'o', 'c', 't', 10), MONTH("oct", 'o', 'c', 't', 10),
+    MONTH("november", 'n', 'o', 'v', 11), MONTH("nov", 'n', 'o', 'v', 11),
+    MONTH("december", 'd', 'e', 'c', 12), MONTH("dec", 'd', 'e', 'c', 12)
+};
+
+static int blank(unsigned char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static int digit(unsigned char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+/* the month named by the len letters at p, in any case, or 0 */
+static int month_number(const unsigned char *p, size_t len)
+{
+    const struct monthname *m;
+    size_t i;
+
+    if (len < 3 || len > 9)
+        return 0;
+    /* c | 0x20 lower-cases a letter; anything else that it turns into
+     * a letter fails the comparison below anyway */
+    m = &months[MHASH(p[0] | 0x20, p[1] | 0x20, p[2] | 0x20, len)];
+    if (m->len != len)
+        return 0;
+    for (i = 0; i < len; i++)
+        if ((p[i] | 0x20) != m->name[i])
+            return 0;
+    return m->month;
+}
+
+/* the number in the 4 digits at p, or -1 if they are not all digits.
+ * The digits are loaded as one word, first digit in the low byte, and
+ * checked all at once: a byte is a digit if its high half is 3 and
+ * stays 3 when 6 is added. Then neighbouring digits are combined into
+ * pairs (10 * d0 + d1) in one multiply, and the pairs into the number
+ * in another.
+ */
+static int digits4(const unsigned char *p)
+{
+    uint32_t v;
+
+    memcpy(&v, p, 4);
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    v = __builtin_bswap32(v);
+#endif
+    if ((v & 0xF0F0F0F0) != 0x30303030
+        || ((v + 0x06060606) & 0xF0F0F0F0) != 0x30303030)
+        return -1;
+    v &= 0x0F0F0F0F;
+    v = (v * 10 + (v >> 8)) & 0x00FF00FF;
+    return (v * 100 + (v >> 16)) & 0xFFFF;
+}
+
+/* read a number of 1 or 2 digits at p[*i] into *v and move *i past it;
+ * return 0 if there is no such number */
+static int digits12(const unsigned char *p, size_t n, size_t *i, int *v)
+{
+    if (*i >= n || !digit(p[*i]))
+        return 0;
+    *v = p[(*i)++] - '0';
+    if (*i < n && digit(p[*i]))
+        *v = 10 * *v + p[(*i)++] - '0';
+    return *i >= n || !digit(p[*i]);
+}
+
+/* return 1 if year, month and day make a date of the Gregorian
+ * calendar in years 1 to 9999, 0 if not */
+int date_valid(int year, int month, int day)
+{
+    static const unsigned char mdays[13] = {
+        0, 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31
+    };
+    int leap = year % 4 == 0 && (year % 100 != 0 || year % 400 == 0);
+
+    return year >= 1 && year <= 9999 && month >= 1 && month <= 12
+           && day >= 1 && day <= mdays[month] + (month == 2 && leap);
+}
+
+/* return 1 and set *d if the n bytes at s are one date, in either of
+ * the forms in dates.h with white space around it allowed; return 0 if
+ * they are anything else */
+int date_parse(const char *s, size_t n, struct date *d)
+{
+    const unsigned char *p = (const unsigned char *)s;
+    size_t i = 0, start;
+    int month, day, year;
+
+    while (n > 0 && blank(p[n - 1]))
+        n--;
+    while (i < n && blank(p[i]))
+        i++;
+    if (i < n && digit(p[i])) {
+        if (!digits12(p, n, &i, &month) || i >= n || p[i++] != '/'
+            || !digits12(p, n, &i, &day) || i >= n || p[i++] != '/')
+            return 0;
+        if (n - i == 4)
+            year = digits4(p + i);
+        else if (n - i == 2 && digits12(p, n, &i, &year))
+            year += year < 69 ? 2000 : 1900;
+        else
+            return 0;
+    } else {
+        for (start = i; i < n && !blank(p[i]); i++)
+            ;
+        if ((month = month_number(p + start, i - start)) == 0)
+            return 0;
+        while (i < n && blank(p[i]))
+            i++;
+        if (!digits12(p, n, &i, &day) || i >= n || !blank(p[i]))
+            return 0;
+        while (i < n && blank(p[i]))
+            i++;
+        if (n - i != 4)
+            return 0;
+        year = digits4(p + i);
+    }
+    if (!date_valid(year, month, day))
+        return 0;
+    d->year = year;
+    d->month = month;
+    d->day = day;
+    return 1;
+}
@@ -0,0 +1,29 @@
+/* recognize the two kinds of date scans.c reads, without sscanf:
+ *
+ *     September 23 2023    a month name (or its first three letters,
+ *                          in any case), the day, the 4-digit year
+ *     09/23/2023, 9/23/23  month/day/year, with a 2-digit year meaning
+ *                          1969-2068 as in strptime's %y
+ *
+ * scans.c tries sscanf("%s %d %d") and then sscanf("%d/%d/%d") on every
+ * line, which parses the format strings each time, accepts any word as
+ * a month, and lets through February 31. date_parse reads a line once,
+ * finds a month name with one table lookup, turns four digits into a
+ * number in a few operations on one 32-bit word, and checks the date is
+ * on the calendar.
+ */
+#ifndef DATES_H
+#define DATES_H
+
+#include <stddef.h>
+
+struct date {
+    int year;
+    int month;              /* 1 to 12 */
+    int day;
+};
+
+int date_valid(int year, int month, int day);
+int date_parse(const char *s, size_t n, struct date *d);
+
+#endif
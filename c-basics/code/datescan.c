@@ -0,0 +1,158 @@
+/* datescan: check that every input line is a date, as scans.c does,
+ * fast enough for logs of billions of lines.
+ *
+ * usage: datescan [-x] [-t threads] [file]
+ *   -x  write each date as year-month-day (2023-09-23), one a line,
+ *       leaving out lines that are not dates
+ * Without -x, datescan counts the lines that are dates and those that
+ * are not, and gives the number of the first line that is not.
+ * The dates it knows are described in dates.h.
+ *
+ * The input is mapped and cut into stretches that begin at the start of
+ * a line, one per thread. With -x each thread writes its dates into its
+ * own buffer, and the buffers are written out in order.
+ */
+#define _GNU_SOURCE 1
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "blockio.h"
+#include "dates.h"
+#include "parallel.h"
+
+#define ISOLEN 11               /* "2023-09-23\n" */
+
+/* one thread's stretch of the input and what it found */
+struct datejob {
+    const unsigned char *base;
+    size_t start, end;
+    int extract;
+    size_t valid, invalid;
+    size_t firstbad;        /* line number within the stretch, from 1 */
+    size_t lines;
+    char *out;              /* with -x, the dates */
+    size_t outlen;
+};
+
+static void *scan_job(void *arg);
+
+int main(int argc, char *argv[])
+{
+    struct input in;
+    struct datejob job[MAXTHREADS];
+    size_t share, valid = 0, invalid = 0, lines = 0, firstbad = 0;
+    int c, fd = 0, nthreads, njobs, i, extract = 0, rc = 0;
+
+    nthreads = cpu_count();
+    while ((c = getopt(argc, argv, "xt:")) != -1)
+        switch (c) {
+        case 'x':
+            extract = 1;
+            break;
+        case 't':
+            nthreads = atoi(optarg);
+            break;
+        default:
+            nthreads = 0;
+            break;
+        }
+    if (nthreads < 1 || argc - optind > 1) {
+        fprintf(stderr, "Usage: datescan [-x] [-t threads] [file]\n");
+        return 1;
+    }
+    if (optind < argc && (fd = open(argv[optind], O_RDONLY)) < 0) {
+        perror(argv[optind]);
+        return 1;
+    }
+    if (map_input(fd, &in) < 0) {
+        perror("datescan");
+        return 1;
+    }
+
+    njobs = job_count(in.n, PARALLEL_MINSHARE, nthreads);
+    share = in.n / njobs;
+    for (i = 0; i < njobs; i++) {
+        job[i].base = in.p;
+        job[i].start = i == 0 ? 0 : job[i - 1].end;
+        job[i].end = i < njobs - 1 ? next_line(in.p, in.n, (i + 1) * share) : in.n;
+        if (job[i].end < job[i].start)
+            job[i].end = job[i].start;
+        job[i].extract = extract;
+        job[i].out = NULL;
+        /* the shortest date line, "1/1/23\n", is 7 bytes and comes out
+         * as ISOLEN */
+        if (extract && (job[i].out = malloc((job[i].end - job[i].start) / 7 * ISOLEN
+                                            + ISOLEN)) == NULL) {
+            perror("datescan");
+            return 1;
+        }
+    }
+    run_parallel(scan_job, job, sizeof(job[0]), njobs);
+
+    for (i = 0; i < njobs; i++) {
+        if (firstbad == 0 && job[i].firstbad != 0)
+            firstbad = lines + job[i].firstbad;
+        lines += job[i].lines;
+        valid += job[i].valid;
+        invalid += job[i].invalid;
+        if (extract && write_all(1, job[i].out, job[i].outlen) < 0) {
+            perror("datescan");
+            rc = 1;
+            break;
+        }
+        free(job[i].out);
+    }
+    if (!extract) {
+        printf("%zu dates, %zu other lines\n", valid, invalid);
+        if (firstbad != 0)
+            printf("first other line: %zu\n", firstbad);
+    }
+    unmap_input(&in);
+    return rc;
+}
+
+/* write d as "yyyy-mm-dd\n" at p */
+static void iso(char *p, struct date d)
+{
+    p[0] = '0' + d.year / 1000;
+    p[1] = '0' + d.year / 100 % 10;
+    p[2] = '0' + d.year / 10 % 10;
+    p[3] = '0' + d.year % 10;
+    p[4] = '-';
+    p[5] = '0' + d.month / 10;
+    p[6] = '0' + d.month % 10;
+    p[7] = '-';
+    p[8] = '0' + d.day / 10;
+    p[9] = '0' + d.day % 10;
+    p[10] = '\n';
+}
+
+/* check every line of one stretch of the input */
+static void *scan_job(void *arg)
+{
+    struct datejob *job = arg;
+    const unsigned char *nl;
+    struct date d;
+    size_t pos, len;
+
+    job->valid = job->invalid = job->firstbad = job->lines = job->outlen = 0;
+    for (pos = job->start; pos < job->end; pos += len + 1) {
+        nl = memchr(job->base + pos, '\n', job->end - pos);
+        len = (nl != NULL ? (size_t)(nl - job->base) : job->end) - pos;
+        job->lines++;
+        if (date_parse((const char *)job->base + pos, len, &d)) {
+            job->valid++;
+            if (job->extract) {
+                iso(job->out + job->outlen, d);
+                job->outlen += ISOLEN;
+            }
+        } else {
+            job->invalid++;
+            if (job->firstbad == 0)
+                job->firstbad = job->lines;
+        }
+    }
+    return NULL;
+}
@@ -55,7 +55,7 @@ int main(void)
             copy();
         }
     if (max > 0)        /* there was a line */
-        printf("%s", longest);
+        fwrite(longest, 1, max, stdout);    /* max is its length: no need to look for '\0' */
     return 0;
 }
 
@@ -92,12 +92,15 @@ int csc250_getline(void)
     return i;
 }
 
-/* copy a line of text considered to be the longest to a separate storage space */
+/* copy a line of text considered to be the longest to a separate storage space;
+ * main has just set max to its length, so the loop knows how far to go
+ * instead of looking for the '\0' */
 void copy(void)
 {
     int i;
+    extern int max;
     extern char line[], longest[];
-    i = 0;
-    while ((longest[i] = line[i]) != '\0')
-        ++i;
+    for (i = 0; i < max; ++i)
+        longest[i] = line[i];
+    longest[i] = '\0';
 }
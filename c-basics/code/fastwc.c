@@ -0,0 +1,275 @@
+/* fastwc: count lines, words and bytes, like wc,
+ * grown from chars.c's one-getchar-per-byte loop.
+ *
+ * usage: fastwc [-u|--utf8] [-t threads] [file ...]
+ *   -u  treat the input as UTF-8: also count characters, and reject
+ *       input that is not valid UTF-8
+ * Prints lines, words, (characters,) and bytes for each file,
+ * and a total for several.
+ * A word is any run of characters that are not white space, as in K&R's
+ * word count; GNU wc also skips runs of unprintable bytes, so the two
+ * can disagree on binary files.
+ *
+ * The inner loop looks at 64 bytes at a time. Two AVX2 compares turn them
+ * into 64-bit masks: one bit per byte that is '\n', and one per byte that is
+ * white space. Counting lines is then a popcount of the first mask.
+ * A word starts wherever a non-space byte follows a space, so shifting the
+ * space mask left by one (to line each byte up with the byte before it) and
+ * ANDing with the non-space mask leaves exactly one bit per word start.
+ */
+#define _GNU_SOURCE 1
+#include <fcntl.h>
+#include <getopt.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "blockio.h"
+#include "parallel.h"
+#include "utf8.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+
+struct counts {
+    uint64_t lines;
+    uint64_t words;
+    uint64_t chars;         /* UTF-8 characters, with -u */
+    uint64_t bytes;
+};
+
+/* one thread's share of a block */
+struct wcjob {
+    const unsigned char *p;
+    size_t n;
+    int prevspace;          /* is the byte before p white space? */
+    size_t check, ncheck;   /* the part of p to validate as UTF-8, with -u */
+    int utf8, valid;
+    struct counts c;
+};
+
+/* the state kept across the blocks of one file */
+struct wc {
+    int nthreads;
+    int prevspace;          /* is the last byte seen white space? */
+    int utf8;
+    struct utf8_stream u8;  /* blocks can split a character, with -u */
+    struct counts c;
+};
+
+static int count_block(const unsigned char *p, size_t n, void *arg);
+static void *count_job(void *arg);
+static void count(const unsigned char *p, size_t n, int prevspace,
+                  struct counts *c);
+static void print_counts(const struct counts *c, int utf8, const char *name);
+
+/* white space as wc sees it: ' ', '\t', '\n', '\v', '\f', '\r' */
+static int isspace_byte(unsigned char c)
+{
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+int main(int argc, char *argv[])
+{
+    static const struct option longopts[] = {
+        { "utf8", no_argument, NULL, 'u' },
+        { NULL, 0, NULL, 0 }
+    };
+    struct wc w;
+    struct counts total;
+    int c, fd, nthreads, utf8 = 0, rc = 0;
+
+    nthreads = cpu_count();
+    while ((c = getopt_long(argc, argv, "t:u", longopts, NULL)) != -1)
+        switch (c) {
+        case 'u':
+            utf8 = 1;
+            break;
+        case 't':
+            nthreads = atoi(optarg);
+            break;
+        default:
+            nthreads = 0;
+            break;
+        }
+    if (nthreads < 1) {
+        fprintf(stderr, "Usage: fastwc [-u|--utf8] [-t threads] [file ...]\n");
+        return 1;
+    }
+
+    memset(&total, 0, sizeof(total));
+    /* with no files, go round once for standard input */
+    for (c = optind; c < argc || c == optind; c++) {
+        memset(&w, 0, sizeof(w));
+        w.nthreads = nthreads;
+        w.prevspace = 1;    /* the input starts as if after a space */
+        w.utf8 = utf8;
+        utf8_stream_init(&w.u8);
+        fd = c < argc ? open(argv[c], O_RDONLY) : 0;
+        if (fd < 0 || read_blocks(fd, BLOCKSIZE, count_block, &w) < 0) {
+            perror(c < argc ? argv[c] : "fastwc");
+            rc = 1;
+        } else if (utf8 && !utf8_stream_finish(&w.u8)) {
+            fprintf(stderr, "fastwc: %s: invalid UTF-8\n",
+                    c < argc ? argv[c] : "standard input");
+            rc = 1;
+        } else
+            print_counts(&w.c, utf8, c < argc ? argv[c] : NULL);
+        if (fd > 0)
+            close(fd);
+        total.lines += w.c.lines;
+        total.words += w.c.words;
+        total.chars += w.c.chars;
+        total.bytes += w.c.bytes;
+    }
+    if (argc - optind > 1)
+        print_counts(&total, utf8, "total");
+    return rc;
+}
+
+/* count the n bytes at p into the counts in arg, splitting them
+ * across threads; always returns 0 */
+static int count_block(const unsigned char *p, size_t n, void *arg)
+{
+    struct wc *w = arg;
+    struct wcjob job[MAXTHREADS];
+    size_t share, head = 0, end = n, start, stop, lo, hi;
+    int i, njobs;
+
+    /* the first bytes may finish a character the last block started,
+     * and the last may start one the next block finishes; the stream
+     * checks those, and the threads check everything in between */
+    if (w->utf8) {
+        head = utf8_stream_head(&w->u8, p, n);
+        end = head + utf8_stream_tail(&w->u8, p + head, n - head);
+    }
+    njobs = job_count(n, PARALLEL_MINSHARE, w->nthreads);
+    share = n / njobs;
+    for (i = 0, start = 0; i < njobs; i++, start = stop) {
+        /* cut where no character is split, so each share can be
+         * validated on its own */
+        stop = i < njobs - 1 ? utf8_boundary(p, n, (i + 1) * share) : n;
+        job[i].p = p + start;
+        job[i].n = stop - start;
+        /* the shares sit side by side in memory, so each one can look
+         * at the byte just before it to tell if it starts mid-word */
+        job[i].prevspace = i == 0 ? w->prevspace : isspace_byte(job[i].p[-1]);
+        job[i].utf8 = w->utf8;
+        lo = start > head ? start : head;
+        hi = stop < end ? stop : end;
+        job[i].check = lo - start;
+        job[i].ncheck = hi > lo ? hi - lo : 0;
+    }
+    run_parallel(count_job, job, sizeof(job[0]), njobs);
+    for (i = 0; i < njobs; i++) {
+        w->c.lines += job[i].c.lines;
+        w->c.words += job[i].c.words;
+        w->c.chars += job[i].c.chars;
+        w->c.bytes += job[i].c.bytes;
+        if (w->utf8)
+            w->u8.valid &= job[i].valid;
+    }
+    w->prevspace = isspace_byte(p[n - 1]);
+    return 0;
+}
+
+static void *count_job(void *arg)
+{
+    struct wcjob *job = arg;
+
+    memset(&job->c, 0, sizeof(job->c));
+    count(job->p, job->n, job->prevspace, &job->c);
+    if (job->utf8) {
+        job->c.chars = utf8_count(job->p, job->n);
+        job->valid = utf8_valid(job->p + job->check, job->ncheck);
+    }
+    return NULL;
+}
+
+/* count the n bytes at p a byte at a time; return whether the last
+ * byte was white space */
+static int count_bytes(const unsigned char *p, size_t n, int prevspace,
+                       struct counts *c)
+{
+    size_t i;
+    int space;
+
+    for (i = 0; i < n; i++) {
+        space = isspace_byte(p[i]);
+        c->lines += p[i] == '\n';
+        c->words += prevspace && !space;
+        prevspace = space;
+    }
+    c->bytes += n;
+    return prevspace;
+}
+
+#if defined(__x86_64__)
+/* the 32 bytes at p as a mask of (white space, newline) bits */
+__attribute__((target("avx2")))
+static void classify32(const unsigned char *p, uint32_t *space, uint32_t *nl)
+{
+    __m256i v = _mm256_loadu_si256((const __m256i *)p);
+    /* '\t'..'\r' are the bytes where v - '\t' is at most 4, unsigned */
+    __m256i d = _mm256_sub_epi8(v, _mm256_set1_epi8('\t'));
+    __m256i ctrl = _mm256_cmpeq_epi8(_mm256_min_epu8(d, _mm256_set1_epi8(4)), d);
+    __m256i blank = _mm256_cmpeq_epi8(v, _mm256_set1_epi8(' '));
+
+    *space = _mm256_movemask_epi8(_mm256_or_si256(ctrl, blank));
+    *nl = _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')));
+}
+
+/* count the n bytes at p 64 at a time; return whether the last byte
+ * of the part counted was white space, and how much was counted in *done */
+__attribute__((target("avx2,popcnt")))
+static int count_avx2(const unsigned char *p, size_t n, int prevspace,
+                      struct counts *c, size_t *done)
+{
+    uint32_t s0, s1, n0, n1;
+    uint64_t space, nl, starts;
+    size_t i;
+
+    for (i = 0; i + 64 <= n; i += 64) {
+        classify32(p + i, &s0, &n0);
+        classify32(p + i + 32, &s1, &n1);
+        space = (uint64_t)s1 << 32 | s0;
+        nl = (uint64_t)n1 << 32 | n0;
+        /* bit k of (space << 1 | prevspace) says whether byte k-1 is space */
+        starts = ~space & (space << 1 | (uint64_t)prevspace);
+        c->lines += __builtin_popcountll(nl);
+        c->words += __builtin_popcountll(starts);
+        prevspace = space >> 63;
+    }
+    c->bytes += i;
+    *done = i;
+    return prevspace;
+}
+#endif
+
+/* count the n bytes at p, which follow a space if prevspace is set */
+static void count(const unsigned char *p, size_t n, int prevspace,
+                  struct counts *c)
+{
+    size_t done = 0;
+
+#if defined(__x86_64__)
+    if (__builtin_cpu_supports("avx2"))
+        prevspace = count_avx2(p, n, prevspace, c, &done);
+#endif
+    count_bytes(p + done, n - done, prevspace, c);
+}
+
+static void print_counts(const struct counts *c, int utf8, const char *name)
+{
+    printf("%8llu %8llu", (unsigned long long)c->lines,
+           (unsigned long long)c->words);
+    if (utf8)
+        printf(" %8llu", (unsigned long long)c->chars);
+    printf(" %8llu", (unsigned long long)c->bytes);
+    if (name != NULL)
+        printf(" %s", name);
+    printf("\n");
+}
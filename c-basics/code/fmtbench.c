@@ -0,0 +1,186 @@
+/* check the fmtbuf writers against snprintf, then compare their speed
+ * on a logging line.
+ *
+ * usage: fmtbench [Mlines]
+ */
+#define _GNU_SOURCE 1
+#include <inttypes.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "benchutil.h"
+#include "fmtbuf.h"
+
+#define REPS 5
+
+/* a random number of a random length, so every digit count shows up */
+static int64_t random_number(uint64_t *seed)
+{
+    uint64_t r = next_random(seed);
+
+    return (int64_t)(next_random(seed) >> (r % 64)) * (r & 64 ? -1 : 1);
+}
+
+/* a random double of a random size, often on or near a rounding tie */
+static double random_double(uint64_t *seed)
+{
+    uint64_t r = next_random(seed);
+    double d = (double)(next_random(seed) >> 11) / (1ULL << 53);
+
+    switch (r % 4) {
+    case 0:
+        d = ldexp(d, (int)(r >> 8) % 80 - 40);
+        break;
+    case 1:                 /* ties such as 0.125 and 2.5 */
+        d = ldexp((double)(r >> 8 & 0xFFFF), -(int)(r >> 24) % 12);
+        break;
+    case 2:                 /* a few decimal digits, not quite exact */
+        d = (double)(r >> 8 & 0xFFFFF) / 1000;
+        break;
+    default:
+        d *= 1e6;
+    }
+    return r & 1 << 7 ? -d : d;
+}
+
+/* compare what b holds with s; return 1 if they differ */
+static int differs(struct fmtbuf *b, const char *s)
+{
+    return b->err || b->len != strlen(s) || memcmp(b->p, s, b->len) != 0;
+}
+
+static int check(void)
+{
+    static const double edge[] = {
+        0, -0.0, 0.5, 1.5, 2.5, -0.5, 0.05, 0.15, 0.25, 0.35, 1e15, 1e16,
+        4503599627370495.5, 4503599627370496.0, 1e300, -1e-300, 9.9999995,
+        INFINITY, -INFINITY, NAN
+    };
+    static const char text[] = "the quick brown fox";
+    char want[400];
+    struct fmtbuf b;
+    uint64_t seed = 1;
+    int64_t v;
+    double d;
+    int i, width, prec, bad = 0;
+    size_t j;
+
+    fb_init(&b);
+    for (i = 0; i < 1000000; i++) {
+        width = (int)(next_random(&seed) % 61) - 30;
+        prec = (int)(next_random(&seed) % 20) - 1;
+        v = random_number(&seed);
+        if (i % 16 == 0)
+            v %= 3;         /* so %.0d of 0 comes up */
+
+        fb_reset(&b);
+        fb_int(&b, v, width, prec);
+        snprintf(want, sizeof(want), "%*.*" PRId64, width, prec, v);
+        bad += differs(&b, want);
+        fb_reset(&b);
+        fb_uint(&b, (uint64_t)v, width, prec);
+        snprintf(want, sizeof(want), "%*.*" PRIu64, width, prec, (uint64_t)v);
+        bad += differs(&b, want);
+        fb_reset(&b);
+        fb_str(&b, text, width, prec);
+        snprintf(want, sizeof(want), "%*.*s", width, prec, text);
+        bad += differs(&b, want);
+
+        d = random_double(&seed);
+        fb_reset(&b);
+        fb_fixed(&b, d, width, prec);
+        snprintf(want, sizeof(want), "%*.*f", width, prec < 0 ? 6 : prec, d);
+        bad += differs(&b, want);
+    }
+    for (j = 0; j < sizeof(edge) / sizeof(edge[0]); j++)
+        for (prec = 0; prec <= 20; prec++) {
+            fb_reset(&b);
+            fb_fixed(&b, edge[j], 0, prec);
+            snprintf(want, sizeof(want), "%.*f", prec, edge[j]);
+            bad += differs(&b, want);
+        }
+    /* growing past the first buffer keeps what was written */
+    fb_reset(&b);
+    for (i = 0; i < 1000; i++)
+        fb_printf(&b, "%d,", i);
+    for (j = 0, i = 0; i < 1000; i++)
+        j += snprintf(want, sizeof(want), "%d,", i);
+    bad += b.len != j || strncmp(fb_cstr(&b), "0,1,2,", 6) != 0
+           || strcmp(fb_cstr(&b) + j - 4, "999,") != 0;
+    fb_free(&b);
+    return bad;
+}
+
+int main(int argc, char *argv[])
+{
+    static const char *names[] = { "open", "read", "write", "close", "seek" };
+    char line[256];
+    struct fmtbuf b;
+    int64_t *v, sum;
+    double *d, t, best;
+    size_t n, i;
+    int rep;
+
+    n = (size_t)(argc > 1 ? atol(argv[1]) : 4) * 1000000;
+    if (n == 0) {
+        printf("Usage: fmtbench [Mlines]\n");
+        return 1;
+    }
+    if (check() != 0) {
+        printf("fmtbench: fmtbuf disagrees with snprintf\n");
+        return 1;
+    }
+    v = malloc(n * sizeof(v[0]));
+    d = malloc(n * sizeof(d[0]));
+    if (v == NULL || d == NULL) {
+        perror("fmtbench");
+        return 1;
+    }
+    for (i = 0; i < n; i++) {
+        v[i] = random_number(&(uint64_t){ i + 1 }) % 100000;
+        d[i] = (double)(v[i] * 7919 % 1000000) / 1000;
+    }
+    fb_init(&b);
+
+#define TIME(name, stmt)                                                      \
+    do {                                                                      \
+        for (best = 1e9, rep = 0; rep < REPS; rep++) {                        \
+            t = now();                                                        \
+            stmt;                                                             \
+            t = now() - t;                                                    \
+            best = t < best ? t : best;                                       \
+        }                                                                     \
+        printf("%-10s %8.1f Mlines/s\n", name, n / best / 1e6);              \
+    } while (0)
+
+    /* each line goes into the buffer, then the buffer is emptied, as a
+     * logger does before it hands the line on */
+    printf("%zu M lines of \"%%s %%5d %%-10.3f %%.*s\\n\", best of %d\n",
+           n / 1000000, REPS);
+    TIME("snprintf", for (sum = 0, i = 0; i < n; i++)
+                         sum += snprintf(line, sizeof(line), "%s %5" PRId64 " %-10.3f %.*s\n",
+                                         names[i % 5], v[i], d[i], (int)(i % 8), "abcdefgh"));
+    TIME("fb_printf", for (sum = 0, i = 0; i < n; i++) {
+                          fb_reset(&b);
+                          fb_printf(&b, "%s %5" PRId64 " %-10.3f %.*s\n",
+                                    names[i % 5], v[i], d[i], (int)(i % 8), "abcdefgh");
+                          sum += b.len;
+                      });
+    TIME("fmtbuf", for (sum = 0, i = 0; i < n; i++) {
+                       fb_reset(&b);
+                       fb_str(&b, names[i % 5], 0, -1);
+                       fb_char(&b, ' ');
+                       fb_int(&b, v[i], 5, -1);
+                       fb_char(&b, ' ');
+                       fb_fixed(&b, d[i], -10, 3);
+                       fb_char(&b, ' ');
+                       fb_str(&b, "abcdefgh", 0, (int)(i % 8));
+                       fb_char(&b, '\n');
+                       sum += b.len;
+                   });
+    fb_free(&b);
+    free(v);
+    free(d);
+    return sum == 42;       /* so the formatting is not optimized away */
+}
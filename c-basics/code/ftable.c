@@ -0,0 +1,67 @@
+/* ftable: converter.c's Fahrenheit-Celsius table, for any range.
+ *
+ * usage: ftable [lower [upper [step]]]
+ * With no arguments it prints the same table as converter.c (0 to 300
+ * in steps of 20), computing celsius = 5 * (fahr - 32) / 9 in integers
+ * the same way. converter.c makes a printf call per row, which reads
+ * "%d\t%d\n" all over again each time; here each row is put together
+ * with fmt_i64 in a large buffer that is written out when full, so a
+ * table of millions of rows comes out in a fraction of a second.
+ */
+#define _GNU_SOURCE 1
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "blockio.h"
+#include "intio.h"
+
+#define BUFSIZE (1 << 20)
+#define ROWMAX (2 * INTIO_MAXLEN + 2)   /* "fahr\tcelsius\n" */
+#define LIMIT (INT64_MAX / 5 - 32)      /* 5 * (fahr - 32) must not overflow */
+
+/* set *v to the number in s; return 0 on success, -1 if s is not a
+ * number within LIMIT either side of 0 */
+static int arg(const char *s, int64_t *v)
+{
+    const char *end = s + strlen(s);
+
+    if (parse_i64(s, end, v) != end || *v > LIMIT || *v < -LIMIT)
+        return -1;
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    static char buf[BUFSIZE];
+    int64_t lower = 0, upper = 300, step = 20, fahr;
+    uint64_t rows, i;
+    size_t n = 0;
+
+    if (argc > 4 || (argc > 1 && arg(argv[1], &lower) < 0)
+        || (argc > 2 && arg(argv[2], &upper) < 0)
+        || (argc > 3 && arg(argv[3], &step) < 0) || step <= 0) {
+        fprintf(stderr, "Usage: ftable [lower [upper [step]]]\n");
+        return 1;
+    }
+    /* with every number within LIMIT, fahr can step past upper
+     * without overflowing */
+    rows = upper < lower ? 0 : (uint64_t)(upper - lower) / step + 1;
+    for (i = 0, fahr = lower; i < rows; i++, fahr += step) {
+        if (BUFSIZE - n < ROWMAX) {
+            if (write_all(1, buf, n) < 0) {
+                perror("ftable");
+                return 1;
+            }
+            n = 0;
+        }
+        n += fmt_i64(buf + n, fahr);
+        buf[n++] = '\t';
+        n += fmt_i64(buf + n, 5 * (fahr - 32) / 9);
+        buf[n++] = '\n';
+    }
+    if (write_all(1, buf, n) < 0) {
+        perror("ftable");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,232 @@
+/* hist: count digits, white space and others, like array.c,
+ * but fast enough to keep up with a fast disk.
+ *
+ * usage: hist [-a] [-u|--utf8] [-t threads] [file ...]
+ *   -a  print how often each of the 256 byte values occurs instead
+ *   -u  count others in UTF-8 characters rather than bytes,
+ *       and reject input that is not valid UTF-8
+ *   -t  number of threads (default: one per CPU)
+ *
+ * array.c decides what each character is with an if-chain as it reads it.
+ * hist instead only counts how often each byte value occurs, which is one
+ * array increment per byte; sorting the 256 totals into digits, white space
+ * and others through a lookup table happens once, at the very end.
+ */
+#define _GNU_SOURCE 1
+#include <fcntl.h>
+#include <getopt.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "blockio.h"
+#include "parallel.h"
+#include "utf8.h"
+
+#define NBYTE  256          /* number of byte values */
+#define NLANE  4            /* interleaved counter arrays */
+#define WHITE  10           /* class of ' ', '\n' and '\t' */
+#define OTHER  11           /* class of everything else */
+#define NCLASS 12           /* '0'..'9' are classes 0..9 */
+
+/* the byte counts of one thread's share of a block */
+struct histjob {
+    const unsigned char *p;
+    size_t n;
+    size_t check, ncheck;   /* the part of p to validate as UTF-8, with -u */
+    int valid;
+    uint64_t count[NBYTE];
+};
+
+/* the state kept across blocks */
+struct hist {
+    int nthreads;
+    int utf8;
+    struct utf8_stream u8;  /* blocks can split a character, with -u */
+    uint64_t count[NBYTE];
+};
+
+static int count_block(const unsigned char *p, size_t n, void *arg);
+static void *count_job(void *arg);
+static void count_bytes(const unsigned char *p, size_t n, uint64_t count[]);
+static void print_classes(const uint64_t count[], int utf8);
+static void print_bytes(const uint64_t count[]);
+
+int main(int argc, char *argv[])
+{
+    static const struct option longopts[] = {
+        { "utf8", no_argument, NULL, 'u' },
+        { NULL, 0, NULL, 0 }
+    };
+    struct hist h;
+    int c, fd, all = 0, rc = 0;
+
+    memset(&h, 0, sizeof(h));
+    h.nthreads = cpu_count();
+    utf8_stream_init(&h.u8);
+    while ((c = getopt_long(argc, argv, "at:u", longopts, NULL)) != -1)
+        switch (c) {
+        case 'a':
+            all = 1;
+            break;
+        case 'u':
+            h.utf8 = 1;
+            break;
+        case 't':
+            h.nthreads = atoi(optarg);
+            break;
+        default:
+            h.nthreads = 0;
+            break;
+        }
+    if (h.nthreads < 1) {
+        fprintf(stderr, "Usage: hist [-a] [-u|--utf8] [-t threads] [file ...]\n");
+        return 1;
+    }
+
+    if (optind == argc && read_blocks(0, BLOCKSIZE, count_block, &h) < 0) {
+        perror("hist");
+        rc = 1;
+    }
+    for ( ; optind < argc; optind++) {
+        if ((fd = open(argv[optind], O_RDONLY)) < 0
+            || read_blocks(fd, BLOCKSIZE, count_block, &h) < 0) {
+            perror(argv[optind]);
+            rc = 1;
+        }
+        if (fd >= 0)
+            close(fd);
+        /* a file must not end in the middle of a character */
+        if (h.utf8 && !utf8_stream_finish(&h.u8)) {
+            fprintf(stderr, "hist: %s: invalid UTF-8\n", argv[optind]);
+            return 1;
+        }
+        utf8_stream_init(&h.u8);
+    }
+    if (h.utf8 && !utf8_stream_finish(&h.u8)) {
+        fprintf(stderr, "hist: standard input: invalid UTF-8\n");
+        return 1;
+    }
+
+    if (all)
+        print_bytes(h.count);
+    else
+        print_classes(h.count, h.utf8);
+    return rc;
+}
+
+/* count the n bytes at p into the histogram arg, splitting them
+ * across threads that each keep their own counts; always returns 0 */
+static int count_block(const unsigned char *p, size_t n, void *arg)
+{
+    struct hist *h = arg;
+    struct histjob job[MAXTHREADS];
+    size_t share, head = 0, end = n, start, stop, lo, hi;
+    int i, j, njobs;
+
+    /* the stream checks the characters cut by block edges,
+     * the threads check everything in between */
+    if (h->utf8) {
+        head = utf8_stream_head(&h->u8, p, n);
+        end = head + utf8_stream_tail(&h->u8, p + head, n - head);
+    }
+    njobs = job_count(n, PARALLEL_MINSHARE, h->nthreads);
+    share = n / njobs;
+    for (i = 0, start = 0; i < njobs; i++, start = stop) {
+        /* cut where no character is split, so each share can be
+         * validated on its own */
+        stop = i < njobs - 1 ? utf8_boundary(p, n, (i + 1) * share) : n;
+        job[i].p = p + start;
+        job[i].n = stop - start;
+        lo = start > head ? start : head;
+        hi = stop < end ? stop : end;
+        job[i].check = lo - start;
+        job[i].ncheck = h->utf8 && hi > lo ? hi - lo : 0;
+    }
+    run_parallel(count_job, job, sizeof(job[0]), njobs);
+    for (i = 0; i < njobs; i++) {
+        for (j = 0; j < NBYTE; j++)
+            h->count[j] += job[i].count[j];
+        h->u8.valid &= job[i].valid;
+    }
+    return 0;
+}
+
+static void *count_job(void *arg)
+{
+    struct histjob *job = arg;
+
+    memset(job->count, 0, sizeof(job->count));
+    count_bytes(job->p, job->n, job->count);
+    job->valid = utf8_valid(job->p + job->check, job->ncheck);
+    return NULL;
+}
+
+/* add how often each byte value occurs in the n bytes at p to count[].
+ * Runs of the same byte are common (spaces, zeros), and incrementing
+ * one counter over and over makes each increment wait for the previous
+ * one's store. Four sets of counters, used in turn, let four increments
+ * be in flight at once; they are added up at the end.
+ */
+static void count_bytes(const unsigned char *p, size_t n, uint64_t count[])
+{
+    uint64_t lane[NLANE][NBYTE];
+    size_t i;
+    int b;
+
+    memset(lane, 0, sizeof(lane));
+    for (i = 0; i + NLANE <= n; i += NLANE) {
+        lane[0][p[i]]++;
+        lane[1][p[i + 1]]++;
+        lane[2][p[i + 2]]++;
+        lane[3][p[i + 3]]++;
+    }
+    for ( ; i < n; i++)
+        lane[0][p[i]]++;
+    for (b = 0; b < NBYTE; b++)
+        count[b] += lane[0][b] + lane[1][b] + lane[2][b] + lane[3][b];
+}
+
+/* fill class[] with the class of every byte value */
+static void make_classes(unsigned char class[])
+{
+    int b;
+
+    for (b = 0; b < NBYTE; b++)
+        class[b] = OTHER;
+    for (b = '0'; b <= '9'; b++)
+        class[b] = b - '0';
+    class[' '] = class['\n'] = class['\t'] = WHITE;
+}
+
+/* print the totals in array.c's format; with utf8, continuation
+ * bytes are part of the character before them and are not counted */
+static void print_classes(const uint64_t count[], int utf8)
+{
+    unsigned char class[NBYTE];
+    uint64_t total[NCLASS];
+    int b;
+
+    make_classes(class);
+    memset(total, 0, sizeof(total));
+    for (b = 0; b < NBYTE; b++)
+        if (!utf8 || b < 0x80 || b > 0xBF)
+            total[class[b]] += count[b];
+    printf("digits =");
+    for (b = 0; b < 10; b++)
+        printf(" %llu", (unsigned long long)total[b]);
+    printf(", white space = %llu, other = %llu\n",
+           (unsigned long long)total[WHITE], (unsigned long long)total[OTHER]);
+}
+
+/* print every byte value that occurs, with its count */
+static void print_bytes(const uint64_t count[])
+{
+    int b;
+
+    for (b = 0; b < NBYTE; b++)
+        if (count[b] > 0)
+            printf("0x%.2x %c %llu\n", b, b >= ' ' && b < 127 ? b : '.',
+                   (unsigned long long)count[b]);
+}
@@ -0,0 +1,148 @@
+/* check parse_i64, parse_u64 and fmt_i64 against strtoll, strtoull and
+ * snprintf, then compare their speed.
+ *
+ * usage: intbench [Mnumbers]
+ */
+#define _GNU_SOURCE 1
+#include <errno.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "benchutil.h"
+#include "intio.h"
+
+#define REPS 5
+
+/* a random number of a random length, so every digit count shows up */
+static int64_t random_number(uint64_t *seed)
+{
+    uint64_t r = next_random(seed);
+
+    return (int64_t)(next_random(seed) >> (r % 64)) * (r & 64 ? -1 : 1);
+}
+
+/* compare one string, followed by junk, with strtoll and strtoull;
+ * return the number of disagreements */
+static int check_one(const char *s)
+{
+    char buf[64];
+    const char *end;
+    char *cend;
+    int64_t v;
+    uint64_t u;
+    long long want;
+    unsigned long long uwant;
+    size_t len = strlen(s);
+    int bad = 0, ok;
+
+    /* the junk after it must not be read as more digits, whether or
+     * not the number crosses a 16-byte boundary */
+    snprintf(buf, sizeof(buf), "%s,9999999999999999999999", s);
+    errno = 0;
+    want = strtoll(s, &cend, 10);
+    ok = errno == 0 && cend == s + len && len > 0 && s[0] != ' ';
+    end = parse_i64(buf, buf + strlen(buf), &v);
+    if (ok ? end != buf + len || v != want : end != NULL)
+        bad++;
+    errno = 0;
+    uwant = strtoull(s, &cend, 10);
+    ok = ok && s[0] != '-' && s[0] != '+';
+    ok = ok || (errno == 0 && cend == s + len && len > 0 && s[0] >= '0' && s[0] <= '9');
+    end = parse_u64(buf, buf + strlen(buf), &u);
+    if (ok ? end != buf + len || u != uwant : end != NULL)
+        bad++;
+    return bad;
+}
+
+static int check(void)
+{
+    static const char *edge[] = {
+        "0", "-0", "+7", "", "-", "x", "9223372036854775807",
+        "9223372036854775808", "-9223372036854775808", "-9223372036854775809",
+        "18446744073709551615", "18446744073709551616", "99999999999999999999",
+        "0000000000000000000000000042", "1234567890123456", "12345678901234567",
+        "-1234567812345678", "00000000000000001"
+    };
+    char buf[64], want[64];
+    uint64_t seed = 1;
+    int64_t v;
+    size_t i, n;
+    int bad = 0;
+
+    for (i = 0; i < sizeof(edge) / sizeof(edge[0]); i++)
+        bad += check_one(edge[i]);
+    for (i = 0; i < 1000000; i++) {
+        v = random_number(&seed);
+        n = fmt_i64(buf, v);
+        buf[n] = '\0';
+        snprintf(want, sizeof(want), "%" PRId64, v);
+        bad += strcmp(buf, want) != 0;
+        bad += check_one(want);
+    }
+    n = fmt_i64(buf, INT64_MIN);
+    buf[n] = '\0';
+    bad += strcmp(buf, "-9223372036854775808") != 0;
+    n = fmt_u64(buf, UINT64_MAX);
+    buf[n] = '\0';
+    bad += strcmp(buf, "18446744073709551615") != 0;
+    return bad;
+}
+
+int main(int argc, char *argv[])
+{
+    int64_t *v, sum;
+    char *text, *p, *end;
+    const char *q;
+    size_t n, i, len;
+    double t, best;
+    int rep;
+
+    n = (size_t)(argc > 1 ? atol(argv[1]) : 4) * 1000000;
+    if (n == 0) {
+        printf("Usage: intbench [Mnumbers]\n");
+        return 1;
+    }
+    if (check() != 0) {
+        printf("intbench: intio disagrees with strtoll or snprintf\n");
+        return 1;
+    }
+    v = malloc(n * sizeof(v[0]));
+    text = malloc(n * (INTIO_MAXLEN + 1));
+    if (v == NULL || text == NULL) {
+        perror("intbench");
+        return 1;
+    }
+    for (i = 0; i < n; i++)
+        v[i] = random_number(&(uint64_t){ i + 1 });
+
+#define TIME(name, stmt)                                                      \
+    do {                                                                      \
+        for (best = 1e9, rep = 0; rep < REPS; rep++) {                        \
+            t = now();                                                        \
+            stmt;                                                             \
+            t = now() - t;                                                    \
+            best = t < best ? t : best;                                       \
+        }                                                                     \
+        printf("%-10s %8.1f Mnumbers/s\n", name, n / best / 1e6);            \
+    } while (0)
+
+    printf("%zu M numbers of every length, best of %d\n", n / 1000000, REPS);
+    TIME("snprintf", for (p = text, i = 0; i < n; i++)
+                         p += snprintf(p, INTIO_MAXLEN + 2, "%" PRId64 "\n", v[i]));
+    TIME("fmt_i64", for (p = text, i = 0; i < n; i++) {
+                        p += fmt_i64(p, v[i]);
+                        *p++ = '\n';
+                    });
+    len = p - text;
+    end = text + len;
+    TIME("strtoll", for (sum = 0, p = text; p < end; p++)
+                        sum += strtoll(p, &p, 10));
+    TIME("parse_i64", for (sum = 0, q = text; q != NULL && q < end; q++) {
+                          q = parse_i64(q, end, &v[0]);
+                          sum += v[0];
+                      });
+    free(v);
+    free(text);
+    return sum == 42;       /* so the parsing is not optimized away */
+}
@@ -0,0 +1,213 @@
+/* longest: print the k longest input lines, longest first.
+ *
+ * usage: longest [-u|--utf8] [-k count] [-t threads] [file]
+ *   -u  measure lines in UTF-8 characters rather than bytes,
+ *       and reject input that is not valid UTF-8
+ *
+ * chararray.c keeps the longest line by copying it into longest[] every
+ * time a longer one shows up, and cuts lines off at MAXLINE. Here the
+ * whole input is mapped into memory, and a line is just where it starts
+ * and how long it is, so lines can be any length and nothing is copied
+ * until the winners are written out.
+ *
+ * Each thread scans its own stretch of the input and keeps its k best
+ * lines in a small heap; the heaps are merged at the end. Of two lines
+ * of the same length, the earlier one wins, so the answer does not depend
+ * on how many threads found it.
+ */
+#define _GNU_SOURCE 1
+#include <fcntl.h>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "blockio.h"
+#include "parallel.h"
+#include "utf8.h"
+
+
+/* a line: where it starts in the input, its length in bytes without
+ * the '\n', and its width (its length in characters with -u) */
+struct line {
+    size_t off;
+    size_t len;
+    size_t width;
+};
+
+/* the k best lines seen so far, as a heap with the worst one on top,
+ * so deciding whether a new line makes the cut is one comparison */
+struct topk {
+    struct line *heap;
+    size_t n;               /* lines in the heap */
+    size_t k;               /* lines to keep */
+};
+
+/* one thread's stretch of the input and its best lines */
+struct topjob {
+    const unsigned char *base;
+    size_t start, end;
+    int utf8, valid;
+    struct topk top;
+};
+
+static int better(struct line a, struct line b);
+static int topk_init(struct topk *t, size_t k);
+static void topk_offer(struct topk *t, struct line l);
+static void *scan_job(void *arg);
+static int by_rank(const void *a, const void *b);
+
+int main(int argc, char *argv[])
+{
+    struct input in;
+    struct topjob job[MAXTHREADS];
+    static const struct option longopts[] = {
+        { "utf8", no_argument, NULL, 'u' },
+        { NULL, 0, NULL, 0 }
+    };
+    struct topk best;
+    long k = 1;
+    int c, fd = 0, nthreads, njobs, i, utf8 = 0;
+    size_t j, share;
+
+    nthreads = cpu_count();
+    while ((c = getopt_long(argc, argv, "k:t:u", longopts, NULL)) != -1)
+        switch (c) {
+        case 'u':
+            utf8 = 1;
+            break;
+        case 'k':
+            k = atol(optarg);
+            break;
+        case 't':
+            nthreads = atoi(optarg);
+            break;
+        default:
+            k = 0;
+            break;
+        }
+    if (k < 1 || nthreads < 1 || argc - optind > 1) {
+        fprintf(stderr, "Usage: longest [-u|--utf8] [-k count] [-t threads] [file]\n");
+        return 1;
+    }
+    if (optind < argc && (fd = open(argv[optind], O_RDONLY)) < 0) {
+        perror(argv[optind]);
+        return 1;
+    }
+    if (map_input(fd, &in) < 0) {
+        perror("longest");
+        return 1;
+    }
+
+    /* cut the input into stretches that each begin at the start of a line;
+     * '\n' never appears inside a UTF-8 character, so each stretch can be
+     * validated on its own */
+    njobs = job_count(in.n, PARALLEL_MINSHARE, nthreads);
+    share = in.n / njobs;
+    for (i = 0; i < njobs; i++) {
+        job[i].base = in.p;
+        job[i].start = i == 0 ? 0 : job[i - 1].end;
+        job[i].end = i < njobs - 1 ? next_line(in.p, in.n, (i + 1) * share) : in.n;
+        if (job[i].end < job[i].start)
+            job[i].end = job[i].start;
+        job[i].utf8 = utf8;
+        if (topk_init(&job[i].top, k) < 0) {
+            perror("longest");
+            return 1;
+        }
+    }
+    run_parallel(scan_job, job, sizeof(job[0]), njobs);
+
+    if (topk_init(&best, k) < 0) {
+        perror("longest");
+        return 1;
+    }
+    for (i = 0; i < njobs; i++)
+        if (utf8 && !job[i].valid) {
+            fprintf(stderr, "longest: %s: invalid UTF-8\n",
+                    optind < argc ? argv[optind] : "standard input");
+            return 1;
+        }
+    for (i = 0; i < njobs; i++) {
+        for (j = 0; j < job[i].top.n; j++)
+            topk_offer(&best, job[i].top.heap[j]);
+        free(job[i].top.heap);
+    }
+    /* only now are any characters copied: straight to the output */
+    qsort(best.heap, best.n, sizeof(best.heap[0]), by_rank);
+    for (j = 0; j < best.n; j++) {
+        fwrite(in.p + best.heap[j].off, 1, best.heap[j].len, stdout);
+        putchar('\n');
+    }
+    free(best.heap);
+    unmap_input(&in);
+    return 0;
+}
+
+/* is line a better (wider, or as wide and earlier) than line b? */
+static int better(struct line a, struct line b)
+{
+    return a.width > b.width || (a.width == b.width && a.off < b.off);
+}
+
+static int topk_init(struct topk *t, size_t k)
+{
+    t->heap = malloc(k * sizeof(t->heap[0]));
+    t->n = 0;
+    t->k = k;
+    return t->heap != NULL ? 0 : -1;
+}
+
+/* keep l if it is among the k best lines offered so far */
+static void topk_offer(struct topk *t, struct line l)
+{
+    struct line *h = t->heap;
+    size_t i, child;
+
+    if (t->n < t->k) {
+        /* sift l up from the bottom while it is worse than its parent */
+        for (i = t->n++; i > 0 && better(h[(i - 1) / 2], l); i = (i - 1) / 2)
+            h[i] = h[(i - 1) / 2];
+        h[i] = l;
+        return;
+    }
+    if (!better(l, h[0]))
+        return;
+    /* l replaces the worst line; sift it down past any worse children */
+    for (i = 0; (child = 2 * i + 1) < t->n; i = child) {
+        if (child + 1 < t->n && better(h[child], h[child + 1]))
+            child++;
+        if (!better(l, h[child]))
+            break;
+        h[i] = h[child];
+    }
+    h[i] = l;
+}
+
+/* offer every line of one stretch of the input to its heap */
+static void *scan_job(void *arg)
+{
+    struct topjob *job = arg;
+    const unsigned char *nl;
+    struct line l;
+    size_t pos;
+
+    job->valid = job->utf8 ? utf8_valid(job->base + job->start,
+                                        job->end - job->start) : 1;
+    for (pos = job->start; pos < job->end; pos = l.off + l.len + 1) {
+        nl = memchr(job->base + pos, '\n', job->end - pos);
+        l.off = pos;
+        l.len = (nl != NULL ? (size_t)(nl - job->base) : job->end) - pos;
+        l.width = job->utf8 ? utf8_count(job->base + pos, l.len) : l.len;
+        topk_offer(&job->top, l);
+    }
+    return NULL;
+}
+
+/* qsort comparison putting better lines first */
+static int by_rank(const void *a, const void *b)
+{
+    const struct line *la = a, *lb = b;
+
+    return better(*la, *lb) ? -1 : better(*lb, *la);
+}
@@ -1,9 +1,11 @@
 #include <stdio.h>
+#include "bounds.h"
+#include "stats.h"
 
 #define MAXLINE 100
 
-/* a simple calculator */
-int main(void)
+/* a simple calculator; --stats reports where the time went */
+int main(int argc, char *argv[])
 {
     /* The declaration here says that:
      * 1. sum is a double variable
@@ -32,10 +34,11 @@ int main(void)
      */
     double sum, atof(char []);
     char line[MAXLINE];
-    int csc250_getline(char line[], int max);
+    int csc250_getline(struct charspan line, int max);
 
+    stats_option(&argc, argv);
     sum = 0;
-    while (csc250_getline(line, MAXLINE) > 0)
+    while (csc250_getline(BOUNDS_SPAN(line), MAXLINE) > 0)
         printf("\t%g\n", sum += atof(line));
     
     return 0;
@@ -1,14 +1,48 @@
 #include <stdio.h>
+#include <string.h>
+#include "bounds.h"
+#include "instream.h"
+#include "stats.h"
 
-/* get line into s, return length */
-int csc250_getline(char s[], int lim)
+STATS_COUNTER(getline_calls);
+STATS_COUNTER(getline_bytes);
+
+/* get line into s, return length.
+ * The line is found with memchr over the standard input's buffer and
+ * copied out with one memcpy, instead of a getchar call per character.
+ * As before, at most lim - 1 characters are read, and the rest of a
+ * longer line is left for the next call. Like getchar, it reads no
+ * further than it must: only when what is buffered holds no '\n' is
+ * the stream filled again, by one read, so a line typed at a terminal
+ * comes back as soon as it is entered. s is the array and its real
+ * length (see bounds.h), checked once against the lim bytes it may
+ * take. */
+int csc250_getline(struct charspan s, int lim)
 {
-    int c, i;
-    i = 0;
-    while (--lim > 0 && (c=getchar()) != EOF && c != '\n')
-        s[i++] = c;
-    if (c == '\n')
-        s[i++] = c;
-    s[i] = '\0';
+    struct instream *in = ins_stdin();
+    struct strview v;
+    size_t max = lim > 1 ? lim - 1 : 0, have, done = 0;
+    const char *nl;
+    int i;
+
+    BOUNDS_RANGE(s, 0, lim);
+    for (;;) {
+        have = in->end - in->pos;
+        have = have < max ? have : max;
+        if (have > done && (nl = memchr(in->pos + done, '\n', have - done)) != NULL) {
+            have = nl - in->pos + 1;
+            break;
+        }
+        /* only the part not yet searched is searched again */
+        if (have == max || ins_fill(in, have + 1) == have)
+            break;
+        done = have;
+    }
+    v = ins_take(in, have);
+    i = v.len;
+    STATS_ADD(getline_calls, 1);
+    STATS_ADD(getline_bytes, i);
+    memcpy(s.p, v.ptr, i);
+    s.p[i] = '\0';
     return i;
 }
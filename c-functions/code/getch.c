@@ -1,21 +1,35 @@
 #include <stdio.h>
+#include "instream.h"
+#include "stats.h"
 
-#define BUFSIZE 100
+/* getch and ungetch used to keep their own 100-character push-back
+ * buffer in front of getchar. Reading from an instream, a character is
+ * pushed back by moving back over it in the stream's buffer, so there is
+ * no second buffer to fill up; the catch is that only what was read can
+ * be pushed back, which is all getop ever does. */
 
-static char buf[BUFSIZE];  /* buffer for ungetch */
-static int bufp = 0;       /* next free position in buf */
+STATS_COUNTER(getch_chars);
+STATS_COUNTER(ungetch_pushbacks);
 
 /* get a (possibly pushed-back) character */
 int getch(void)
 {
-    return (bufp > 0) ? buf[--bufp] : getchar();
+    STATS_ADD(getch_chars, 1);
+    return ins_getc(ins_stdin());
 }
 
 /* push character back on input */
 void ungetch(int c)
 {
-    if (bufp >= BUFSIZE)
-        printf("ungetch: too many characters\n");
-    else
-        buf[bufp++] = c;
+    struct instream *in = ins_stdin();
+
+    if (c == EOF)
+        return;
+    if (ins_unread(in, 1) < 0)
+        printf("ungetch: nothing to push back\n");
+    else if (*in->pos != (char)c) {
+        printf("ungetch: can only push back what was read\n");
+        ins_getc(in);       /* undo the move back */
+    } else
+        STATS_ADD(ungetch_pushbacks, 1);
 }
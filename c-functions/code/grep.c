@@ -1,21 +1,27 @@
 #include <stdio.h>
+#include "bounds.h"
+#include "stats.h"
+#include "strview.h"
 
 #define MAXLINE 1000                    /* maximum input line length */
 
-int strindex(char source[], char searchfor[]);
-
 char pattern[] = "ould";                /* pattern to search for */
 
-/* find all lines matching pattern */
-int main(void)
+/* find all lines matching pattern; --stats reports where the time went */
+int main(int argc, char *argv[])
 {
     char line[MAXLINE];
-    int found = 0;
-    int csc250_getline(char line[], int max);
+    int len, found = 0;
+    int csc250_getline(struct charspan line, int max);
+    /* csc250_getline already tells us how long the line is,
+     * so neither the line nor the pattern is ever measured again */
+    struct strview pat = sv_fromstr(pattern);
+
+    stats_option(&argc, argv);
 
-    while (csc250_getline(line, MAXLINE) > 0)
-        if (strindex(line, pattern) >= 0) {
-            printf("%s", line);
+    while ((len = csc250_getline(BOUNDS_SPAN(line), MAXLINE)) > 0)
+        if (sv_find(sv_make(line, len), pat) >= 0) {
+            fwrite(line, 1, len, stdout);
             found++;
         }
     /* return the number of matches found. 
@@ -24,16 +30,3 @@ int main(void)
      */
     return found;
 }
-
-/* return index of t in s, -1 if none */
-int strindex(char s[], char t[])
-{
-    int i, j, k;
-    for (i = 0; s[i] != '\0'; i++) {
-        for (j=i, k=0; t[k]!='\0' && s[j]==t[k]; j++, k++)
-            ;
-        if (k > 0 && t[k] == '\0')
-            return i;
-    }
-    return -1;
-}
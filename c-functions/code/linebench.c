@@ -0,0 +1,269 @@
+/* check instream over a pipe against the same reads from memory, over
+ * a file read from the middle, and csc250_getline on a standard input
+ * that gets a line at a time, then compare ways of reading a file line
+ * by line.
+ *
+ * usage: linebench file
+ */
+#define _GNU_SOURCE 1
+#include <fcntl.h>
+#include <signal.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "benchutil.h"
+#include "bounds.h"
+#include "instream.h"
+
+#define REPS 5
+#define CHECKSIZE (3 * INS_BUFSIZE + 12345)
+#define CHECKLIM 16         /* csc250_getline's lim in check_lines */
+
+int csc250_getline(struct charspan s, int lim);
+
+/* write the n bytes at p to fd in pieces of random sizes, so reads end
+ * at every sort of place */
+static void dribble(int fd, const char *p, size_t n)
+{
+    uint64_t seed = 7;
+    size_t k;
+
+    while (n > 0) {
+        k = next_random(&seed) % 5000 + 1;
+        k = k < n ? k : n;
+        if (write(fd, p, k) != (ssize_t)k)
+            exit(1);
+        p += k;
+        n -= k;
+    }
+}
+
+/* read all of s with a random mix of every call, adding what each call
+ * returns to a running hash; return the hash */
+static uint64_t mix(struct instream *s)
+{
+    struct strview v;
+    uint64_t seed = 11, h = 0, r;
+    size_t i;
+    int c;
+
+    for (;;) {
+        r = next_random(&seed);
+        switch (r % 5) {
+        case 0:
+            if ((c = ins_getc(s)) == -1)
+                return h;
+            h = h * 31 + c;
+            break;
+        case 1:             /* back up, then read the same bytes again */
+            if (ins_unread(s, r >> 8 & (INS_KEEP - 1)) == 0)
+                h = h * 31 + 1;
+            break;
+        case 2:
+            v = ins_peek(s, r >> 8 & 0x3FFFF);
+            h = h * 31 + v.len;
+            break;
+        case 3:
+            v = ins_take(s, r >> 8 & 0xFFF);
+            for (i = 0; i < v.len; i++)
+                h = h * 31 + (unsigned char)v.ptr[i];
+            break;
+        default:
+            v = ins_getline(s);
+            for (i = 0; i < v.len; i++)
+                h = h * 31 + (unsigned char)v.ptr[i];
+        }
+    }
+}
+
+static int check(void)
+{
+    char *text = malloc(CHECKSIZE);
+    struct instream s;
+    uint64_t seed = 3, want, got;
+    size_t i;
+    int fd[2], status;
+
+    if (text == NULL || pipe(fd) < 0)
+        return 1;
+    /* lines of all lengths, some longer than the buffer */
+    for (i = 0; i < CHECKSIZE; i++)
+        text[i] = next_random(&seed) % (i < INS_BUFSIZE ? 80 : 100000) == 0 ? '\n' : 'a' + i % 26;
+    ins_open_mem(&s, text, CHECKSIZE);
+    want = mix(&s);
+    if (fork() == 0) {
+        close(fd[0]);
+        dribble(fd[1], text, CHECKSIZE);
+        _exit(0);
+    }
+    close(fd[1]);
+    if (ins_open(&s, fd[0]) < 0)
+        return 1;
+    got = mix(&s);
+    ins_close(&s);
+    close(fd[0]);
+    wait(&status);
+    free(text);
+    return got != want || s.err;
+}
+
+/* a file whose descriptor someone else has already read from, as in
+ * { dd bs=10 count=1 of=/dev/null; grep would; } < file: the stream
+ * must start where the descriptor is, and leave it after the one line
+ * taken when closed */
+static int check_offset(void)
+{
+    static const char text[] = "would one\nxyz\ncould two\n";
+    FILE *fp = tmpfile();
+    struct instream s;
+    struct strview v;
+    int fd, bad;
+
+    if (fp == NULL || write(fd = fileno(fp), text, sizeof(text) - 1) < 0
+        || lseek(fd, 10, SEEK_SET) != 10 || ins_open(&s, fd) < 0)
+        return 1;
+    v = ins_getline(&s);
+    bad = !sv_eq(v, sv_fromstr("xyz\n"));
+    ins_close(&s);
+    bad |= lseek(fd, 0, SEEK_CUR) != 14;
+    fclose(fp);
+    return bad;
+}
+
+static void waited(int sig)
+{
+    static const char msg[] = "linebench: csc250_getline waits for more than a line\n";
+
+    (void)sig;
+    if (write(1, msg, sizeof(msg) - 1) < 0)
+        _exit(2);
+    _exit(1);
+}
+
+/* the standard input is a pipe that a child writes a line at a time
+ * to, waiting for each to be read before writing the next, as someone
+ * typing would; csc250_getline must hand each back without waiting for
+ * more, a line longer than lim - 1 in two parts, and the last, which
+ * has no '\n', once the pipe is closed */
+static int check_lines(void)
+{
+    static const char *const lines[] = {
+        "a would\n", "\n", "1 2 +\n", "a line longer than the limit\n",
+    };
+    static const char last[] = "no newline";
+    char got[CHECKLIM], want[CHECKLIM], ack = 0;
+    size_t i, n, k, part;
+    int in[2], back[2], status, bad = 0;
+
+    if (pipe(in) < 0 || pipe(back) < 0)
+        return 1;
+    if (fork() == 0) {
+        close(in[0]);
+        close(back[1]);
+        for (i = 0; i < sizeof(lines) / sizeof(lines[0]); i++)
+            if (write(in[1], lines[i], strlen(lines[i])) < 0 || read(back[0], &ack, 1) != 1)
+                _exit(1);
+        _exit(write(in[1], last, sizeof(last) - 1) < 0);
+    }
+    close(in[1]);
+    close(back[0]);
+    if (dup2(in[0], 0) < 0)
+        return 1;
+    close(in[0]);
+    signal(SIGALRM, waited);
+    alarm(5);
+    for (i = 0; i < sizeof(lines) / sizeof(lines[0]) && !bad; i++) {
+        for (n = strlen(lines[i]), k = 0; k < n && !bad; k += part) {
+            part = n - k < CHECKLIM - 1 ? n - k : CHECKLIM - 1;
+            memcpy(want, lines[i] + k, part);
+            want[part] = '\0';
+            bad = csc250_getline(BOUNDS_SPAN(got), CHECKLIM) != (int)part || strcmp(got, want) != 0;
+        }
+        bad |= write(back[1], &ack, 1) != 1;
+    }
+    close(back[1]);
+    bad |= csc250_getline(BOUNDS_SPAN(got), CHECKLIM) != (int)sizeof(last) - 1 || strcmp(got, last) != 0;
+    bad |= csc250_getline(BOUNDS_SPAN(got), CHECKLIM) != 0;
+    alarm(0);
+    wait(&status);
+    return bad || status != 0;
+}
+
+int main(int argc, char *argv[])
+{
+    struct instream s;
+    struct strview v;
+    FILE *fp;
+    char *line = NULL;
+    size_t cap = 0, lines, bytes;
+    ssize_t len;
+    double t, best;
+    int rep, c, fd;
+
+    if (argc != 2) {
+        printf("Usage: linebench file\n");
+        return 1;
+    }
+    if (check() != 0) {
+        printf("linebench: instream over a pipe disagrees with memory\n");
+        return 1;
+    }
+    if (check_offset() != 0) {
+        printf("linebench: instream does not start and end where the file is\n");
+        return 1;
+    }
+    if (check_lines() != 0) {
+        printf("linebench: csc250_getline disagrees\n");
+        return 1;
+    }
+
+#define TIME(name, stmt)                                                      \
+    do {                                                                      \
+        for (best = 1e9, rep = 0; rep < REPS; rep++) {                        \
+            lines = bytes = 0;                                                \
+            t = now();                                                        \
+            stmt;                                                             \
+            t = now() - t;                                                    \
+            best = t < best ? t : best;                                       \
+        }                                                                     \
+        printf("%-12s %8.1f MB/s  %zu lines\n", name, bytes / best / 1e6,     \
+               lines);                                                        \
+    } while (0)
+
+    if ((fp = fopen(argv[1], "r")) == NULL || (fd = open(argv[1], O_RDONLY)) < 0) {
+        perror(argv[1]);
+        return 1;
+    }
+    printf("best of %d\n", REPS);
+    TIME("getc", rewind(fp);
+                 while ((c = getc(fp)) != EOF) {
+                     bytes++;
+                     lines += c == '\n';
+                 });
+    TIME("getline", rewind(fp);
+                    while ((len = getline(&line, &cap, fp)) > 0) {
+                        bytes += len;
+                        lines++;
+                    });
+    TIME("ins_getc", lseek(fd, 0, SEEK_SET);
+                     ins_open(&s, fd);
+                     while ((c = ins_getc(&s)) != -1) {
+                         bytes++;
+                         lines += c == '\n';
+                     }
+                     ins_close(&s));
+    TIME("ins_getline", lseek(fd, 0, SEEK_SET);
+                        ins_open(&s, fd);
+                        while ((v = ins_getline(&s)).len > 0) {
+                            bytes += v.len;
+                            lines++;
+                        }
+                        ins_close(&s));
+    free(line);
+    fclose(fp);
+    close(fd);
+    return 0;
+}
@@ -14,6 +14,7 @@
  * When an included file is changed, all files that depend on it must be recompiled.
  */
 #include "calc.h"
+#include "stats.h"
 
 #define MAXOP 100 /* max size of operand or operator */
 
@@ -33,13 +34,16 @@
  * (two for binary operators) is popped, 
  * the operator is applied to them, 
  * and the result is pushed back onto the stack.
+ * 
+ * With --stats, the counts of lib/stats.h are reported at the end.
  * */
-int main(void)
+int main(int argc, char *argv[])
 {
     int type;
     double op2;
     char s[MAXOP];
     
+    stats_option(&argc, argv);
     while ((type = getop(s)) != EOF) {
         switch (type) {
         case NUMBER:
@@ -1,17 +1,23 @@
 #include <stdio.h>
 #include "calc.h"
+#include "stats.h"
 
 #define MAXVAL 100      /* maximum depth of val stack */
 
 static int sp = 0;             /* next free stack position */
 static double val[MAXVAL];     /* value stack */
 
+STATS_COUNTER(stack_pushes);
+STATS_MAXIMUM(stack_depth);
+
 /* push f onto value stack */
 void push(double f)
 {
-    if (sp < MAXVAL)
+    if (sp < MAXVAL) {
         val[sp++] = f;
-    else
+        STATS_ADD(stack_pushes, 1);
+        STATS_MAX(stack_depth, sp);
+    } else
         printf("error: stack full, can't push %g\n", f);
 }
 
@@ -0,0 +1,47 @@
+/* allocs: run memory.c's alloc and afree the way they are meant to be
+ * used, as a stack, so that make bench can time them.
+ *
+ * usage: allocs [rounds]
+ * Each round takes pieces of 1 to 64 characters from alloc until it
+ * has no room left, then gives them back with afree, last first. The
+ * first and last character of every piece are marked when it is taken
+ * and checked before it is given back, so pieces that overlap are
+ * caught.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include "benchutil.h"
+
+#define ROUNDS    100000
+#define MAXPIECES 10000     /* as many as ALLOCSIZE pieces of 1 */
+
+char *alloc(int n);
+void afree(char *p);
+
+int main(int argc, char *argv[])
+{
+    static char *piece[MAXPIECES];
+    static int len[MAXPIECES];
+    uint64_t seed = 42;
+    long rounds = argc > 1 ? atol(argv[1]) : ROUNDS, r, total = 0;
+    int n;
+
+    for (r = 0; r < rounds; r++) {
+        for (n = 0; n < MAXPIECES; n++) {
+            len[n] = 1 + next_random(&seed) % 64;
+            if ((piece[n] = alloc(len[n])) == 0)
+                break;
+            piece[n][0] = piece[n][len[n] - 1] = (char)n;
+        }
+        total += n;
+        while (--n >= 0) {
+            if (piece[n][0] != (char)n || piece[n][len[n] - 1] != (char)n) {
+                printf("allocs: piece %d was written over\n", n);
+                return 1;
+            }
+            afree(piece[n]);
+        }
+    }
+    printf("%ld pieces\n", total);
+    return 0;
+}
@@ -0,0 +1,283 @@
+#include <stdint.h>
+#include <string.h>
+#include "faststr.h"
+
+#if defined(FASTSTR_AVX2)
+#include <immintrin.h>
+#endif
+
+/* The smallest page size in use; larger pages are multiples of it,
+ * so a read that does not cross a 4 KiB boundary cannot cross a page.
+ */
+#define PAGESIZE 4096
+
+/* may_alias lets us read a string through a uint64_t pointer
+ * without breaking the compiler's strict-aliasing assumptions.
+ */
+typedef uint64_t __attribute__((may_alias)) word_t;
+
+#define WORDSIZE sizeof(word_t)
+#define ONES  0x0101010101010101ULL
+#define HIGHS 0x8080808080808080ULL
+
+/* non-zero if some byte of w is zero.
+ * Subtracting 1 from each byte borrows into the high bit only for bytes
+ * that were 0x00 (or >= 0x81); "& ~w" throws away the bytes whose high bit
+ * was already set, leaving the high bit on exactly where a zero byte sits.
+ */
+#define haszero(w) (((w) - ONES) & ~(w) & HIGHS)
+
+/* does reading n bytes from p cross into the next page? */
+static int crosses_page(const void *p, size_t n)
+{
+    return ((uintptr_t)p & (PAGESIZE - 1)) > PAGESIZE - n;
+}
+
+static int is_aligned(const void *p, size_t n)
+{
+    return ((uintptr_t)p & (n - 1)) == 0;
+}
+
+/* return length of s; 8 bytes per step */
+size_t fstrlen_swar(const char *s)
+{
+    const char *p = s;
+    const word_t *w;
+
+    /* walk bytes until p is aligned, so every word load stays in one page */
+    for ( ; !is_aligned(p, WORDSIZE); p++)
+        if (*p == '\0')
+            return p - s;
+    for (w = (const word_t *)p; !haszero(*w); w++)
+        ;
+    for (p = (const char *)w; *p != '\0'; p++)
+        ;
+    return p - s;
+}
+
+/* copy src to dst, return dst; 8 bytes per step */
+char *fstrcpy_swar(char *dst, const char *src)
+{
+    char *d = dst;
+    const word_t *w;
+
+    for ( ; !is_aligned(src, WORDSIZE); src++)
+        if ((*d++ = *src) == '\0')
+            return dst;
+    /* only whole words without a '\0' are stored, so nothing is
+     * written past the end of the string in dst */
+    for (w = (const word_t *)src; !haszero(*w); w++, d += WORDSIZE)
+        memcpy(d, w, WORDSIZE);
+    for (src = (const char *)w; (*d++ = *src++) != '\0'; )
+        ;
+    return dst;
+}
+
+/* compare the rest of s and t a character at a time, as in pstrcmp;
+ * unsigned char so bytes above 127 order the same way as in strcmp */
+static int bytecmp(const char *s, const char *t)
+{
+    const unsigned char *us = (const unsigned char *)s;
+    const unsigned char *ut = (const unsigned char *)t;
+
+    for ( ; *us == *ut; us++, ut++)
+        if (*us == '\0')
+            return 0;
+    return *us - *ut;
+}
+
+/* return <0 if s<t, 0 if s==t, >0 if s>t; 8 bytes per step
+ * s is read aligned; t usually is not, so its loads are checked
+ * against the page boundary and done a byte at a time near one.
+ */
+int fstrcmp_swar(const char *s, const char *t)
+{
+    word_t ws, wt;
+    size_t i;
+
+    for ( ; !is_aligned(s, WORDSIZE); s++, t++)
+        if (*s != *t || *s == '\0')
+            return bytecmp(s, t);
+    for (;;) {
+        if (crosses_page(t, WORDSIZE)) {
+            for (i = 0; i < WORDSIZE; i++, s++, t++)
+                if (*s != *t || *s == '\0')
+                    return bytecmp(s, t);
+            continue;
+        }
+        ws = *(const word_t *)s;
+        memcpy(&wt, t, WORDSIZE);
+        /* the difference or the '\0' is at most WORDSIZE bytes away */
+        if (ws != wt || haszero(ws))
+            return bytecmp(s, t);
+        s += WORDSIZE;
+        t += WORDSIZE;
+    }
+}
+
+/* return pointer to the first c in the n bytes at s, NULL if none */
+void *fmemchr_swar(const void *s, int c, size_t n)
+{
+    const unsigned char *p = s;
+    const word_t *w;
+    word_t pattern = ONES * (unsigned char)c;
+
+    for ( ; n > 0 && !is_aligned(p, WORDSIZE); p++, n--)
+        if (*p == (unsigned char)c)
+            return (void *)p;
+    /* XOR turns every byte equal to c into zero */
+    for (w = (const word_t *)p; n >= WORDSIZE; w++, n -= WORDSIZE)
+        if (haszero(*w ^ pattern))
+            break;
+    for (p = (const unsigned char *)w; n > 0; p++, n--)
+        if (*p == (unsigned char)c)
+            return (void *)p;
+    return NULL;
+}
+
+#if defined(FASTSTR_AVX2)
+
+#define VECSIZE 32
+
+/* one bit per byte of the 32 bytes at p: set if that byte is '\0' */
+__attribute__((target("avx2")))
+static unsigned zero_mask(const char *p)
+{
+    __m256i v = _mm256_load_si256((const __m256i *)p);
+
+    return _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_setzero_si256()));
+}
+
+static const char *align_down(const char *p)
+{
+    return (const char *)((uintptr_t)p & ~(uintptr_t)(VECSIZE - 1));
+}
+
+/* return length of s; 32 bytes per step
+ * The first load starts at the aligned block holding s and the bits
+ * for the bytes before s are shifted out of the mask.
+ */
+__attribute__((target("avx2")))
+size_t fstrlen_avx2(const char *s)
+{
+    const char *p = align_down(s);
+    unsigned mask = zero_mask(p) >> (s - p);
+
+    if (mask != 0)
+        return __builtin_ctz(mask);
+    for (p += VECSIZE; (mask = zero_mask(p)) == 0; p += VECSIZE)
+        ;
+    return p + __builtin_ctz(mask) - s;
+}
+
+/* copy src to dst, return dst; 32 bytes per step */
+__attribute__((target("avx2")))
+char *fstrcpy_avx2(char *dst, const char *src)
+{
+    const char *p = align_down(src);
+    unsigned mask = zero_mask(p) >> (src - p);
+    char *d = dst;
+    size_t n;
+
+    if (mask != 0) {
+        memcpy(dst, src, __builtin_ctz(mask) + 1);
+        return dst;
+    }
+    n = p + VECSIZE - src;
+    memcpy(d, src, n);
+    d += n;
+    for (p += VECSIZE; (mask = zero_mask(p)) == 0; p += VECSIZE, d += VECSIZE)
+        _mm256_storeu_si256((__m256i *)d,
+                            _mm256_load_si256((const __m256i *)p));
+    memcpy(d, p, __builtin_ctz(mask) + 1);
+    return dst;
+}
+
+/* return <0 if s<t, 0 if s==t, >0 if s>t; 32 bytes per step */
+__attribute__((target("avx2")))
+int fstrcmp_avx2(const char *s, const char *t)
+{
+    __m256i a, b;
+    unsigned mask;
+    int i;
+
+    for (;;) {
+        if (crosses_page(s, VECSIZE) || crosses_page(t, VECSIZE)) {
+            for (i = 0; i < VECSIZE; i++, s++, t++)
+                if (*s != *t || *s == '\0')
+                    return bytecmp(s, t);
+            continue;
+        }
+        a = _mm256_loadu_si256((const __m256i *)s);
+        b = _mm256_loadu_si256((const __m256i *)t);
+        /* a bit for every byte that differs or ends s */
+        mask = ~_mm256_movemask_epi8(_mm256_cmpeq_epi8(a, b))
+             | _mm256_movemask_epi8(_mm256_cmpeq_epi8(a, _mm256_setzero_si256()));
+        if (mask != 0)
+            return bytecmp(s + __builtin_ctz(mask), t + __builtin_ctz(mask));
+        s += VECSIZE;
+        t += VECSIZE;
+    }
+}
+
+/* return pointer to the first c in the n bytes at s, NULL if none
+ * memchr knows its length, so unaligned loads inside [s, s+n) are safe.
+ */
+__attribute__((target("avx2")))
+void *fmemchr_avx2(const void *s, int c, size_t n)
+{
+    const char *p = s;
+    __m256i pattern = _mm256_set1_epi8((char)c);
+    unsigned mask;
+
+    for ( ; n >= VECSIZE; p += VECSIZE, n -= VECSIZE) {
+        mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(
+                   _mm256_loadu_si256((const __m256i *)p), pattern));
+        if (mask != 0)
+            return (void *)(p + __builtin_ctz(mask));
+    }
+    return fmemchr_swar(p, c, n);
+}
+
+static int use_avx2(void)
+{
+    static int cached = -1;
+
+    if (cached < 0)
+        cached = __builtin_cpu_supports("avx2") != 0;
+    return cached;
+}
+
+#else
+
+static int use_avx2(void)
+{
+    return 0;
+}
+
+#define fstrlen_avx2 fstrlen_swar
+#define fstrcpy_avx2 fstrcpy_swar
+#define fstrcmp_avx2 fstrcmp_swar
+#define fmemchr_avx2 fmemchr_swar
+
+#endif
+
+size_t fstrlen(const char *s)
+{
+    return use_avx2() ? fstrlen_avx2(s) : fstrlen_swar(s);
+}
+
+char *fstrcpy(char *dst, const char *src)
+{
+    return use_avx2() ? fstrcpy_avx2(dst, src) : fstrcpy_swar(dst, src);
+}
+
+int fstrcmp(const char *s, const char *t)
+{
+    return use_avx2() ? fstrcmp_avx2(s, t) : fstrcmp_swar(s, t);
+}
+
+void *fmemchr(const void *s, int c, size_t n)
+{
+    return use_avx2() ? fmemchr_avx2(s, c, n) : fmemchr_swar(s, c, n);
+}
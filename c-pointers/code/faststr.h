@@ -0,0 +1,37 @@
+/* word-at-a-time and vector versions of the string routines in chars.c.
+ *
+ * astrcpy/pstrcpy and astrcmp/pstrcmp look at one character per iteration.
+ * The routines below look at 8 bytes (one uint64_t, the "SWAR" versions)
+ * or 32 bytes (one AVX2 register) per iteration instead.
+ *
+ * Every load is either aligned (and therefore can never straddle a page)
+ * or is checked not to straddle a page first, so reading a few bytes past
+ * the '\0' can never touch an unmapped page and fault.
+ *
+ * fstrlen, fstrcpy, fstrcmp and fmemchr pick the fastest version
+ * the running CPU supports.
+ */
+#ifndef FASTSTR_H
+#define FASTSTR_H
+
+#include <stddef.h>
+
+size_t fstrlen_swar(const char *s);
+char *fstrcpy_swar(char *dst, const char *src);
+int fstrcmp_swar(const char *s, const char *t);
+void *fmemchr_swar(const void *s, int c, size_t n);
+
+#if defined(__x86_64__)
+#define FASTSTR_AVX2 1
+size_t fstrlen_avx2(const char *s);
+char *fstrcpy_avx2(char *dst, const char *src);
+int fstrcmp_avx2(const char *s, const char *t);
+void *fmemchr_avx2(const void *s, int c, size_t n);
+#endif
+
+size_t fstrlen(const char *s);
+char *fstrcpy(char *dst, const char *src);
+int fstrcmp(const char *s, const char *t);
+void *fmemchr(const void *s, int c, size_t n);
+
+#endif
@@ -1,14 +1,19 @@
 #include <stdio.h>
-#include <string.h>
+#include "bounds.h"
+#include "stats.h"
+#include "strview.h"
 #define MAXLINE 1000
 
-int csc250_getline(char[], int);
+int csc250_getline(struct charspan, int);
 
 int main(int argc, char *argv[])
 {
     char line[MAXLINE];
     long lineno = 0;
-    int c, except = 0, number = 0, found = 0;
+    int c, len, except = 0, number = 0, found = 0;
+    struct strview pat;
+
+    stats_option(&argc, argv);      /* --stats, wherever it is */
     while (--argc > 0 && (*++argv)[0] == '-')
         while ((c = *++argv[0]))
             switch (c) {
@@ -26,27 +31,32 @@ int main(int argc, char *argv[])
             }
         if (argc != 1)
             printf("Usage: find -x -n pattern\n");
-        else
-            while (csc250_getline(line, MAXLINE) > 0) {
+        else {
+            pat = sv_fromstr(*argv);
+            while ((len = csc250_getline(BOUNDS_SPAN(line), MAXLINE)) > 0) {
                 lineno++;
-                if ((strstr(line, *argv) != NULL) != except) {
+                if ((sv_find(sv_make(line, len), pat) >= 0) != except) {
                     if (number)
                         printf("%ld:", lineno);
-                    printf("%s", line);
+                    fwrite(line, 1, len, stdout);
                     found++;
                 }
             }
+        }
         return found;
 }
 
-int csc250_getline(char s[], int lim)
+/* s is the array and its real length (see bounds.h), checked once
+ * against the lim bytes the loop may write */
+int csc250_getline(struct charspan s, int lim)
 {
     int c, i;
     i = 0;
+    BOUNDS_RANGE(s, 0, lim);
     while (--lim > 0 && (c=getchar()) != EOF && c != '\n')
-        s[i++] = c;
+        s.p[i++] = c;
     if (c == '\n')
-        s[i++] = c;
-    s[i] = '\0';
+        s.p[i++] = c;
+    s.p[i] = '\0';
     return i;
 }
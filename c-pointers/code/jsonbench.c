@@ -0,0 +1,195 @@
+/* check json_index against json_index_bytes on text made to trip it up,
+ * and json_each against values known in advance, then time both on a
+ * JSON file.
+ *
+ * usage: jsonbench file [path]
+ *   path  what to time json_each on (default prefixes[].service)
+ */
+#define _GNU_SOURCE 1
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "benchutil.h"
+#include "blockio.h"
+#include "jsonidx.h"
+#include "parallel.h"
+
+#define REPS 5
+#define CHECKSIZE (8 * 1024 * 1024 + 77)
+#define NRECORDS 100000
+
+static int same(const struct jsonidx *a, const struct jsonidx *b)
+{
+    return a->count == b->count
+        && memcmp(a->pos, b->pos, (a->count + 1) * sizeof(a->pos[0])) == 0;
+}
+
+/* text of nothing but the characters that matter, backslashes most of
+ * all, so escapes run across blocks and shares; it is indexed a byte at
+ * a time and in blocks with several numbers of threads */
+static int check_index(void)
+{
+    static const char alphabet[] = "\\\\\\\\\"\"{}[]:, \n\t\001a1-\x80";
+    char *text = malloc(CHECKSIZE);
+    struct jsonidx want, got;
+    uint64_t seed = 5;
+    size_t i;
+    int nthreads, bad = 0, tries;
+
+    if (text == NULL)
+        return 1;
+    /* about half of such texts end inside a string; try until one does not */
+    for (tries = 0; tries < 100; tries++) {
+        for (i = 0; i < CHECKSIZE; i++)
+            text[i] = alphabet[next_random(&seed) % (sizeof(alphabet) - 1)];
+        if (json_index_bytes(&want, text, CHECKSIZE) == 0)
+            break;
+        if (json_index(&got, text, CHECKSIZE, 4) != -1 || errno != EINVAL)
+            bad = 1;
+    }
+    for (nthreads = 1; nthreads <= 9; nthreads += 4) {
+        if (json_index(&got, text, CHECKSIZE, nthreads) < 0 || !same(&want, &got))
+            bad = 1;
+        json_free(&got);
+    }
+    /* and every length of a short text, for the padded last block */
+    for (i = 0; i < 200 && !bad; i++)
+        if ((json_index_bytes(&want, text, i) < 0) != (json_index(&got, text, i, 1) < 0)
+            || (want.pos != NULL && !same(&want, &got)))
+            bad = 1;
+        else {
+            json_free(&want);
+            json_free(&got);
+        }
+    json_free(&want);
+    free(text);
+    return bad || tries == 100;
+}
+
+/* count each k among the records by its digit */
+static int tally(const struct jsonidx *ix, size_t k, void *arg)
+{
+    struct strview v = json_value(ix, k);
+    long *counts = arg;
+
+    if (json_type(ix, k) != '"' || v.len != 5)
+        return 1;
+    counts[v.ptr[1] - '0']++;
+    return 0;
+}
+
+static int count_value(const struct jsonidx *ix, size_t k, void *arg)
+{
+    (void)ix;
+    (void)k;
+    ++*(long *)arg;
+    return 0;
+}
+
+/* records with a member k among others that hold k's of their own, with
+ * escapes and brackets in the strings, every other one without spaces */
+static int check_each(void)
+{
+    struct fmt { const char *rec, *sep; } fmts[2] = {
+        { "{\"id\":%d,\"skip\":{\"k\":\"no\",\"a\":[[],{},\"]\"]},\"k\":\"v%d\\\"}\",\"t\":\"a\\\\\"}", "," },
+        { "{ \"skip\" : [ { \"k\" : 1 } ], \"id\" : %d,\n  \"k\" : \"v%d\\\\]\" }", ",\n  " },
+    };
+    long want[10] = { 0 }, got[10] = { 0 }, values = 0;
+    struct jsonidx ix;
+    uint64_t seed = 9;
+    size_t n = 0, k, cap = NRECORDS * 80 + 64;
+    char *text = malloc(cap);
+    int i, v, bad;
+
+    if (text == NULL)
+        return 1;
+    n += sprintf(text + n, "{\"k\":\"top\",\"records\":[");
+    for (i = 0; i < NRECORDS; i++) {
+        v = next_random(&seed) % 10;
+        want[v]++;
+        n += sprintf(text + n, "%s", i > 0 ? fmts[i % 2].sep : "");
+        n += sprintf(text + n, fmts[i % 2].rec, i, v);
+    }
+    n += sprintf(text + n, "],\"after\":[1,2]}");
+    bad = json_index(&ix, text, n, 4) < 0
+        || json_each(&ix, "records[].k", tally, got) != 0
+        || memcmp(want, got, sizeof(want)) != 0;
+    /* the second record's id, by way of json_member */
+    k = json_member(&ix, 0, sv_fromstr("records"));
+    k = k == JSON_NONE ? k : json_skip(&ix, k + 1) + 1;
+    k = json_member(&ix, k, sv_fromstr("id"));
+    bad |= k == JSON_NONE || !sv_eq(json_value(&ix, k), sv_fromstr("1"));
+    /* a broken text must be reported, not walked off the end of */
+    text[n - 1] = ' ';
+    json_free(&ix);
+    bad |= json_index(&ix, text, n, 1) < 0 || json_each(&ix, "records[].k", tally, got) != -1;
+    bad |= json_each(&ix, "after[]", count_value, &values) != -1;
+    json_free(&ix);
+    free(text);
+    return bad;
+}
+
+int main(int argc, char *argv[])
+{
+    struct jsonidx ix;
+    struct input in;
+    const char *path = argc > 2 ? argv[2] : "prefixes[].service";
+    double t, best;
+    long values = 0;
+    int rep, fd, nthreads = cpu_count(), sum = 0;
+
+    if (argc < 2 || argc > 3) {
+        printf("Usage: jsonbench file [path]\n");
+        return 1;
+    }
+    if (check_index() != 0) {
+        printf("jsonbench: json_index disagrees with json_index_bytes\n");
+        return 1;
+    }
+    if (check_each() != 0) {
+        printf("jsonbench: json_each disagrees\n");
+        return 1;
+    }
+
+#define TIME(name, stmt)                                                      \
+    do {                                                                      \
+        for (best = 1e9, rep = 0; rep < REPS; rep++) {                        \
+            t = now();                                                        \
+            stmt;                                                             \
+            t = now() - t;                                                    \
+            best = t < best ? t : best;                                       \
+        }                                                                     \
+        printf("%-26s %8.1f MB/s\n", name, in.n / best / 1e6);                \
+    } while (0)
+
+    if ((fd = open(argv[1], O_RDONLY)) < 0 || map_input(fd, &in) < 0) {
+        perror(argv[1]);
+        return 1;
+    }
+    printf("%zu bytes, best of %d\n", in.n, REPS);
+    TIME("json_index_bytes", json_index_bytes(&ix, (const char *)in.p, in.n);
+                             sum += ix.count > 0;
+                             json_free(&ix));
+    TIME("json_index 1 thread", json_index(&ix, (const char *)in.p, in.n, 1);
+                                sum += ix.count > 0;
+                                json_free(&ix));
+    printf("%-26s %d\n", "threads", nthreads);
+    TIME("json_index", json_index(&ix, (const char *)in.p, in.n, nthreads);
+                       sum += ix.count > 0;
+                       json_free(&ix));
+    if (json_index(&ix, (const char *)in.p, in.n, nthreads) < 0) {
+        printf("jsonbench: %s: not JSON\n", argv[1]);
+        return 1;
+    }
+    printf("%-26s %8.2f per 100 bytes\n", "entries", 100.0 * ix.count / in.n);
+    TIME("json_each", values = 0;
+                      json_each(&ix, path, count_value, &values));
+    printf("%-26s %ld\n", path, values);
+    json_free(&ix);
+    unmap_input(&in);
+    return sum == 42;
+}
@@ -0,0 +1,203 @@
+/* jsonq: count the values at a path through a JSON file, however the
+ * file is laid out.
+ *
+ * usage: jsonq [-t threads] count|count-by|distinct path [file]
+ *   count     print how many values the path leads to
+ *   count-by  print each different value with how many times it comes
+ *             up, most often first, like sort | uniq -c | sort -rn
+ *   distinct  print each different value once, in order, like sort -u
+ * A path is member names and "[]"s, which mean every element of an
+ * array: "prefixes[].service" is the service of each element of the
+ * list prefixes. Strings are printed without their quotes.
+ *
+ * The questions about ip-ranges.json in questions.md become
+ *     jsonq count-by prefixes[].service ip-ranges.json | grep CLOUDFRONT
+ *     jsonq distinct prefixes[].service ip-ranges.json
+ *     jsonq distinct prefixes[].region ip-ranges.json | grep eu-west
+ * where grep CLOUDFRONT ip-ranges.json | wc -l counts lines, and so is
+ * right only as long as every value has a line of its own: the same
+ * file squeezed onto one line (as JSON often comes) counts as 1.
+ *
+ * The file is mapped into memory and indexed once (see lib/jsonidx.h),
+ * and a value is just where it starts in the mapping and how long it is,
+ * so nothing is copied until the answers are printed.
+ */
+#define _GNU_SOURCE 1
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "blockio.h"
+#include "jsonidx.h"
+#include "parallel.h"
+
+/* a different value and how many times it has come up */
+struct tally {
+    struct strview value;
+    uint64_t count;
+};
+
+/* the values seen so far, in a hash table with linear probing that
+ * doubles once it is half full, so probes stay short */
+struct table {
+    struct tally *slot;
+    size_t size;            /* a power of 2 */
+    size_t used;
+    uint64_t total;         /* values, counting repeats */
+};
+
+static uint64_t hash(struct strview v);
+static int tally_value(const struct jsonidx *ix, size_t k, void *arg);
+static int count_value(const struct jsonidx *ix, size_t k, void *arg);
+static int by_count(const void *a, const void *b);
+static int by_value(const void *a, const void *b);
+
+int main(int argc, char *argv[])
+{
+    struct table t = { NULL, 0, 0, 0 };
+    struct jsonidx ix;
+    struct input in;
+    struct tally *list;
+    const char *op, *path, *name;
+    size_t i, n;
+    int c, fd, nthreads, r;
+
+    nthreads = cpu_count();
+    while ((c = getopt(argc, argv, "t:")) != -1)
+        nthreads = c == 't' ? atoi(optarg) : 0;
+    op = optind < argc ? argv[optind] : "";
+    if (nthreads < 1 || argc - optind < 2 || argc - optind > 3
+        || (strcmp(op, "count") != 0 && strcmp(op, "count-by") != 0
+            && strcmp(op, "distinct") != 0)) {
+        fprintf(stderr, "Usage: jsonq [-t threads] count|count-by|distinct path [file]\n");
+        return 1;
+    }
+    path = argv[optind + 1];
+    name = optind + 2 < argc ? argv[optind + 2] : "standard input";
+
+    fd = optind + 2 < argc ? open(name, O_RDONLY) : 0;
+    if (fd < 0 || map_input(fd, &in) < 0) {
+        perror(name);
+        return 1;
+    }
+    if (json_index(&ix, (const char *)in.p, in.n, nthreads) < 0) {
+        if (errno == EINVAL)
+            fprintf(stderr, "jsonq: %s: a string is never closed\n", name);
+        else if (errno == EFBIG)
+            fprintf(stderr, "jsonq: %s: too big, 4 GB or more\n", name);
+        else
+            perror(name);
+        return 1;
+    }
+    if (strcmp(op, "count") == 0)
+        r = json_each(&ix, path, count_value, &t);
+    else
+        r = json_each(&ix, path, tally_value, &t);
+    if (r != 0) {
+        if (r < 0)
+            fprintf(stderr, "jsonq: %s: not JSON on the way to %s\n", name, path);
+        else
+            fprintf(stderr, "jsonq: out of memory\n");
+        return 1;
+    }
+
+    if (strcmp(op, "count") == 0) {
+        printf("%llu\n", (unsigned long long)t.total);
+        return 0;
+    }
+    /* gather the full slots at the front of the table, then sort them */
+    list = t.slot;
+    for (i = n = 0; i < t.size; i++)
+        if (t.slot[i].count > 0)
+            list[n++] = t.slot[i];
+    qsort(list, n, sizeof(list[0]), strcmp(op, "count-by") == 0 ? by_count : by_value);
+    for (i = 0; i < n; i++) {
+        if (strcmp(op, "count-by") == 0)
+            printf("%7llu ", (unsigned long long)list[i].count);
+        fwrite(list[i].value.ptr, 1, list[i].value.len, stdout);
+        putchar('\n');
+    }
+    free(t.slot);
+    json_free(&ix);
+    unmap_input(&in);
+    return 0;
+}
+
+/* FNV-1a: short values, like these, hash well with it */
+static uint64_t hash(struct strview v)
+{
+    uint64_t h = 0xcbf29ce484222325ULL;
+    size_t i;
+
+    for (i = 0; i < v.len; i++)
+        h = (h ^ (unsigned char)v.ptr[i]) * 0x100000001b3ULL;
+    return h;
+}
+
+/* the slot for v in a table of size slots: its own, or the empty one
+ * where it would go */
+static struct tally *find(struct tally *slot, size_t size, struct strview v)
+{
+    size_t i;
+
+    for (i = hash(v) & (size - 1); slot[i].count > 0; i = (i + 1) & (size - 1))
+        if (sv_eq(slot[i].value, v))
+            break;
+    return &slot[i];
+}
+
+/* count one more of the value at entry k; return 1 if out of memory */
+static int tally_value(const struct jsonidx *ix, size_t k, void *arg)
+{
+    struct table *t = arg;
+    struct tally *s, *bigger;
+    struct strview v = json_value(ix, k);
+    size_t i, size;
+
+    if (2 * (t->used + 1) > t->size) {
+        size = t->size > 0 ? 2 * t->size : 64;
+        if ((bigger = calloc(size, sizeof(bigger[0]))) == NULL)
+            return 1;
+        for (i = 0; i < t->size; i++)
+            if (t->slot[i].count > 0)
+                *find(bigger, size, t->slot[i].value) = t->slot[i];
+        free(t->slot);
+        t->slot = bigger;
+        t->size = size;
+    }
+    s = find(t->slot, t->size, v);
+    if (s->count++ == 0) {
+        s->value = v;
+        t->used++;
+    }
+    t->total++;
+    return 0;
+}
+
+static int count_value(const struct jsonidx *ix, size_t k, void *arg)
+{
+    struct table *t = arg;
+
+    (void)ix;
+    (void)k;
+    t->total++;
+    return 0;
+}
+
+/* most often first; of two that come up as often, the first in order */
+static int by_count(const void *a, const void *b)
+{
+    const struct tally *x = a, *y = b;
+
+    if (x->count != y->count)
+        return x->count < y->count ? 1 : -1;
+    return sv_cmp(x->value, y->value);
+}
+
+static int by_value(const void *a, const void *b)
+{
+    return sv_cmp(((const struct tally *)a)->value, ((const struct tally *)b)->value);
+}
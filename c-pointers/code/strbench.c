@@ -0,0 +1,255 @@
+/* check faststr.c against glibc, then benchmark the string routines of
+ * chars.c against faststr.c and glibc for string lengths from 1 byte to
+ * 64 KiB.
+ *
+ * usage: strbench [iterations-scale]
+ * Every line reports nanoseconds per call; smaller is better. strcmp
+ * compares equal strings, strdiff strings that differ halfway.
+ */
+#define _GNU_SOURCE 1
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "benchutil.h"
+#include "faststr.h"
+
+/* reuse the byte-at-a-time versions from chars.c as they are;
+ * renaming its main keeps it out of the way of ours */
+#define main chars_main
+#include "chars.c"
+#undef main
+
+#define MAXLEN (64 * 1024)
+#define WORK   (64L * 1024 * 1024)  /* bytes processed per measurement */
+
+/* K&R's pointer-difference strlen, the baseline for fstrlen */
+static size_t pstrlen(char *s)
+{
+    char *p = s;
+
+    while (*p != '\0')
+        p++;
+    return p - s;
+}
+
+/* keeps the compiler from throwing away results we never look at */
+static volatile size_t sink;
+
+enum { STRLEN, STRCPY, STRCMP, MEMCHR, STRDIFF };
+
+/* run one routine reps times; return nanoseconds per call */
+static double run(int op, int which, char *dst, char *src, char *same,
+                  size_t len, long reps)
+{
+    double start;
+    long r;
+
+    start = now();
+    for (r = 0; r < reps; r++) {
+        switch (op * 4 + which) {
+        case STRLEN * 4 + 0: sink += pstrlen(src); break;
+        case STRLEN * 4 + 1: sink += fstrlen_swar(src); break;
+        case STRLEN * 4 + 2: sink += fstrlen(src); break;
+        case STRLEN * 4 + 3: sink += strlen(src); break;
+        case STRCPY * 4 + 0: pstrcpy(dst, src); break;
+        case STRCPY * 4 + 1: fstrcpy_swar(dst, src); break;
+        case STRCPY * 4 + 2: fstrcpy(dst, src); break;
+        case STRCPY * 4 + 3: strcpy(dst, src); break;
+        case STRCMP * 4 + 0: sink += pstrcmp(same, src); break;
+        case STRCMP * 4 + 1: sink += fstrcmp_swar(same, src); break;
+        case STRCMP * 4 + 2: sink += fstrcmp(same, src); break;
+        case STRCMP * 4 + 3: sink += strcmp(same, src); break;
+        case STRDIFF * 4 + 0: sink += pstrcmp(same, src); break;
+        case STRDIFF * 4 + 1: sink += fstrcmp_swar(same, src); break;
+        case STRDIFF * 4 + 2: sink += fstrcmp(same, src); break;
+        case STRDIFF * 4 + 3: sink += strcmp(same, src); break;
+        /* chars.c has no memchr; scanning for '\0' is the same byte loop */
+        case MEMCHR * 4 + 0: sink += pstrlen(src); break;
+        case MEMCHR * 4 + 1: sink += (size_t)fmemchr_swar(src, '\0', len + 1); break;
+        case MEMCHR * 4 + 2: sink += (size_t)fmemchr(src, '\0', len + 1); break;
+        case MEMCHR * 4 + 3: sink += (size_t)memchr(src, '\0', len + 1); break;
+        }
+        __asm__ volatile("" ::: "memory");
+    }
+    return (now() - start) * 1e9 / reps;
+}
+
+/* one set of faststr routines */
+struct faststr {
+    const char *name;
+    size_t (*len)(const char *);
+    char *(*cpy)(char *, const char *);
+    int (*cmp)(const char *, const char *);
+    void *(*chr)(const void *, int, size_t);
+};
+
+#define CHECKPAGES 3    /* pages of string before each guard page */
+#define CHECKEDGE 40    /* positions near each end of a long string */
+
+static int sign(int x)
+{
+    return (x > 0) - (x < 0);
+}
+
+/* CHECKPAGES pages followed by one that faults when touched;
+ * returns the end of the ones that can be touched */
+static char *guarded(size_t page)
+{
+    char *p = mmap(NULL, (CHECKPAGES + 1) * page, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (p == MAP_FAILED || mprotect(p + CHECKPAGES * page, page, PROT_NONE) < 0)
+        return NULL;
+    return p + CHECKPAGES * page;
+}
+
+/* f on the len bytes at s (and their '\0') against libc, with t as room
+ * for a second string and d for a copy; returns the routine that
+ * disagrees, or NULL. Every position of a short string gets a t that
+ * differs there, above, below and by ending; long ones only near the
+ * ends and every 29th. s has no byte 0xFF, so memchr of it scans to
+ * the end. */
+static const char *check_one(const struct faststr *f, const char *s, size_t len,
+                             char *t, char *d)
+{
+    size_t k;
+    int c, delta;
+
+    if (f->len(s) != len)
+        return "fstrlen";
+    memset(d, 0x55, len + 64);
+    if (f->cpy(d, s) != d || memcmp(d, s, len + 1) != 0 || d[len + 1] != 0x55
+        || memcmp(d + len + 1, d + len + 2, 62) != 0)
+        return "fstrcpy";
+    if (f->chr(s, 0xFF, len + 1) != NULL || f->chr(s, '\0', len + 1) != s + len)
+        return "fmemchr";
+    memcpy(t, s, len + 1);
+    if (f->cmp(s, t) != 0)
+        return "fstrcmp";
+    for (k = 0; k <= len; k++) {
+        if (len > 2 * CHECKEDGE && k >= CHECKEDGE && len - k >= CHECKEDGE && k % 29 != 0)
+            continue;
+        c = (unsigned char)s[k];
+        if (f->chr(s, c, len + 1) != memchr(s, c, len + 1)
+            || f->chr(s, c + 256, len + 1) != memchr(s, c + 256, len + 1)
+            || f->chr(s, c, k) != memchr(s, c, k))
+            return "fmemchr";
+        for (delta = -1; delta <= 1; delta += 2) {
+            t[k] = k == len ? 'x' : c + delta == 0 ? 0xFE : c + delta;
+            if (k == len)
+                t[k + 1] = '\0';
+            if (sign(f->cmp(s, t)) != sign(strcmp(s, t))
+                || sign(f->cmp(t, s)) != sign(strcmp(t, s)))
+                return "fstrcmp";
+            t[k] = '\0';
+            if (sign(f->cmp(s, t)) != sign(strcmp(s, t))
+                || sign(f->cmp(t, s)) != sign(strcmp(t, s)))
+                return "fstrcmp";
+            t[k] = s[k];
+        }
+    }
+    return NULL;
+}
+
+/* f against libc on strings starting at every offset within 64 bytes,
+ * and on strings ending at every offset within 64 bytes of the end of a
+ * page with nothing behind it; random bytes, half of them above 0x7F */
+static int check(const struct faststr *f, size_t page)
+{
+    static const size_t lens[] = { 95, 96, 97, 127, 128, 129, 255, 256, 257, 1000, 4095, 4096, 4097 };
+    static char *a, *b, *dst;
+    static char *src;
+    const char *bad = NULL;
+    uint64_t seed = 42;
+    size_t len, i, n;
+    int off;
+
+    if (a == NULL && ((a = guarded(page)) == NULL || (b = guarded(page)) == NULL
+                      || (dst = malloc(CHECKPAGES * page + 128)) == NULL
+                      || (src = malloc(CHECKPAGES * page)) == NULL)) {
+        perror("strbench");
+        return 1;
+    }
+    for (n = 0; n <= 80 + sizeof(lens) / sizeof(lens[0]) && bad == NULL; n++) {
+        len = n <= 80 ? n : lens[n - 81];
+        for (i = 0; i < len; i++)
+            src[i] = 1 + next_random(&seed) % 254;
+        src[len] = '\0';
+        for (off = 0; off < 64 && bad == NULL; off++) {
+            memcpy(a - CHECKPAGES * page + off, src, len + 1);
+            bad = check_one(f, a - CHECKPAGES * page + off, len, b - len - 2 - off % 7, dst + off);
+            if (bad == NULL) {
+                memcpy(a - len - 1 - off, src, len + 1);
+                bad = check_one(f, a - len - 1 - off, len, b - CHECKPAGES * page + 64 - off, dst + 63 - off);
+            }
+        }
+    }
+    if (bad != NULL)
+        printf("strbench: %s%s disagrees with libc at length %zu\n", bad, f->name, len);
+    return bad != NULL;
+}
+
+int main(int argc, char *argv[])
+{
+    static const struct faststr fast[] = {
+        { "_swar", fstrlen_swar, fstrcpy_swar, fstrcmp_swar, fmemchr_swar },
+#ifdef FASTSTR_AVX2
+        { "_avx2", fstrlen_avx2, fstrcpy_avx2, fstrcmp_avx2, fmemchr_avx2 },
+#endif
+        { "", fstrlen, fstrcpy, fstrcmp, fmemchr },
+    };
+    static const char *opname[] = { "strlen", "strcpy", "strcmp", "memchr", "strdiff" };
+    char *src, *same, *dst;
+    double scale = 1.0;
+    size_t len, i;
+    long reps;
+    int op;
+
+    if (argc > 1 && (scale = atof(argv[1])) <= 0) {
+        printf("Usage: strbench [iterations-scale]\n");
+        return 1;
+    }
+    for (i = 0; i < sizeof(fast) / sizeof(fast[0]); i++) {
+#ifdef FASTSTR_AVX2
+        if (fast[i].len == fstrlen_avx2 && !__builtin_cpu_supports("avx2"))
+            continue;
+#endif
+        if (check(&fast[i], sysconf(_SC_PAGESIZE)) != 0)
+            return 1;
+    }
+    /* odd offsets so the strings start unaligned, as they usually do */
+    src = malloc(MAXLEN + 64);
+    same = malloc(MAXLEN + 64);
+    dst = malloc(MAXLEN + 64);
+    if (src == NULL || same == NULL || dst == NULL) {
+        perror("strbench");
+        return 1;
+    }
+    src += 3;
+    same += 5;
+    dst += 1;
+
+    printf("%-7s %8s %10s %10s %10s %10s\n",
+           "op", "len", "chars.c", "swar", "fast", "glibc");
+    for (op = STRLEN; op <= STRDIFF; op++)
+        for (len = 1; len <= MAXLEN; len *= 4) {
+            for (i = 0; i < len; i++)
+                src[i] = 'a' + i % 26;
+            src[len] = '\0';
+            memcpy(same, src, len + 1);
+            if (op == STRDIFF)
+                same[len / 2] ^= 1;
+            reps = (long)(scale * WORK / (len + 16));
+            if (reps < 1)
+                reps = 1;
+            printf("%-7s %8zu %10.1f %10.1f %10.1f %10.1f\n", opname[op], len,
+                   run(op, 0, dst, src, same, len, reps),
+                   run(op, 1, dst, src, same, len, reps),
+                   run(op, 2, dst, src, same, len, reps),
+                   run(op, 3, dst, src, same, len, reps));
+        }
+    return 0;
+}
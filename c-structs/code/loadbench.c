@@ -0,0 +1,168 @@
+/* compare getting points, rectangles and an rtree ready to query from
+ * text, which has to be parsed and the tree built, with opening a
+ * ptfile, which is mapped and used where it lies.
+ *
+ * usage: loadbench [Mpoints]
+ * Writes a text file and a ptfile of the same data to /tmp, checks the
+ * ptfile reads back the same, times both ways of loading, and removes
+ * the files.
+ */
+#define _GNU_SOURCE 1
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "benchutil.h"
+#include "ptfile.h"
+
+#define REPS   5
+#define NQUERY 1000
+
+/* load the text at path as ptconv -t does; return 0 on success */
+static int load_text(const char *path, struct points *ps, struct rect **r,
+                     size_t *nrect, struct rtree *t)
+{
+    struct input in;
+    size_t line;
+    int fd, rc;
+
+    if ((fd = open(path, O_RDONLY)) < 0 || map_input(fd, &in) < 0)
+        return -1;
+    close(fd);
+    ps->n = 0;
+    rc = ptfile_parse(in.p, in.n, ps, r, nrect, &line);
+    unmap_input(&in);
+    if (rc == 0 && (rc = rtree_build(t, *r, *nrect)) < 0)
+        free(*r);
+    return rc;
+}
+
+/* return 1 if f holds the points ps, the nrect rectangles at r, and a
+ * tree giving the same answers as t */
+static int same(const struct ptfile *f, const struct points *ps,
+                const struct rect *r, size_t nrect, const struct rtree *t)
+{
+    struct rthits a = { 0 }, b = { 0 };
+    struct point p[NQUERY];
+    size_t i;
+    int ok;
+
+    if (f->pts.n != ps->n || f->nrect != nrect || f->tree.node == NULL
+        || memcmp(f->pts.x, ps->x, ps->n * sizeof(int)) != 0
+        || memcmp(f->pts.y, ps->y, ps->n * sizeof(int)) != 0)
+        return 0;
+    for (i = 0; i < nrect; i++)
+        if (memcmp(&r[i], &(struct rect){ { f->x1[i], f->y1[i] },
+                                          { f->x2[i], f->y2[i] } },
+                   sizeof(r[i])) != 0)
+            return 0;
+    for (i = 0; i < NQUERY; i++)
+        p[i] = (struct point){ ps->x[i % ps->n], ps->y[i % ps->n] };
+    ok = rtree_stab(t, p, NQUERY, &a) == 0 && rtree_stab(&f->tree, p, NQUERY, &b) == 0
+         && a.n == b.n && memcmp(a.id, b.id, a.n * sizeof(a.id[0])) == 0
+         && memcmp(a.first, b.first, (NQUERY + 1) * sizeof(a.first[0])) == 0;
+    rthits_free(&a);
+    rthits_free(&b);
+    return ok;
+}
+
+int main(int argc, char *argv[])
+{
+    char text[] = "/tmp/loadbenchXXXXXX", bin[] = "/tmp/loadbenchXXXXXX";
+    struct points ps;
+    struct rect *r, *r2;
+    struct rtree t, t2;
+    struct ptfile f;
+    const char *err;
+    uint64_t seed = 1;
+    size_t n, nrect, nrect2, i;
+    double t0, best[3];
+    long long sum = 0;
+    FILE *fp;
+    int fd[2], rep;
+
+    n = (size_t)(argc > 1 ? atol(argv[1]) : 4) * 1000000;
+    nrect = n / 10;
+    if (n == 0) {
+        printf("Usage: loadbench [Mpoints]\n");
+        return 1;
+    }
+    if (points_init(&ps, n) < 0 || (r = malloc(nrect * sizeof(r[0]))) == NULL) {
+        perror("loadbench");
+        return 1;
+    }
+    for (i = 0; i < n; i++)
+        points_add(&ps, (struct point){ (int)(next_random(&seed) % 2000001) - 1000000,
+                                        (int)(next_random(&seed) % 2000001) - 1000000 });
+    for (i = 0; i < nrect; i++) {
+        r[i].pt1.x = (int)(next_random(&seed) % 2000001) - 1000000;
+        r[i].pt1.y = (int)(next_random(&seed) % 2000001) - 1000000;
+        r[i].pt2.x = r[i].pt1.x + next_random(&seed) % 10000;
+        r[i].pt2.y = r[i].pt1.y + next_random(&seed) % 10000;
+    }
+    if ((fd[0] = mkstemp(text)) < 0 || (fd[1] = mkstemp(bin)) < 0
+        || (fp = fdopen(fd[0], "w")) == NULL) {
+        perror("loadbench");
+        return 1;
+    }
+    for (i = 0; i < n; i++)
+        fprintf(fp, "p %d %d\n", ps.x[i], ps.y[i]);
+    for (i = 0; i < nrect; i++)
+        fprintf(fp, "r %d %d %d %d\n", r[i].pt1.x, r[i].pt1.y, r[i].pt2.x, r[i].pt2.y);
+    if (fclose(fp) != 0 || rtree_build(&t, r, nrect) < 0
+        || (fp = fdopen(fd[1], "w")) == NULL
+        || ptfile_write(fp, &ps, r, nrect, &t) < 0 || fclose(fp) != 0) {
+        perror("loadbench");
+        return 1;
+    }
+    if ((err = ptfile_open(&f, bin)) != NULL) {
+        fprintf(stderr, "loadbench: %s: %s\n", bin, err);
+        return 1;
+    }
+    if (!same(&f, &ps, r, nrect, &t)) {
+        printf("loadbench: the ptfile does not read back the same\n");
+        return 1;
+    }
+    ptfile_close(&f);
+
+    for (i = 0; i < 3; i++)
+        best[i] = 1e9;
+    for (rep = 0; rep < REPS; rep++) {
+        t0 = now();
+        if (load_text(text, &ps, &r2, &nrect2, &t2) < 0) {
+            perror(text);
+            return 1;
+        }
+        t0 = now() - t0;
+        best[0] = t0 < best[0] ? t0 : best[0];
+        rtree_free(&t2);
+        free(r2);
+
+        t0 = now();
+        ptfile_open(&f, bin);
+        t0 = now() - t0;
+        best[1] = t0 < best[1] ? t0 : best[1];
+        ptfile_close(&f);
+
+        /* opening maps the pages; reading every point brings them in */
+        t0 = now();
+        ptfile_open(&f, bin);
+        for (i = 0; i < f.pts.n; i++)
+            sum += f.pts.x[i] + f.pts.y[i];
+        t0 = now() - t0;
+        best[2] = t0 < best[2] ? t0 : best[2];
+        ptfile_close(&f);
+    }
+    printf("%zu M points, %zu K rectangles, best of %d (files in page cache)\n",
+           n / 1000000, nrect / 1000, REPS);
+    printf("text: parse, build tree  %9.3f ms\n", best[0] * 1e3);
+    printf("ptfile: open             %9.3f ms\n", best[1] * 1e3);
+    printf("ptfile: open, read all   %9.3f ms\n", best[2] * 1e3);
+    unlink(text);
+    unlink(bin);
+    rtree_free(&t);
+    free(r);
+    points_free(&ps);
+    return sum == 42;       /* so the reading is not optimized away */
+}
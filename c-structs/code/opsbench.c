@@ -0,0 +1,179 @@
+/* check the bulk point operations against doing each point on its own,
+ * as structs.c does, for several thread counts, then compare their speed.
+ *
+ * usage: opsbench [Mpoints]
+ */
+#define _GNU_SOURCE 1
+#include <limits.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "benchutil.h"
+#include "parallel.h"
+#include "pointops.h"
+
+#define REPS   5
+#define NCHECK 600000       /* enough points for 8 threads' shares */
+
+/* structs.c's addpoint, wrapping around instead of overflowing */
+static struct point addpoint(struct point p1, struct point p2)
+{
+    p1.x = (int)((unsigned)p1.x + (unsigned)p2.x);
+    p1.y = (int)((unsigned)p1.y + (unsigned)p2.y);
+    return p1;
+}
+
+static int scalepoint1(int v, double s)
+{
+    double r = nearbyint(v * s);
+
+    return r >= INT_MAX ? INT_MAX : r <= INT_MIN ? INT_MIN : (int)r;
+}
+
+/* structs.c's distance, from c instead of the origin */
+static double distance(struct point p, struct point c)
+{
+    double dx = (double)p.x - c.x, dy = (double)p.y - c.y;
+
+    return sqrt(dx * dx + dy * dy);
+}
+
+/* fill p and ps with the same n points; with wide, anywhere an int can
+ * be, with some at the very ends */
+static void fill(struct point *p, struct points *ps, size_t n, int wide,
+                 uint64_t seed)
+{
+    size_t i;
+
+    ps->n = 0;
+    for (i = 0; i < n; i++) {
+        p[i].x = (int)next_random(&seed);
+        p[i].y = (int)next_random(&seed);
+        if (!wide) {
+            p[i].x %= 10000;
+            p[i].y %= 10000;
+        }
+        if (wide && i % 97 == 0)
+            p[i].x = i % 2 ? INT_MAX : INT_MIN;
+        points_add(ps, p[i]);
+    }
+}
+
+/* return 1 if ps holds the points at p */
+static int same(const struct points *ps, const struct point *p)
+{
+    size_t i;
+
+    for (i = 0; i < ps->n; i++)
+        if (ps->x[i] != p[i].x || ps->y[i] != p[i].y)
+            return 0;
+    return 1;
+}
+
+/* compare each operation with doing one point at a time, for several
+ * thread counts; return the number of disagreements */
+static int check(void)
+{
+    static struct point p[NCHECK], q[NCHECK];
+    static double want[NCHECK], got[NCHECK];
+    struct points ps;
+    struct point d = { 123456789, -987654321 }, c = { 1000, -2000 };
+    size_t i, n, best;
+    double s[] = { 0.5, -2.5, 3e9, 1.0 / 3 };
+    int nthreads, wide, k, bad = 0;
+
+    if (points_init(&ps, NCHECK) < 0)
+        return 1;
+    for (nthreads = 1; nthreads <= 8; nthreads++)
+        for (wide = 0; wide < 2; wide++) {
+            n = NCHECK - nthreads * 7;
+            fill(p, &ps, n, wide, nthreads + 1);
+            points_translate(&ps, d, nthreads);
+            for (i = 0; i < n; i++)
+                q[i] = addpoint(p[i], d);
+            bad += !same(&ps, q);
+            for (k = 0; k < (int)(sizeof(s) / sizeof(s[0])); k++) {
+                fill(p, &ps, n, wide, nthreads + 1);
+                points_scale(&ps, s[k], nthreads);
+                for (i = 0; i < n; i++) {
+                    q[i].x = scalepoint1(p[i].x, s[k]);
+                    q[i].y = scalepoint1(p[i].y, s[k]);
+                }
+                bad += !same(&ps, q);
+            }
+            fill(p, &ps, n, wide, nthreads + 1);
+            points_dist(&ps, c, got, nthreads);
+            for (best = i = 0; i < n; i++) {
+                want[i] = distance(p[i], c);
+                if (want[i] < want[best])
+                    best = i;
+            }
+            bad += memcmp(want, got, n * sizeof(want[0])) != 0;
+            bad += points_nearest(&ps, c, nthreads) != best;
+            /* many points as near as each other: the first must win */
+            for (i = 0; i < n; i++) {
+                ps.x[i] = i % 3 == 1 ? c.x : c.x + 1;
+                ps.y[i] = c.y;
+            }
+            bad += points_nearest(&ps, c, nthreads) != 1;
+        }
+    ps.n = 0;
+    bad += points_nearest(&ps, c, 1) != 0;
+    points_free(&ps);
+    return bad;
+}
+
+int main(int argc, char *argv[])
+{
+    struct point *p, c = { 3, 4 }, d = { 1, -1 };
+    struct points ps;
+    double *dist, t, best;
+    size_t n, i, near = 0;
+    int nthreads, maxthreads, rep;
+
+    n = (size_t)(argc > 1 ? atol(argv[1]) : 16) * 1000000;
+    if (n == 0) {
+        printf("Usage: opsbench [Mpoints]\n");
+        return 1;
+    }
+    if (check() != 0) {
+        printf("opsbench: a bulk operation disagrees with one point at a time\n");
+        return 1;
+    }
+    p = malloc(n * sizeof(p[0]));
+    dist = malloc(n * sizeof(dist[0]));
+    if (p == NULL || dist == NULL || points_init(&ps, n) < 0) {
+        perror("opsbench");
+        return 1;
+    }
+    fill(p, &ps, n, 0, 1);
+    maxthreads = cpu_count();
+
+#define TIME(name, nth, stmt)                                                 \
+    do {                                                                      \
+        for (best = 1e9, rep = 0; rep < REPS; rep++) {                        \
+            t = now();                                                        \
+            stmt;                                                             \
+            t = now() - t;                                                    \
+            best = t < best ? t : best;                                       \
+        }                                                                     \
+        printf("%-16s %2d thread%s %8.1f Mpoints/s\n", name, nth,             \
+               nth == 1 ? " " : "s", n / best / 1e6);                         \
+    } while (0)
+
+    printf("%zu M points, best of %d\n", n / 1000000, REPS);
+    TIME("addpoint", 1, for (i = 0; i < n; i++) p[i] = addpoint(p[i], d));
+    TIME("distance", 1, for (i = 0; i < n; i++) dist[i] = distance(p[i], c));
+    for (nthreads = 1; nthreads <= maxthreads; nthreads *= 2) {
+        TIME("points_translate", nthreads, points_translate(&ps, d, nthreads));
+        TIME("points_scale", nthreads, points_scale(&ps, 1.0, nthreads));
+        TIME("points_dist", nthreads, points_dist(&ps, c, dist, nthreads));
+        TIME("points_nearest", nthreads, near = points_nearest(&ps, c, nthreads));
+    }
+    printf("nearest (%d,%d) is point %zu\n", c.x, c.y, near);
+    free(p);
+    free(dist);
+    points_free(&ps);
+    return 0;
+}
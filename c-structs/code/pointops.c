@@ -0,0 +1,255 @@
+#include <limits.h>
+#include <math.h>
+#include "parallel.h"
+#include "pointops.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#define MINSHARE (1 << 16)  /* fewest points worth a thread */
+
+enum op {
+    TRANSLATE,              /* p += c */
+    SCALE,                  /* p *= s */
+    DIST,                   /* dist[i] = |p - c| */
+    NEAREST                 /* the p with the smallest |p - c| */
+};
+
+/* one thread's share of the points */
+struct opjob {
+    enum op op;
+    int *x, *y;
+    size_t first, last;     /* points [first, last) */
+    struct point c;
+    double s;
+    double *dist;
+    size_t best;            /* NEAREST: the answer for this share, */
+    double bestd2;          /* and its squared distance */
+};
+
+/* v * s rounded to the nearest int, or to INT_MIN or INT_MAX if it is
+ * out of range */
+static int scale1(int v, double s)
+{
+    double r = nearbyint(v * s);
+
+    return r >= INT_MAX ? INT_MAX : r <= INT_MIN ? INT_MIN : (int)r;
+}
+
+/* do job's op to points [i, last), one at a time */
+static void op_scalar(struct opjob *job, size_t i)
+{
+    double dx, dy, d2;
+
+    for ( ; i < job->last; i++)
+        switch (job->op) {
+        case TRANSLATE:
+            /* wraps around, as the vector adds do, where addpoint's
+             * int overflow would be undefined */
+            job->x[i] = (int)((unsigned)job->x[i] + (unsigned)job->c.x);
+            job->y[i] = (int)((unsigned)job->y[i] + (unsigned)job->c.y);
+            break;
+        case SCALE:
+            job->x[i] = scale1(job->x[i], job->s);
+            job->y[i] = scale1(job->y[i], job->s);
+            break;
+        case DIST:
+            dx = (double)job->x[i] - job->c.x;
+            dy = (double)job->y[i] - job->c.y;
+            job->dist[i] = sqrt(dx * dx + dy * dy);
+            break;
+        case NEAREST:
+            dx = (double)job->x[i] - job->c.x;
+            dy = (double)job->y[i] - job->c.y;
+            d2 = dx * dx + dy * dy;
+            if (d2 < job->bestd2) {
+                job->bestd2 = d2;
+                job->best = i;
+            }
+            break;
+        }
+}
+
+#if defined(__x86_64__)
+/* 8 ints to 8 doubles in two registers */
+__attribute__((target("avx2")))
+static inline void widen(const int *p, __m256d *lo, __m256d *hi)
+{
+    *lo = _mm256_cvtepi32_pd(_mm_loadu_si128((const __m128i *)p));
+    *hi = _mm256_cvtepi32_pd(_mm_loadu_si128((const __m128i *)(p + 4)));
+}
+
+/* 8 whole doubles, already in int range, back to 8 ints */
+__attribute__((target("avx2")))
+static inline void narrow(int *p, __m256d lo, __m256d hi)
+{
+    _mm256_storeu_si256((__m256i *)p,
+                        _mm256_set_m128i(_mm256_cvtpd_epi32(hi),
+                                         _mm256_cvtpd_epi32(lo)));
+}
+
+/* the same 8 points at a time, the doubles 4 to a register, doing the
+ * same operations in the same order as op_scalar so the results are
+ * identical; return how far it got */
+__attribute__((target("avx2")))
+static size_t op_avx2(struct opjob *job)
+{
+    __m256i cx = _mm256_set1_epi32(job->c.x), cy = _mm256_set1_epi32(job->c.y);
+    __m256d dcx = _mm256_set1_pd(job->c.x), dcy = _mm256_set1_pd(job->c.y);
+    __m256d s = _mm256_set1_pd(job->s);
+    __m256d lo = _mm256_set1_pd(INT_MIN), hi = _mm256_set1_pd(INT_MAX);
+    __m256d x[2], y[2], d2, lt, best[2];
+    __m256i idx[2], bestidx[2], step = _mm256_set1_epi64x(8);
+    double bd[8];
+    long long bi[8];
+    size_t i;
+    int k;
+
+    for (k = 0; k < 2; k++) {
+        best[k] = _mm256_set1_pd(INFINITY);
+        bestidx[k] = _mm256_setzero_si256();
+    }
+    idx[0] = _mm256_setr_epi64x(job->first, job->first + 1, job->first + 2,
+                                job->first + 3);
+    idx[1] = _mm256_add_epi64(idx[0], _mm256_set1_epi64x(4));
+    for (i = job->first; i + 8 <= job->last; i += 8) {
+        switch (job->op) {
+        case TRANSLATE:
+            _mm256_storeu_si256((__m256i *)(job->x + i), _mm256_add_epi32(cx,
+                _mm256_loadu_si256((const __m256i *)(job->x + i))));
+            _mm256_storeu_si256((__m256i *)(job->y + i), _mm256_add_epi32(cy,
+                _mm256_loadu_si256((const __m256i *)(job->y + i))));
+            continue;
+        case SCALE:
+            widen(job->x + i, &x[0], &x[1]);
+            widen(job->y + i, &y[0], &y[1]);
+            for (k = 0; k < 2; k++) {
+                x[k] = _mm256_round_pd(_mm256_mul_pd(x[k], s),
+                           _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+                x[k] = _mm256_min_pd(_mm256_max_pd(x[k], lo), hi);
+                y[k] = _mm256_round_pd(_mm256_mul_pd(y[k], s),
+                           _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+                y[k] = _mm256_min_pd(_mm256_max_pd(y[k], lo), hi);
+            }
+            narrow(job->x + i, x[0], x[1]);
+            narrow(job->y + i, y[0], y[1]);
+            continue;
+        case DIST:
+        case NEAREST:
+            break;
+        }
+        widen(job->x + i, &x[0], &x[1]);
+        widen(job->y + i, &y[0], &y[1]);
+        for (k = 0; k < 2; k++) {
+            x[k] = _mm256_sub_pd(x[k], dcx);
+            y[k] = _mm256_sub_pd(y[k], dcy);
+            d2 = _mm256_add_pd(_mm256_mul_pd(x[k], x[k]),
+                               _mm256_mul_pd(y[k], y[k]));
+            if (job->op == DIST) {
+                _mm256_storeu_pd(job->dist + i + 4 * k, _mm256_sqrt_pd(d2));
+                continue;
+            }
+            /* each lane keeps its own nearest; only a strictly nearer
+             * point replaces it, so ties go to the earliest */
+            lt = _mm256_cmp_pd(d2, best[k], _CMP_LT_OQ);
+            best[k] = _mm256_blendv_pd(best[k], d2, lt);
+            bestidx[k] = _mm256_castpd_si256(_mm256_blendv_pd(
+                _mm256_castsi256_pd(bestidx[k]), _mm256_castsi256_pd(idx[k]), lt));
+            idx[k] = _mm256_add_epi64(idx[k], step);
+        }
+    }
+    if (job->op == NEAREST) {
+        _mm256_storeu_pd(bd, best[0]);
+        _mm256_storeu_pd(bd + 4, best[1]);
+        _mm256_storeu_si256((__m256i *)bi, bestidx[0]);
+        _mm256_storeu_si256((__m256i *)(bi + 4), bestidx[1]);
+        for (k = 0; k < 8; k++)
+            if (bd[k] < job->bestd2
+                || (bd[k] == job->bestd2 && (size_t)bi[k] < job->best)) {
+                job->bestd2 = bd[k];
+                job->best = bi[k];
+            }
+    }
+    return i;
+}
+#endif
+
+static void *op_job(void *arg)
+{
+    struct opjob *job = arg;
+    size_t done = job->first;
+
+#if defined(__x86_64__)
+    if (__builtin_cpu_supports("avx2"))
+        done = op_avx2(job);
+#endif
+    op_scalar(job, done);
+    return NULL;
+}
+
+/* do op to the points of ps, split between up to nthreads threads;
+ * return the index of the nearest point for NEAREST */
+static size_t run(enum op op, const struct points *ps, struct point c,
+                  double s, double *dist, int nthreads)
+{
+    struct opjob job[MAXTHREADS];
+    size_t share, best = ps->n;
+    double bestd2 = INFINITY;
+    int i, njobs;
+
+    njobs = job_count(ps->n, MINSHARE, nthreads);
+    share = ps->n / njobs;
+    for (i = 0; i < njobs; i++) {
+        job[i].op = op;
+        job[i].x = ps->x;
+        job[i].y = ps->y;
+        job[i].first = i * share;
+        job[i].last = i < njobs - 1 ? (i + 1) * share : ps->n;
+        job[i].c = c;
+        job[i].s = s;
+        job[i].dist = dist;
+        job[i].best = ps->n;
+        job[i].bestd2 = INFINITY;
+    }
+    run_parallel(op_job, job, sizeof(job[0]), njobs);
+    /* the shares are in order, so the first of equals wins */
+    for (i = 0; i < njobs; i++)
+        if (job[i].bestd2 < bestd2) {
+            bestd2 = job[i].bestd2;
+            best = job[i].best;
+        }
+    return best;
+}
+
+/* move every point of ps by d, as addpoint does; a coordinate that
+ * overflows wraps around */
+void points_translate(struct points *ps, struct point d, int nthreads)
+{
+    run(TRANSLATE, ps, d, 0.0, NULL, nthreads);
+}
+
+/* multiply every coordinate of ps by s, which must be finite, rounding
+ * to the nearest int (an even one when halfway) and clamping to
+ * INT_MIN ... INT_MAX */
+void points_scale(struct points *ps, double s, int nthreads)
+{
+    struct point zero = { 0, 0 };
+
+    run(SCALE, ps, zero, s, NULL, nthreads);
+}
+
+/* set dist[i] to the distance from point i of ps to c; dist must have
+ * room for ps->n doubles */
+void points_dist(const struct points *ps, struct point c, double *dist,
+                 int nthreads)
+{
+    run(DIST, ps, c, 0.0, dist, nthreads);
+}
+
+/* return the index of the point of ps nearest c, the first one if
+ * several are as near, or ps->n if ps is empty */
+size_t points_nearest(const struct points *ps, struct point c, int nthreads)
+{
+    return run(NEAREST, ps, c, 0.0, NULL, nthreads);
+}
@@ -0,0 +1,22 @@
+/* structs.c's point arithmetic over whole sets of points.
+ *
+ * addpoint moves one point and the distance from the origin is worked
+ * out for one point at a time. These do the same to every point of a
+ * struct points, 8 coordinates per AVX2 instruction, splitting big sets
+ * between nthreads threads. Distances are worked out as structs.c does,
+ * turning the coordinates into doubles before subtracting or squaring,
+ * so no int overflows however far apart the points are.
+ */
+#ifndef POINTOPS_H
+#define POINTOPS_H
+
+#include <stddef.h>
+#include "points.h"
+
+void points_translate(struct points *ps, struct point d, int nthreads);
+void points_scale(struct points *ps, double s, int nthreads);
+void points_dist(const struct points *ps, struct point c, double *dist,
+                 int nthreads);
+size_t points_nearest(const struct points *ps, struct point c, int nthreads);
+
+#endif
@@ -0,0 +1,167 @@
+#include <stdlib.h>
+#include "points.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#define CHUNK 4096          /* points ptinrect_index tests between compactions */
+
+/* make ps an empty set with room for cap points; return 0 on success,
+ * -1 if memory runs out */
+int points_init(struct points *ps, size_t cap)
+{
+    ps->n = 0;
+    ps->cap = cap > 16 ? cap : 16;
+    ps->x = malloc(ps->cap * sizeof(ps->x[0]));
+    ps->y = malloc(ps->cap * sizeof(ps->y[0]));
+    if (ps->x == NULL || ps->y == NULL) {
+        points_free(ps);
+        return -1;
+    }
+    return 0;
+}
+
+void points_free(struct points *ps)
+{
+    free(ps->x);
+    free(ps->y);
+    ps->x = ps->y = NULL;
+    ps->n = ps->cap = 0;
+}
+
+/* add p to ps, doubling the room when it runs out; return 0 on success,
+ * -1 if memory runs out */
+int points_add(struct points *ps, struct point p)
+{
+    int *x, *y;
+
+    if (ps->n == ps->cap) {
+        if ((x = realloc(ps->x, 2 * ps->cap * sizeof(x[0]))) == NULL)
+            return -1;
+        ps->x = x;
+        if ((y = realloc(ps->y, 2 * ps->cap * sizeof(y[0]))) == NULL)
+            return -1;
+        ps->y = y;
+        ps->cap *= 2;
+    }
+    ps->x[ps->n] = p.x;
+    ps->y[ps->n] = p.y;
+    ps->n++;
+    return 0;
+}
+
+#if defined(__x86_64__)
+/* set mask[w] for each whole word's worth (64 points) of the n points,
+ * 8 points per compare; return how many points were done.
+ * AVX2 only has signed "greater than", so x >= x1 is tested as
+ * !(x1 > x) and x < x2 as x2 > x: exactly ptinrect's half-open test.
+ */
+__attribute__((target("avx2")))
+static size_t mask_avx2(const int *x, const int *y, size_t n, struct rect r,
+                        uint64_t *mask)
+{
+    __m256i x1 = _mm256_set1_epi32(r.pt1.x), x2 = _mm256_set1_epi32(r.pt2.x);
+    __m256i y1 = _mm256_set1_epi32(r.pt1.y), y2 = _mm256_set1_epi32(r.pt2.y);
+    __m256i vx, vy, inx, iny;
+    uint64_t bits;
+    size_t i;
+    int k;
+
+    for (i = 0; i + 64 <= n; i += 64) {
+        bits = 0;
+        for (k = 0; k < 64; k += 8) {
+            vx = _mm256_loadu_si256((const __m256i *)(x + i + k));
+            vy = _mm256_loadu_si256((const __m256i *)(y + i + k));
+            inx = _mm256_andnot_si256(_mm256_cmpgt_epi32(x1, vx),
+                                      _mm256_cmpgt_epi32(x2, vx));
+            iny = _mm256_andnot_si256(_mm256_cmpgt_epi32(y1, vy),
+                                      _mm256_cmpgt_epi32(y2, vy));
+            /* one bit per point: the sign bit of each 32-bit lane */
+            bits |= (uint64_t)(uint8_t)_mm256_movemask_ps(
+                        _mm256_castsi256_ps(_mm256_and_si256(inx, iny))) << k;
+        }
+        mask[i / 64] = bits;
+    }
+    return i;
+}
+
+/* the same 16 points per compare; AVX-512 compares produce the bits
+ * directly, and each compare only tests lanes the previous one passed */
+__attribute__((target("avx512f")))
+static size_t mask_avx512(const int *x, const int *y, size_t n, struct rect r,
+                          uint64_t *mask)
+{
+    __m512i x1 = _mm512_set1_epi32(r.pt1.x), x2 = _mm512_set1_epi32(r.pt2.x);
+    __m512i y1 = _mm512_set1_epi32(r.pt1.y), y2 = _mm512_set1_epi32(r.pt2.y);
+    __m512i vx, vy;
+    __mmask16 m;
+    uint64_t bits;
+    size_t i;
+    int k;
+
+    for (i = 0; i + 64 <= n; i += 64) {
+        bits = 0;
+        for (k = 0; k < 64; k += 16) {
+            vx = _mm512_loadu_si512(x + i + k);
+            vy = _mm512_loadu_si512(y + i + k);
+            m = _mm512_cmpge_epi32_mask(vx, x1);
+            m = _mm512_mask_cmplt_epi32_mask(m, vx, x2);
+            m = _mm512_mask_cmpge_epi32_mask(m, vy, y1);
+            m = _mm512_mask_cmplt_epi32_mask(m, vy, y2);
+            bits |= (uint64_t)m << k;
+        }
+        mask[i / 64] = bits;
+    }
+    return i;
+}
+#endif
+
+/* set bit i % 64 of mask[i / 64] if point i of the n points is in r,
+ * and clear it if not; bits past n are cleared */
+static void mask_points(const int *x, const int *y, size_t n, struct rect r,
+                        uint64_t *mask)
+{
+    struct point p;
+    size_t i = 0;
+
+#if defined(__x86_64__)
+    if (__builtin_cpu_supports("avx512f"))
+        i = mask_avx512(x, y, n, r, mask);
+    else if (__builtin_cpu_supports("avx2"))
+        i = mask_avx2(x, y, n, r, mask);
+#endif
+    for ( ; i < n; i++) {
+        if (i % 64 == 0)
+            mask[i / 64] = 0;
+        p.x = x[i];
+        p.y = y[i];
+        mask[i / 64] |= (uint64_t)ptinrect(p, r) << (i % 64);
+    }
+}
+
+/* test every point of ps against r: bit i % 64 of mask[i / 64] is set if
+ * point i is in r. mask must have room for (ps->n + 63) / 64 words. */
+void ptinrect_many(const struct points *ps, struct rect r, uint64_t *mask)
+{
+    mask_points(ps->x, ps->y, ps->n, r, mask);
+}
+
+/* store the index of every point of ps that is in r in index[], in
+ * order, and return how many there are; index must have room for
+ * ps->n entries */
+size_t ptinrect_index(const struct points *ps, struct rect r, uint32_t *index)
+{
+    uint64_t mask[CHUNK / 64], bits;
+    size_t start, len, w, k = 0;
+
+    for (start = 0; start < ps->n; start += len) {
+        len = ps->n - start < CHUNK ? ps->n - start : CHUNK;
+        mask_points(ps->x + start, ps->y + start, len, r, mask);
+        for (w = 0; w < (len + 63) / 64; w++)
+            /* take the lowest 1 off until none are left */
+            for (bits = mask[w]; bits != 0; bits &= bits - 1)
+                index[k++] = start + w * 64 + __builtin_ctzll(bits);
+    }
+    return k;
+}
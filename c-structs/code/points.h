@@ -0,0 +1,49 @@
+/* many points at once: a structure of arrays.
+ *
+ * structs.c keeps a point as a struct of its x and y, and an array of
+ * points would be an array of such structs: x, y, x, y, ... To test many
+ * points against the same rectangle, it is faster to keep all the x's in
+ * one array and all the y's in another, so that one vector load fetches
+ * 8 (AVX2) or 16 (AVX-512) x's, and one compare tests them all.
+ */
+#ifndef POINTS_H
+#define POINTS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* the same point and rectangle as in structs.c */
+struct point {
+    int x;
+    int y;
+};
+
+struct rect {
+    struct point pt1;
+    struct point pt2;
+};
+
+/* a growable set of points, x[i] and y[i] being point i */
+struct points {
+    int *x;
+    int *y;
+    size_t n;               /* points in use */
+    size_t cap;             /* points there is room for */
+};
+
+/* return 1 if p in r, 0 if not; as in structs.c, a rectangle includes
+ * its left and bottom sides but not its top and right sides, and pt1's
+ * coordinates are less than pt2's */
+static inline int ptinrect(struct point p, struct rect r)
+{
+    return p.x >= r.pt1.x && p.x < r.pt2.x && p.y >= r.pt1.y && p.y < r.pt2.y;
+}
+
+int points_init(struct points *ps, size_t cap);
+void points_free(struct points *ps);
+int points_add(struct points *ps, struct point p);
+
+void ptinrect_many(const struct points *ps, struct rect r, uint64_t *mask);
+size_t ptinrect_index(const struct points *ps, struct rect r, uint32_t *index);
+
+#endif
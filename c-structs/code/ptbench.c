@@ -0,0 +1,139 @@
+/* check ptinrect_many and ptinrect_index against structs.c's ptinrect
+ * called on one point at a time, then compare their speed.
+ *
+ * usage: ptbench [Mpoints]
+ */
+#define _GNU_SOURCE 1
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "benchutil.h"
+#include "points.h"
+
+#define REPS   5
+#define NCHECK 100000       /* points in the correctness check */
+
+/* a random int in [-range, range] */
+static int coord(uint64_t *seed, int range)
+{
+    return (int)(next_random(seed) % (2 * (uint64_t)range + 1)) - range;
+}
+
+/* fill an array of structs and the same points as a structure of arrays */
+static int fill(struct point *aos, struct points *soa, size_t n, int range,
+                uint64_t seed)
+{
+    size_t i;
+
+    soa->n = 0;
+    for (i = 0; i < n; i++) {
+        aos[i].x = coord(&seed, range);
+        aos[i].y = coord(&seed, range);
+        if (points_add(soa, aos[i]) < 0)
+            return -1;
+    }
+    return 0;
+}
+
+/* the one-at-a-time way, over an array of structs */
+static void mask_aos(const struct point *p, size_t n, struct rect r,
+                     uint64_t *mask)
+{
+    size_t i;
+
+    memset(mask, 0, (n + 63) / 64 * sizeof(mask[0]));
+    for (i = 0; i < n; i++)
+        mask[i / 64] |= (uint64_t)ptinrect(p[i], r) << (i % 64);
+}
+
+/* compare the batched tests with the one-at-a-time ones on many small
+ * rectangles over a small grid, so plenty of points land on the edges;
+ * return the number of disagreements */
+static int check(void)
+{
+    struct point aos[NCHECK];
+    struct points soa;
+    struct rect r;
+    static uint64_t want[(NCHECK + 63) / 64], got[(NCHECK + 63) / 64];
+    static uint32_t index[NCHECK];
+    uint64_t seed = 7;
+    size_t i, j, k, n, nindex;
+    int bad = 0;
+
+    if (points_init(&soa, 0) < 0)
+        return 1;
+    for (k = 0; k < 200; k++) {
+        n = next_random(&seed) % NCHECK;
+        if (fill(aos, &soa, n, 20, k + 1) < 0)
+            return 1;
+        r.pt1.x = coord(&seed, 20);
+        r.pt1.y = coord(&seed, 20);
+        r.pt2.x = r.pt1.x + next_random(&seed) % 20;
+        r.pt2.y = r.pt1.y + next_random(&seed) % 20;
+        mask_aos(aos, n, r, want);
+        ptinrect_many(&soa, r, got);
+        bad += memcmp(want, got, (n + 63) / 64 * sizeof(want[0])) != 0;
+        nindex = ptinrect_index(&soa, r, index);
+        for (i = j = 0; i < n; i++)
+            if (ptinrect(aos[i], r) && (j >= nindex || index[j++] != i))
+                bad++;
+        bad += j != nindex;
+    }
+    points_free(&soa);
+    return bad;
+}
+
+int main(int argc, char *argv[])
+{
+    struct point *aos;
+    struct points soa;
+    struct rect r;
+    uint64_t *mask;
+    uint32_t *index;
+    size_t n, hits = 0;
+    double t, best;
+    int rep;
+
+    n = (size_t)(argc > 1 ? atol(argv[1]) : 16) * 1000000;
+    if (n == 0) {
+        printf("Usage: ptbench [Mpoints]\n");
+        return 1;
+    }
+    if (check() != 0) {
+        printf("ptbench: the batched tests disagree with ptinrect\n");
+        return 1;
+    }
+    aos = malloc(n * sizeof(aos[0]));
+    mask = malloc((n + 63) / 64 * sizeof(mask[0]));
+    index = malloc(n * sizeof(index[0]));
+    if (aos == NULL || mask == NULL || index == NULL || points_init(&soa, n) < 0
+        || fill(aos, &soa, n, 1000, 1) < 0) {
+        perror("ptbench");
+        return 1;
+    }
+    /* a quarter of the points, give or take */
+    r.pt1.x = r.pt1.y = -500;
+    r.pt2.x = r.pt2.y = 500;
+
+#define TIME(name, stmt)                                                      \
+    do {                                                                      \
+        for (best = 1e9, rep = 0; rep < REPS; rep++) {                        \
+            t = now();                                                        \
+            stmt;                                                             \
+            t = now() - t;                                                    \
+            best = t < best ? t : best;                                       \
+        }                                                                     \
+        printf("%-22s %8.1f Mpoints/s\n", name, n / best / 1e6);             \
+    } while (0)
+
+    printf("%zu M points, best of %d\n", n / 1000000, REPS);
+    TIME("ptinrect, one by one", mask_aos(aos, n, r, mask));
+    TIME("ptinrect_many", ptinrect_many(&soa, r, mask));
+    TIME("ptinrect_index", hits = ptinrect_index(&soa, r, index));
+    printf("%zu points in the rectangle\n", hits);
+    free(aos);
+    free(mask);
+    free(index);
+    points_free(&soa);
+    return 0;
+}
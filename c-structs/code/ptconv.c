@@ -0,0 +1,76 @@
+/* ptconv: turn a text file of points and rectangles into a ptfile.
+ *
+ * usage: ptconv [-t] [infile [outfile]]
+ *   -t  also build an rtree over the rectangles and store it
+ * The text has one point ("p x y") or rectangle ("r x1 y1 x2 y2") a
+ * line; see ptfile.h for the file it writes. Without infile/outfile,
+ * ptconv reads standard input and writes standard output.
+ */
+#define _GNU_SOURCE 1
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "ptfile.h"
+
+int main(int argc, char *argv[])
+{
+    struct input text;
+    struct points ps;
+    struct rect *r;
+    struct rtree t;
+    size_t nrect, line;
+    FILE *out = stdout;
+    int c, tree = 0, in = 0, rc = 0;
+
+    while ((c = getopt(argc, argv, "t")) != -1)
+        switch (c) {
+        case 't':
+            tree = 1;
+            break;
+        default:
+            argc = 0;
+            break;
+        }
+    argc -= optind;
+    argv += optind;
+    if (argc < 0 || argc > 2) {
+        fprintf(stderr, "Usage: ptconv [-t] [infile [outfile]]\n");
+        return 1;
+    }
+    if (argc > 0 && (in = open(argv[0], O_RDONLY)) < 0) {
+        perror(argv[0]);
+        return 1;
+    }
+    if (map_input(in, &text) < 0 || points_init(&ps, 0) < 0) {
+        perror("ptconv");
+        return 1;
+    }
+    if (ptfile_parse(text.p, text.n, &ps, &r, &nrect, &line) < 0) {
+        if (line == 0)
+            perror("ptconv");
+        else
+            fprintf(stderr, "ptconv: %s:%zu: not a point or a rectangle\n",
+                    argc > 0 ? argv[0] : "stdin", line);
+        return 1;
+    }
+    unmap_input(&text);
+    if (tree && rtree_build(&t, r, nrect) < 0) {
+        perror("ptconv");
+        return 1;
+    }
+    if (argc > 1 && (out = fopen(argv[1], "wb")) == NULL) {
+        perror(argv[1]);
+        return 1;
+    }
+    if (ptfile_write(out, &ps, r, nrect, tree ? &t : NULL) < 0
+        || fclose(out) != 0) {
+        perror("ptconv");
+        rc = 1;
+    }
+    if (tree)
+        rtree_free(&t);
+    free(r);
+    points_free(&ps);
+    return rc;
+}
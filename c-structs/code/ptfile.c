@@ -0,0 +1,341 @@
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "ptfile.h"
+
+/* a section on its way to a file */
+struct outsection {
+    uint32_t kind;
+    const void *p;
+    size_t size;
+};
+
+static size_t align(size_t n)
+{
+    return (n + PTFILE_ALIGN - 1) / PTFILE_ALIGN * PTFILE_ALIGN;
+}
+
+/* write the points ps, the nrect rectangles at r and, unless t is NULL,
+ * the tree t built over them to fp, which is written straight through
+ * and need not be seekable; return 0 on success, -1 on error */
+int ptfile_write(FILE *fp, const struct points *ps, const struct rect *r,
+                 size_t nrect, const struct rtree *t)
+{
+    static const unsigned char zero[PTFILE_ALIGN];
+    struct ptfile_header h;
+    struct outsection s[PTFILE_MAXSECTION];
+    uint64_t levels[RT_MAXLEVEL + 2];
+    int *col[4] = { NULL };
+    size_t i, offset, ns = 0;
+    int k, err = -1;
+
+    for (k = 0; k < 4; k++)
+        if ((col[k] = malloc(nrect * sizeof(int) + 1)) == NULL)
+            goto out;
+    for (i = 0; i < nrect; i++) {
+        col[0][i] = r[i].pt1.x;
+        col[1][i] = r[i].pt1.y;
+        col[2][i] = r[i].pt2.x;
+        col[3][i] = r[i].pt2.y;
+    }
+    s[ns++] = (struct outsection){ PT_X, ps->x, ps->n * sizeof(int) };
+    s[ns++] = (struct outsection){ PT_Y, ps->y, ps->n * sizeof(int) };
+    for (k = 0; k < 4; k++)
+        s[ns++] = (struct outsection){ RECT_X1 + k, col[k], nrect * sizeof(int) };
+    if (t != NULL && t->nlevel > 0) {
+        levels[0] = t->nrect;
+        for (k = 0; k <= t->nlevel; k++)
+            levels[k + 1] = t->level[k];
+        s[ns++] = (struct outsection){ TREE_NODES, t->node,
+            t->level[t->nlevel] * sizeof(t->node[0]) };
+        s[ns++] = (struct outsection){ TREE_IDS, t->id,
+            (t->level[1] - t->level[0]) * RT_FANOUT * sizeof(t->id[0]) };
+        s[ns++] = (struct outsection){ TREE_LEVELS, levels,
+            (t->nlevel + 2) * sizeof(levels[0]) };
+    }
+
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, PTFILE_MAGIC, sizeof(h.magic));
+    h.version = PTFILE_VERSION;
+    h.order = PTFILE_ORDER;
+    h.npoint = ps->n;
+    h.nrect = nrect;
+    h.nsection = ns;
+    offset = align(sizeof(h));
+    for (i = 0; i < ns; i++) {
+        h.section[i].kind = s[i].kind;
+        h.section[i].offset = offset;
+        h.section[i].size = s[i].size;
+        offset = align(offset + s[i].size);
+    }
+    if (fwrite(&h, sizeof(h), 1, fp) != 1
+        || fwrite(zero, 1, align(sizeof(h)) - sizeof(h), fp)
+           != align(sizeof(h)) - sizeof(h))
+        goto out;
+    for (i = 0; i < ns; i++)
+        if (fwrite(s[i].p, 1, s[i].size, fp) != s[i].size
+            || fwrite(zero, 1, align(s[i].size) - s[i].size, fp)
+               != align(s[i].size) - s[i].size)
+            goto out;
+    err = fflush(fp) == 0 ? 0 : -1;
+out:
+    for (k = 0; k < 4; k++)
+        free(col[k]);
+    return err;
+}
+
+/* return NULL if t, as read from a file of nrect rectangles, can be
+ * searched without reading outside its arrays, or what is wrong */
+static const char *check_tree(const struct rtree *t, size_t nrect,
+                              size_t nodesize, size_t idsize)
+{
+    size_t i, count, below;
+    int l, k;
+
+    if (t->level[0] != 0 || t->level[t->nlevel] * sizeof(t->node[0]) != nodesize)
+        return "damaged tree levels";
+    for (l = 0; l < t->nlevel; l++) {
+        if (t->level[l + 1] <= t->level[l])
+            return "damaged tree levels";
+        count = t->level[l + 1] - t->level[l];
+        below = l == 0 ? t->nrect : t->level[l] - t->level[l - 1];
+        if (count != (below + RT_FANOUT - 1) / RT_FANOUT)
+            return "damaged tree levels";
+        /* the slots past the last child of a level must be empty, or
+         * a search would go past the end of the level below */
+        for (k = below % RT_FANOUT; k > 0 && k < RT_FANOUT; k++)
+            if (t->node[t->level[l + 1] - 1].x1[k] != INT_MAX)
+                return "damaged tree nodes";
+    }
+    if (t->level[t->nlevel] - t->level[t->nlevel - 1] != 1
+        || (t->level[1] * RT_FANOUT) * sizeof(t->id[0]) != idsize
+        || t->nrect > nrect)
+        return "damaged tree levels";
+    for (i = 0; i < t->nrect; i++)
+        if (t->id[i] >= nrect)
+            return "damaged tree ids";
+    return NULL;
+}
+
+/* open the ptfile at path as f; return NULL on success, or what went
+ * wrong. The file is mapped, so opening it costs the same however big
+ * it is, apart from the tree's ids, which are checked once.
+ */
+const char *ptfile_open(struct ptfile *f, const char *path)
+{
+    struct ptfile_header h;
+    const struct ptsection_entry *s;
+    const unsigned char *base;
+    const uint64_t *levels = NULL;
+    const void *col[RECT_Y2 + 1] = { NULL };
+    size_t nodesize = 0, idsize = 0, levelsize = 0, want;
+    uint32_t i;
+    int fd, l;
+    const char *err;
+
+    memset(f, 0, sizeof(*f));
+    if ((fd = open(path, O_RDONLY)) < 0)
+        return strerror(errno);
+    if (map_input(fd, &f->in) < 0) {
+        err = strerror(errno);
+        close(fd);
+        return err;
+    }
+    close(fd);
+    base = f->in.p;
+    /* a file read into memory rather than mapped may not be aligned */
+    if ((uintptr_t)base % PTFILE_ALIGN != 0) {
+        if ((f->copy = aligned_alloc(PTFILE_ALIGN, align(f->in.n))) == NULL) {
+            ptfile_close(f);
+            return strerror(ENOMEM);
+        }
+        memcpy(f->copy, base, f->in.n);
+        base = f->copy;
+    }
+
+    err = "not a ptfile";
+    if (f->in.n < sizeof(h))
+        goto bad;
+    memcpy(&h, base, sizeof(h));
+    if (memcmp(h.magic, PTFILE_MAGIC, sizeof(h.magic)) != 0)
+        goto bad;
+    if (h.order != PTFILE_ORDER) {
+        err = "written on a machine of the other byte order";
+        goto bad;
+    }
+    if (h.version > PTFILE_VERSION) {
+        err = "written by a later version";
+        goto bad;
+    }
+    err = "damaged header";
+    if (h.version == 0 || h.nsection > PTFILE_MAXSECTION
+        || h.npoint > SIZE_MAX / sizeof(int) || h.nrect > SIZE_MAX / sizeof(int))
+        goto bad;
+    for (i = 0; i < h.nsection; i++) {
+        s = &h.section[i];
+        if (s->offset % PTFILE_ALIGN != 0 || s->offset > f->in.n
+            || s->size > f->in.n - s->offset)
+            goto bad;
+        switch (s->kind) {
+        case PT_X:
+        case PT_Y:
+        case RECT_X1:
+        case RECT_Y1:
+        case RECT_X2:
+        case RECT_Y2:
+            want = (s->kind <= PT_Y ? h.npoint : h.nrect) * sizeof(int);
+            if (s->size != want)
+                goto bad;
+            col[s->kind] = base + s->offset;
+            break;
+        case TREE_NODES:
+            f->tree.node = (struct rtnode *)(base + s->offset);
+            nodesize = s->size;
+            break;
+        case TREE_IDS:
+            f->tree.id = (uint32_t *)(base + s->offset);
+            idsize = s->size;
+            break;
+        case TREE_LEVELS:
+            levels = (const uint64_t *)(base + s->offset);
+            levelsize = s->size;
+            break;
+        default:
+            break;          /* from a later version: skip it */
+        }
+    }
+    for (i = PT_X; i <= RECT_Y2; i++)
+        if (col[i] == NULL)
+            goto bad;
+    f->pts.x = (int *)col[PT_X];
+    f->pts.y = (int *)col[PT_Y];
+    f->pts.n = h.npoint;
+    f->x1 = col[RECT_X1];
+    f->y1 = col[RECT_Y1];
+    f->x2 = col[RECT_X2];
+    f->y2 = col[RECT_Y2];
+    f->nrect = h.nrect;
+
+    if (f->tree.node != NULL || f->tree.id != NULL || levels != NULL) {
+        err = "damaged tree levels";
+        if (f->tree.node == NULL || f->tree.id == NULL || levels == NULL
+            || levelsize % sizeof(levels[0]) != 0 || levelsize < 3 * sizeof(levels[0])
+            || levelsize / sizeof(levels[0]) - 2 > RT_MAXLEVEL)
+            goto bad;
+        f->tree.nlevel = levelsize / sizeof(levels[0]) - 2;
+        f->tree.nrect = levels[0];
+        for (l = 0; l <= f->tree.nlevel; l++) {
+            if (levels[l + 1] > nodesize)
+                goto bad;
+            f->tree.level[l] = levels[l + 1];
+        }
+        if ((err = check_tree(&f->tree, f->nrect, nodesize, idsize)) != NULL)
+            goto bad;
+    }
+    return NULL;
+bad:
+    ptfile_close(f);
+    return err;
+}
+
+void ptfile_close(struct ptfile *f)
+{
+    if (f->in.p != NULL)
+        unmap_input(&f->in);
+    free(f->copy);
+    memset(f, 0, sizeof(*f));
+}
+
+/* read a number into *v and return where it ends, or NULL if there is
+ * none or it is out of int range */
+static const unsigned char *number(const unsigned char *p,
+                                   const unsigned char *end, int *v)
+{
+    long long n = 0;
+    int neg = 0, digits = 0;
+
+    while (p < end && (*p == ' ' || *p == '\t'))
+        p++;
+    if (p < end && *p == '-') {
+        neg = 1;
+        p++;
+    }
+    for ( ; p < end && *p >= '0' && *p <= '9'; p++, digits++)
+        if ((n = n * 10 + (*p - '0')) > (long long)INT_MAX + 1)
+            return NULL;
+    if (digits == 0 || (!neg && n > INT_MAX))
+        return NULL;
+    *v = neg ? (int)-n : (int)n;
+    return p;
+}
+
+/* parse the n bytes at p as text, one point or rectangle a line:
+ *
+ *     p x y
+ *     r x1 y1 x2 y2
+ *
+ * with blank lines and lines starting with # ignored. Add the points to
+ * ps and set *r to a malloc'd array of the *nrect rectangles. Return 0
+ * on success, or -1 with *line set to the first bad line, or to 0 if
+ * memory runs out.
+ */
+int ptfile_parse(const unsigned char *p, size_t n, struct points *ps,
+                 struct rect **r, size_t *nrect, size_t *line)
+{
+    const unsigned char *end = p + n;
+    struct rect *rect = NULL, *bigger;
+    size_t cap = 0;
+    struct point pt;
+    int v[4], k, nv;
+
+    *r = NULL;
+    *nrect = 0;
+    for (*line = 1; p < end; (*line)++, p += p < end) {
+        while (p < end && (*p == ' ' || *p == '\t'))
+            p++;
+        if (p == end || *p == '\n' || *p == '\r' || *p == '#') {
+            while (p < end && *p != '\n')
+                p++;
+            continue;
+        }
+        if (*p != 'p' && *p != 'r')
+            goto bad;
+        nv = *p++ == 'p' ? 2 : 4;
+        for (k = 0; k < nv; k++)
+            if ((p = number(p, end, &v[k])) == NULL)
+                goto bad;
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\r'))
+            p++;
+        if (p < end && *p != '\n')
+            goto bad;
+        if (nv == 2) {
+            pt.x = v[0];
+            pt.y = v[1];
+            if (points_add(ps, pt) < 0)
+                goto nomem;
+            continue;
+        }
+        if (*nrect == cap) {
+            cap = cap > 0 ? 2 * cap : 1024;
+            if ((bigger = realloc(rect, cap * sizeof(rect[0]))) == NULL)
+                goto nomem;
+            rect = bigger;
+        }
+        rect[*nrect].pt1.x = v[0];
+        rect[*nrect].pt1.y = v[1];
+        rect[*nrect].pt2.x = v[2];
+        rect[*nrect].pt2.y = v[3];
+        (*nrect)++;
+    }
+    *r = rect;
+    return 0;
+nomem:
+    *line = 0;
+bad:
+    free(rect);
+    *nrect = 0;
+    return -1;
+}
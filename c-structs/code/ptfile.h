@@ -0,0 +1,92 @@
+/* a binary file of points and rectangles that is used where it lies.
+ *
+ * Reading points from text means parsing every number and storing it
+ * somewhere. A ptfile instead holds the arrays exactly as they are laid
+ * out in memory: ptfile_open maps the file and points a struct points,
+ * the rectangle columns and a struct rtree straight into the mapping,
+ * with no parsing and no copying; the pages are read when first used.
+ *
+ * The file is a header, a table of sections, and the sections, each
+ * starting at a multiple of PTFILE_ALIGN bytes so the arrays are as
+ * aligned in the file as the code wants them in memory:
+ *
+ *     x, y                the points, as struct points keeps them
+ *     x1, y1, x2, y2      the rectangles, a column per coordinate
+ *     tree nodes, ids     an rtree built over the rectangles, if any,
+ *     tree levels         and where its levels start
+ *
+ * Numbers are in the byte order of the machine that wrote the file;
+ * order holds PTFILE_ORDER so a reader on the other kind can tell.
+ * Readers skip sections they do not know, so later versions can add
+ * sections without breaking old readers.
+ */
+#ifndef PTFILE_H
+#define PTFILE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "blockio.h"
+#include "points.h"
+#include "rtree.h"
+
+#define PTFILE_MAGIC "ptfile\n"  /* 8 bytes with its '\0' */
+#define PTFILE_VERSION 1
+#define PTFILE_ORDER 0x01020304
+#define PTFILE_ALIGN 64
+#define PTFILE_MAXSECTION 16
+
+enum ptsection {
+    PT_X = 1, PT_Y,                     /* int[npoint] */
+    RECT_X1, RECT_Y1, RECT_X2, RECT_Y2, /* int[nrect] */
+    TREE_NODES,                         /* struct rtnode[] */
+    TREE_IDS,                           /* uint32_t[], one per leaf slot */
+    TREE_LEVELS                         /* uint64_t: rectangles in the
+                                           tree, then level[0 .. nlevel] */
+};
+
+struct ptsection_entry {
+    uint32_t kind;
+    uint32_t reserved;
+    uint64_t offset;        /* from the start of the file */
+    uint64_t size;          /* in bytes */
+};
+
+struct ptfile_header {
+    char magic[8];
+    uint32_t version;
+    uint32_t order;
+    uint64_t npoint;
+    uint64_t nrect;
+    uint32_t nsection;
+    uint32_t reserved;
+    struct ptsection_entry section[PTFILE_MAXSECTION];
+};
+
+/* an open ptfile; everything in it is read-only, and pts must not be
+ * added to */
+struct ptfile {
+    struct input in;
+    unsigned char *copy;    /* an aligned copy if in.p is not aligned */
+    struct points pts;
+    const int *x1, *y1, *x2, *y2;
+    size_t nrect;
+    struct rtree tree;      /* tree.node == NULL if there is none */
+};
+
+/* rectangle i of f */
+static inline struct rect ptfile_rect(const struct ptfile *f, size_t i)
+{
+    struct rect r = { { f->x1[i], f->y1[i] }, { f->x2[i], f->y2[i] } };
+
+    return r;
+}
+
+const char *ptfile_open(struct ptfile *f, const char *path);
+void ptfile_close(struct ptfile *f);
+int ptfile_write(FILE *fp, const struct points *ps, const struct rect *r,
+                 size_t nrect, const struct rtree *t);
+int ptfile_parse(const unsigned char *p, size_t n, struct points *ps,
+                 struct rect **r, size_t *nrect, size_t *line);
+
+#endif
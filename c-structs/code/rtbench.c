@@ -0,0 +1,178 @@
+/* check rtree_stab and rtree_overlap against testing every rectangle
+ * with ptinrect and rectoverlap, and compare their speed as the number
+ * of rectangles grows.
+ *
+ * usage: rtbench [max Mrects]
+ */
+#define _GNU_SOURCE 1
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "benchutil.h"
+#include "rtree.h"
+
+#define REPS   3
+#define NQUERY 1000         /* points, and rectangles, per batch */
+#define WORLD  (1 << 20)    /* coordinates are in [0, WORLD) */
+
+/* a random rectangle with sides up to maxside, and sometimes an empty
+ * one, as a tree must leave those out */
+static struct rect random_rect(uint64_t *seed, int maxside)
+{
+    struct rect r;
+
+    r.pt1.x = next_random(seed) % WORLD;
+    r.pt1.y = next_random(seed) % WORLD;
+    r.pt2.x = r.pt1.x + next_random(seed) % (maxside + 1);
+    r.pt2.y = r.pt1.y + next_random(seed) % (maxside + 1);
+    return r;
+}
+
+/* the same answers as rtree_stab, or with points == NULL as
+ * rtree_overlap, by testing every rectangle; return 0 on success, -1 if
+ * memory runs out */
+static int brute(const struct rect *r, size_t n, const struct point *p,
+                 const struct rect *q, size_t nq, struct rthits *hits)
+{
+    size_t i, j;
+    uint32_t *id;
+    int in;
+
+    hits->n = 0;
+    if (hits->nfirst < nq + 1) {
+        free(hits->first);
+        if ((hits->first = malloc((nq + 1) * sizeof(hits->first[0]))) == NULL)
+            return -1;
+        hits->nfirst = nq + 1;
+    }
+    hits->first[0] = 0;
+    for (i = 0; i < nq; i++) {
+        for (j = 0; j < n; j++) {
+            in = p != NULL ? ptinrect(p[i], r[j]) : rectoverlap(q[i], r[j]);
+            if (!in)
+                continue;
+            if (hits->n == hits->cap) {
+                hits->cap = hits->cap > 0 ? 2 * hits->cap : 1024;
+                if ((id = realloc(hits->id, hits->cap * sizeof(id[0]))) == NULL)
+                    return -1;
+                hits->id = id;
+            }
+            hits->id[hits->n++] = j;
+        }
+        hits->first[i + 1] = hits->n;
+    }
+    return 0;
+}
+
+static int by_id(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+/* return 1 if a and b found the same rectangles for each of nq queries */
+static int same(struct rthits *a, struct rthits *b, size_t nq)
+{
+    size_t i, n;
+
+    for (i = 0; i < nq; i++) {
+        n = a->first[i + 1] - a->first[i];
+        if (n != b->first[i + 1] - b->first[i])
+            return 0;
+        qsort(a->id + a->first[i], n, sizeof(a->id[0]), by_id);
+        qsort(b->id + b->first[i], n, sizeof(b->id[0]), by_id);
+        if (memcmp(a->id + a->first[i], b->id + b->first[i],
+                   n * sizeof(a->id[0])) != 0)
+            return 0;
+    }
+    return 1;
+}
+
+int main(int argc, char *argv[])
+{
+    struct rect *r, q[NQUERY];
+    struct point p[NQUERY];
+    struct rtree t;
+    struct rthits want = { 0 }, got = { 0 };
+    uint64_t seed = 1;
+    size_t n, max, i;
+    double t0, build, stab[2], overlap[2];
+    int side, rep, k, err = 0;
+
+    max = (size_t)(argc > 1 ? atof(argv[1]) * 1000000 : 1000000);
+    if (max == 0) {
+        printf("Usage: rtbench [max Mrects]\n");
+        return 1;
+    }
+    if ((r = malloc(max * sizeof(r[0]))) == NULL) {
+        perror("rtbench");
+        return 1;
+    }
+    printf("%d point and %d rectangle queries per batch, best of %d\n",
+           NQUERY, NQUERY, REPS);
+    printf("%9s %9s %13s %13s %13s %13s\n", "rects", "build ms",
+           "stab brute", "stab tree", "overlap brute", "overlap tree");
+    for (n = 1000; n <= max; n *= 10) {
+        /* about one rectangle over each point */
+        for (side = WORLD, i = n; i > 1; i /= 4)
+            side /= 2;
+        for (i = 0; i < n; i++)
+            r[i] = random_rect(&seed, 2 * side);
+        for (i = 0; i < NQUERY; i++) {
+            p[i].x = next_random(&seed) % WORLD;
+            p[i].y = next_random(&seed) % WORLD;
+            q[i] = random_rect(&seed, 2 * side);
+        }
+        for (build = 1e9, rep = 0; rep < REPS; rep++) {
+            if (rep > 0)
+                rtree_free(&t);
+            t0 = now();
+            err |= rtree_build(&t, r, n);
+            t0 = now() - t0;
+            build = t0 < build ? t0 : build;
+        }
+        for (k = 0; k < 2; k++)
+            stab[k] = overlap[k] = 1e9;
+        for (rep = 0; rep < REPS; rep++) {
+            t0 = now();
+            err |= brute(r, n, p, NULL, NQUERY, &want);
+            t0 = now() - t0;
+            stab[0] = t0 < stab[0] ? t0 : stab[0];
+            t0 = now();
+            err |= rtree_stab(&t, p, NQUERY, &got);
+            t0 = now() - t0;
+            stab[1] = t0 < stab[1] ? t0 : stab[1];
+        }
+        if (err == 0 && !same(&want, &got, NQUERY)) {
+            printf("rtbench: rtree_stab disagrees with ptinrect\n");
+            return 1;
+        }
+        for (rep = 0; rep < REPS; rep++) {
+            t0 = now();
+            err |= brute(r, n, NULL, q, NQUERY, &want);
+            t0 = now() - t0;
+            overlap[0] = t0 < overlap[0] ? t0 : overlap[0];
+            t0 = now();
+            err |= rtree_overlap(&t, q, NQUERY, &got);
+            t0 = now() - t0;
+            overlap[1] = t0 < overlap[1] ? t0 : overlap[1];
+        }
+        if (err == 0 && !same(&want, &got, NQUERY)) {
+            printf("rtbench: rtree_overlap disagrees with rectoverlap\n");
+            return 1;
+        }
+        if (err != 0) {
+            perror("rtbench");
+            return 1;
+        }
+        printf("%9zu %9.2f %10.0f q/s %10.0f q/s %10.0f q/s %10.0f q/s\n",
+               n, build * 1e3, NQUERY / stab[0], NQUERY / stab[1],
+               NQUERY / overlap[0], NQUERY / overlap[1]);
+        rtree_free(&t);
+    }
+    rthits_free(&want);
+    rthits_free(&got);
+    free(r);
+    return 0;
+}
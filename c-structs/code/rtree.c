@@ -0,0 +1,318 @@
+#include <limits.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include "rtree.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+/* a rectangle waiting to be put in a leaf, with its center doubled so
+ * the sort need not divide */
+struct entry {
+    struct rect r;
+    uint32_t id;
+    long long cx, cy;
+};
+
+/* the bits of the children of a node whose boxes overlap q */
+typedef unsigned nodetest(const struct rtnode *nd, struct rect q);
+
+static int by_x(const void *a, const void *b)
+{
+    const struct entry *e = a, *f = b;
+
+    return (e->cx > f->cx) - (e->cx < f->cx);
+}
+
+static int by_y(const void *a, const void *b)
+{
+    const struct entry *e = a, *f = b;
+
+    return (e->cy > f->cy) - (e->cy < f->cy);
+}
+
+/* set child k of nd to box r */
+static void setbox(struct rtnode *nd, int k, struct rect r)
+{
+    nd->x1[k] = r.pt1.x;
+    nd->y1[k] = r.pt1.y;
+    nd->x2[k] = r.pt2.x;
+    nd->y2[k] = r.pt2.y;
+}
+
+/* the box around all the children of nd */
+static struct rect nodebox(const struct rtnode *nd)
+{
+    struct rect b = { { INT_MAX, INT_MAX }, { INT_MIN, INT_MIN } };
+    int k;
+
+    for (k = 0; k < RT_FANOUT; k++) {
+        b.pt1.x = nd->x1[k] < b.pt1.x ? nd->x1[k] : b.pt1.x;
+        b.pt1.y = nd->y1[k] < b.pt1.y ? nd->y1[k] : b.pt1.y;
+        b.pt2.x = nd->x2[k] > b.pt2.x ? nd->x2[k] : b.pt2.x;
+        b.pt2.y = nd->y2[k] > b.pt2.y ? nd->y2[k] : b.pt2.y;
+    }
+    return b;
+}
+
+/* build t from the n rectangles at r, rectangle i getting id i; empty
+ * ones are left out, as nothing can be in them. The leaves are filled
+ * in "sort-tile-recursive" order: the rectangles are sorted by the x of
+ * their centers and cut into about sqrt(leaves) vertical slices, and
+ * each slice is sorted by y, so each leaf covers a small square-ish area.
+ * Return 0 on success, -1 if memory runs out.
+ */
+int rtree_build(struct rtree *t, const struct rect *r, size_t n)
+{
+    struct entry *e;
+    struct rect empty = { { INT_MAX, INT_MAX }, { INT_MIN, INT_MIN } };
+    size_t m = 0, i, k, nleaf, slice, count, total;
+    int l;
+
+    memset(t, 0, sizeof(*t));
+    if (n > UINT32_MAX || (e = malloc((n + 1) * sizeof(e[0]))) == NULL)
+        return -1;
+    for (i = 0; i < n; i++)
+        if (r[i].pt1.x < r[i].pt2.x && r[i].pt1.y < r[i].pt2.y) {
+            e[m].r = r[i];
+            e[m].id = i;
+            e[m].cx = (long long)r[i].pt1.x + r[i].pt2.x;
+            e[m].cy = (long long)r[i].pt1.y + r[i].pt2.y;
+            m++;
+        }
+    t->nrect = m;
+    if (m == 0) {
+        free(e);
+        return 0;
+    }
+    nleaf = (m + RT_FANOUT - 1) / RT_FANOUT;
+    slice = (size_t)ceil(sqrt((double)nleaf)) * RT_FANOUT;
+    qsort(e, m, sizeof(e[0]), by_x);
+    for (i = 0; i < m; i += slice)
+        qsort(e + i, m - i < slice ? m - i : slice, sizeof(e[0]), by_y);
+
+    /* each level has a node for every RT_FANOUT nodes of the one below */
+    total = 0;
+    for (l = 0, count = nleaf; ; l++, count = (count + RT_FANOUT - 1) / RT_FANOUT) {
+        t->level[l] = total;
+        total += count;
+        if (count == 1)
+            break;
+    }
+    t->nlevel = l + 1;
+    t->level[t->nlevel] = total;
+    t->node = aligned_alloc(64, total * sizeof(t->node[0]));
+    t->id = calloc(nleaf * RT_FANOUT, sizeof(t->id[0]));
+    if (t->node == NULL || t->id == NULL) {
+        free(e);
+        rtree_free(t);
+        return -1;
+    }
+    for (i = 0; i < total; i++)
+        for (k = 0; k < RT_FANOUT; k++)
+            setbox(&t->node[i], k, empty);
+    for (i = 0; i < m; i++) {
+        setbox(&t->node[i / RT_FANOUT], i % RT_FANOUT, e[i].r);
+        t->id[i] = e[i].id;
+    }
+    for (l = 1; l < t->nlevel; l++)
+        for (i = t->level[l - 1]; i < t->level[l]; i++) {
+            k = i - t->level[l - 1];
+            setbox(&t->node[t->level[l] + k / RT_FANOUT], k % RT_FANOUT,
+                   nodebox(&t->node[i]));
+        }
+    free(e);
+    return 0;
+}
+
+void rtree_free(struct rtree *t)
+{
+    free(t->node);
+    free(t->id);
+    memset(t, 0, sizeof(*t));
+}
+
+void rthits_free(struct rthits *hits)
+{
+    free(hits->id);
+    free(hits->first);
+    memset(hits, 0, sizeof(*hits));
+}
+
+static unsigned test_scalar(const struct rtnode *nd, struct rect q)
+{
+    unsigned bits = 0;
+    int k;
+
+    for (k = 0; k < RT_FANOUT; k++)
+        bits |= (unsigned)(nd->x1[k] < q.pt2.x && q.pt1.x < nd->x2[k]
+                           && nd->y1[k] < q.pt2.y && q.pt1.y < nd->y2[k]) << k;
+    return bits;
+}
+
+#if defined(__x86_64__)
+/* AVX2 has only signed "greater than": a < b is tested as b > a */
+__attribute__((target("avx2")))
+static unsigned test_avx2(const struct rtnode *nd, struct rect q)
+{
+    __m256i qx1 = _mm256_set1_epi32(q.pt1.x), qx2 = _mm256_set1_epi32(q.pt2.x);
+    __m256i qy1 = _mm256_set1_epi32(q.pt1.y), qy2 = _mm256_set1_epi32(q.pt2.y);
+    __m256i in;
+    unsigned bits = 0;
+    int k;
+
+    for (k = 0; k < RT_FANOUT; k += 8) {
+        in = _mm256_and_si256(
+            _mm256_cmpgt_epi32(qx2, _mm256_load_si256((const __m256i *)(nd->x1 + k))),
+            _mm256_cmpgt_epi32(_mm256_load_si256((const __m256i *)(nd->x2 + k)), qx1));
+        in = _mm256_and_si256(in,
+            _mm256_cmpgt_epi32(qy2, _mm256_load_si256((const __m256i *)(nd->y1 + k))));
+        in = _mm256_and_si256(in,
+            _mm256_cmpgt_epi32(_mm256_load_si256((const __m256i *)(nd->y2 + k)), qy1));
+        bits |= (unsigned)_mm256_movemask_ps(_mm256_castsi256_ps(in)) << k;
+    }
+    return bits;
+}
+
+/* all RT_FANOUT children in one go, each compare only testing the
+ * children the previous ones passed */
+__attribute__((target("avx512f")))
+static unsigned test_avx512(const struct rtnode *nd, struct rect q)
+{
+    __mmask16 m;
+
+    m = _mm512_cmplt_epi32_mask(_mm512_load_si512(nd->x1),
+                                _mm512_set1_epi32(q.pt2.x));
+    m = _mm512_mask_cmpgt_epi32_mask(m, _mm512_load_si512(nd->x2),
+                                     _mm512_set1_epi32(q.pt1.x));
+    m = _mm512_mask_cmplt_epi32_mask(m, _mm512_load_si512(nd->y1),
+                                     _mm512_set1_epi32(q.pt2.y));
+    m = _mm512_mask_cmpgt_epi32_mask(m, _mm512_load_si512(nd->y2),
+                                     _mm512_set1_epi32(q.pt1.y));
+    return m;
+}
+#endif
+
+static nodetest *pick_test(void)
+{
+#if defined(__x86_64__)
+    if (__builtin_cpu_supports("avx512f"))
+        return test_avx512;
+    if (__builtin_cpu_supports("avx2"))
+        return test_avx2;
+#endif
+    return test_scalar;
+}
+
+/* add id to hits; return 0 on success, -1 if memory runs out */
+static int addhit(struct rthits *hits, uint32_t id)
+{
+    uint32_t *p;
+    size_t cap;
+
+    if (hits->n == hits->cap) {
+        cap = hits->cap > 0 ? 2 * hits->cap : 1024;
+        if ((p = realloc(hits->id, cap * sizeof(p[0]))) == NULL)
+            return -1;
+        hits->id = p;
+        hits->cap = cap;
+    }
+    hits->id[hits->n++] = id;
+    return 0;
+}
+
+/* add the id of every rectangle of t overlapping q to hits, going down
+ * only into the nodes whose boxes overlap q; return 0 on success, -1 if
+ * memory runs out */
+static int query(const struct rtree *t, struct rect q, nodetest *test,
+                 struct rthits *hits)
+{
+    /* (level, node within it) still to visit; each level adds at most
+     * RT_FANOUT - 1 more than it takes off */
+    size_t node[RT_MAXLEVEL * RT_FANOUT], i, child;
+    int level[RT_MAXLEVEL * RT_FANOUT], sp = 0, l;
+    unsigned bits;
+
+    if (t->nrect == 0 || q.pt1.x >= q.pt2.x || q.pt1.y >= q.pt2.y)
+        return 0;
+    node[sp] = 0;
+    level[sp++] = t->nlevel - 1;
+    while (sp > 0) {
+        i = node[--sp];
+        l = level[sp];
+        for (bits = test(&t->node[t->level[l] + i], q); bits != 0;
+             bits &= bits - 1) {
+            child = i * RT_FANOUT + __builtin_ctz(bits);
+            if (l == 0) {
+                if (addhit(hits, t->id[child]) < 0)
+                    return -1;
+            } else {
+                node[sp] = child;
+                level[sp++] = l - 1;
+            }
+        }
+    }
+    return 0;
+}
+
+/* start a batch of n queries; return 0 on success, -1 if memory runs out */
+static int start(struct rthits *hits, size_t n)
+{
+    size_t *p;
+
+    hits->n = 0;
+    if (n + 1 > hits->nfirst) {
+        if ((p = realloc(hits->first, (n + 1) * sizeof(p[0]))) == NULL)
+            return -1;
+        hits->first = p;
+        hits->nfirst = n + 1;
+    }
+    hits->first[0] = 0;
+    return 0;
+}
+
+/* find the rectangles of t containing each of the n points at p, as
+ * ptinrect would; return 0 on success, -1 if memory runs out */
+int rtree_stab(const struct rtree *t, const struct point *p, size_t n,
+               struct rthits *hits)
+{
+    nodetest *test = pick_test();
+    struct rect q;
+    size_t i;
+
+    if (start(hits, n) < 0)
+        return -1;
+    for (i = 0; i < n; i++) {
+        /* p is in r exactly when the 1 by 1 square at p overlaps r,
+         * and no rectangle can hold a point at INT_MAX */
+        q.pt1 = q.pt2 = p[i];
+        if (p[i].x < INT_MAX && p[i].y < INT_MAX) {
+            q.pt2.x++;
+            q.pt2.y++;
+        }
+        if (query(t, q, test, hits) < 0)
+            return -1;
+        hits->first[i + 1] = hits->n;
+    }
+    return 0;
+}
+
+/* find the rectangles of t overlapping each of the n rectangles at q,
+ * as rectoverlap would; return 0 on success, -1 if memory runs out */
+int rtree_overlap(const struct rtree *t, const struct rect *q, size_t n,
+                  struct rthits *hits)
+{
+    nodetest *test = pick_test();
+    size_t i;
+
+    if (start(hits, n) < 0)
+        return -1;
+    for (i = 0; i < n; i++) {
+        if (query(t, q[i], test, hits) < 0)
+            return -1;
+        hits->first[i + 1] = hits->n;
+    }
+    return 0;
+}
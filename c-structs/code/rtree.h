@@ -0,0 +1,68 @@
+/* a packed R-tree: which of many rectangles contain a point, or overlap
+ * another rectangle, without testing every one of them.
+ *
+ * The tree is built once from all the rectangles (bulk-loaded) and is
+ * never changed afterwards. Each node holds the bounding boxes of up to
+ * RT_FANOUT children, kept as four arrays of RT_FANOUT ints (all the
+ * x1's, then all the y1's, ...), so each array fills one cache line and
+ * one AVX-512 compare (two AVX2 ones) tests a coordinate of all the
+ * children at once. Nodes are stored level by level, and the children of
+ * node i are nodes i * RT_FANOUT ... i * RT_FANOUT + RT_FANOUT - 1 of the
+ * level below, so the tree needs no pointers.
+ */
+#ifndef RTREE_H
+#define RTREE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "points.h"
+
+#define RT_FANOUT 16        /* children per node */
+#define RT_MAXLEVEL 8       /* RT_FANOUT^RT_MAXLEVEL > UINT32_MAX */
+
+struct rtnode {
+    int x1[RT_FANOUT] __attribute__((aligned(64)));
+    int y1[RT_FANOUT] __attribute__((aligned(64)));
+    int x2[RT_FANOUT] __attribute__((aligned(64)));
+    int y2[RT_FANOUT] __attribute__((aligned(64)));
+};
+
+struct rtree {
+    struct rtnode *node;    /* all the nodes, the leaves first */
+    size_t level[RT_MAXLEVEL + 1]; /* level l is node[level[l]] ... */
+    int nlevel;             /* ... up to node[level[l + 1]]; 0 is leaves */
+    uint32_t *id;           /* leaf slot k holds rectangle id[k] */
+    size_t nrect;
+};
+
+/* the answers to a batch of queries: query i found rectangles
+ * id[first[i]] ... id[first[i + 1] - 1], in no particular order.
+ * Start with all members zero; each batch reuses the memory. */
+struct rthits {
+    uint32_t *id;
+    size_t n, cap;
+    size_t *first;
+    size_t nfirst;
+};
+
+/* return 1 if r and s have a point in common, 0 if not; rectangles are
+ * half-open as in ptinrect, so ones that only touch do not overlap,
+ * and an empty rectangle overlaps nothing */
+static inline int rectoverlap(struct rect r, struct rect s)
+{
+    return r.pt1.x < r.pt2.x && r.pt1.y < r.pt2.y
+        && s.pt1.x < s.pt2.x && s.pt1.y < s.pt2.y
+        && r.pt1.x < s.pt2.x && s.pt1.x < r.pt2.x
+        && r.pt1.y < s.pt2.y && s.pt1.y < r.pt2.y;
+}
+
+int rtree_build(struct rtree *t, const struct rect *r, size_t n);
+void rtree_free(struct rtree *t);
+
+int rtree_stab(const struct rtree *t, const struct point *p, size_t n,
+               struct rthits *hits);
+int rtree_overlap(const struct rtree *t, const struct rect *q, size_t n,
+                  struct rthits *hits);
+void rthits_free(struct rthits *hits);
+
+#endif
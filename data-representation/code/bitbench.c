@@ -0,0 +1,165 @@
+/* measure the bitmap library: set operations and popcounts in GB/s of
+ * bitmap, against a byte-at-a-time loop like the ones on shorts in
+ * bits.c, and rank/select in millions per second.
+ *
+ * usage: bitbench [Mbits] [percent of bits set]
+ */
+#define _GNU_SOURCE 1
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "benchutil.h"
+#include "bitmap.h"
+
+#define REPS    5
+#define QUERIES (1 << 22)
+#define CHECKBITS 1000003   /* size of the bitmap checked bit by bit */
+
+/* set about percent% of the bits of b at random */
+static void fill(struct bitmap *b, int percent, uint64_t seed)
+{
+    size_t i;
+
+    for (i = 0; i < b->nbits; i++)
+        if (next_random(&seed) % 100 < (uint64_t)percent)
+            bitmap_set(b, i);
+}
+
+/* the byte loop: a & b into d, one char at a time */
+static void and_bytewise(unsigned char *d, const unsigned char *a,
+                         const unsigned char *b, size_t n)
+{
+    size_t i;
+
+    for (i = 0; i < n; i++)
+        d[i] = a[i] & b[i];
+}
+
+/* count 1s by clearing the lowest one until none are left, as in
+ * K&R's bitcount exercise */
+static uint64_t count_bitwise(const unsigned char *p, size_t n)
+{
+    uint64_t c = 0;
+    unsigned char x;
+    size_t i;
+
+    for (i = 0; i < n; i++)
+        for (x = p[i]; x != 0; x &= x - 1)
+            c++;
+    return c;
+}
+
+/* compare rank and select against a walk over every bit of a small
+ * bitmap; return 0 if they agree everywhere */
+static int check(int percent)
+{
+    struct bitmap b;
+    uint64_t ones = 0;
+    size_t i;
+    int bad = 0;
+
+    if (bitmap_init(&b, CHECKBITS) < 0)
+        return -1;
+    fill(&b, percent, 42);
+    if (bitmap_index(&b) < 0)
+        return -1;
+    for (i = 0; i <= b.nbits && !bad; i++) {
+        bad |= bitmap_rank(&b, i) != ones;
+        if (i < b.nbits && bitmap_test(&b, i))
+            bad |= bitmap_select(&b, ones++) != i;
+    }
+    bad |= bitmap_select(&b, ones) != b.nbits || ones != bitmap_count(&b);
+    bitmap_free(&b);
+    return bad;
+}
+
+int main(int argc, char *argv[])
+{
+    struct bitmap a, b, d;
+    size_t nbits, bytes, i, *pos;
+    uint64_t *ks, sum, c1, c2;
+    double t, best;
+    int r, percent;
+
+    nbits = (size_t)(argc > 1 ? atol(argv[1]) : 1024) * 1000000;
+    percent = argc > 2 ? atoi(argv[2]) : 50;
+    if (nbits == 0 || percent < 0 || percent > 100) {
+        printf("Usage: bitbench [Mbits] [percent of bits set]\n");
+        return 1;
+    }
+    if (check(percent) != 0) {
+        printf("bitbench: rank or select disagrees with a bit-by-bit walk\n");
+        return 1;
+    }
+    pos = malloc(QUERIES * sizeof(pos[0]));
+    ks = malloc(QUERIES * sizeof(ks[0]));
+    if (pos == NULL || ks == NULL || bitmap_init(&a, nbits) < 0
+        || bitmap_init(&b, nbits) < 0 || bitmap_init(&d, nbits) < 0) {
+        perror("bitbench");
+        return 1;
+    }
+    fill(&a, percent, 1);
+    fill(&b, percent, 2);
+    bytes = a.nwords * sizeof(uint64_t);
+    printf("%zu Mbits (%zu MiB) per bitmap, %d%% set, best of %d\n",
+           nbits / 1000000, bytes >> 20, percent, REPS);
+
+#define TIME(name, stmt)                                        \
+    for (best = 1e9, r = 0; r < REPS; r++) {                    \
+        t = now();                                              \
+        stmt;                                                   \
+        t = now() - t;                                          \
+        best = t < best ? t : best;                             \
+    }                                                           \
+    printf("%-22s %8.2f GB/s\n", name, bytes / best / 1e9)
+
+    TIME("byte loop and",
+         and_bytewise((unsigned char *)d.words, (unsigned char *)a.words,
+                      (unsigned char *)b.words, bytes));
+    TIME("bitmap_and", bitmap_and(&d, &a, &b));
+    TIME("bitmap_or", bitmap_or(&d, &a, &b));
+    TIME("bitmap_andnot", bitmap_andnot(&d, &a, &b));
+    TIME("bit loop count", c1 = count_bitwise((unsigned char *)a.words, bytes));
+    TIME("bitmap_count", c2 = bitmap_count(&a));
+    if (c1 != c2) {
+        printf("bitbench: bitmap_count disagrees with the bit loop\n");
+        return 1;
+    }
+    TIME("and, then count", (bitmap_and(&d, &a, &b), c1 = bitmap_count(&d)));
+    TIME("bitmap_and_count", c2 = bitmap_and_count(&a, &b));
+    if (c1 != c2) {
+        printf("bitbench: bitmap_and_count disagrees with and, then count\n");
+        return 1;
+    }
+
+    t = now();
+    if (bitmap_index(&a) < 0) {
+        perror("bitbench");
+        return 1;
+    }
+    printf("%-22s %8.2f GB/s\n", "bitmap_index", bytes / (now() - t) / 1e9);
+    sum = 1;
+    for (i = 0; i < QUERIES; i++) {
+        pos[i] = next_random(&sum) % (a.nbits + 1);
+        ks[i] = a.ones > 0 ? next_random(&sum) % a.ones : 0;
+    }
+    /* the sum keeps the compiler from dropping the calls */
+    t = now();
+    for (i = 0, sum = 0; i < QUERIES; i++)
+        sum += bitmap_rank(&a, pos[i]);
+    t = now() - t;
+    printf("%-22s %8.2f M/s\n", "bitmap_rank", QUERIES / t / 1e6);
+    t = now();
+    for (i = 0; i < QUERIES; i++)
+        sum += bitmap_select(&a, ks[i]);
+    t = now() - t;
+    printf("%-22s %8.2f M/s  (%llu)\n", "bitmap_select", QUERIES / t / 1e6,
+           (unsigned long long)sum % 10);
+
+    bitmap_free(&a);
+    bitmap_free(&b);
+    bitmap_free(&d);
+    free(pos);
+    free(ks);
+    return 0;
+}
@@ -0,0 +1,355 @@
+#include <stdlib.h>
+#include <string.h>
+#include "bitmap.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+enum op { AND, OR, XOR, ANDNOT };
+
+/* make b an all-zero bitmap of nbits bits; return 0 on success,
+ * -1 if memory runs out */
+int bitmap_init(struct bitmap *b, size_t nbits)
+{
+    memset(b, 0, sizeof(*b));
+    b->nbits = nbits;
+    /* whole AVX2 registers, and at least one */
+    b->nwords = ((nbits + 63) / 64 + 3) / 4 * 4;
+    if (b->nwords == 0)
+        b->nwords = 4;
+    b->words = aligned_alloc(32, b->nwords * sizeof(uint64_t));
+    if (b->words == NULL)
+        return -1;
+    memset(b->words, 0, b->nwords * sizeof(uint64_t));
+    return 0;
+}
+
+static void free_index(struct bitmap *b)
+{
+    free(b->super);
+    free(b->block);
+    free(b->sample);
+    b->super = NULL;
+    b->block = NULL;
+    b->sample = NULL;
+}
+
+void bitmap_free(struct bitmap *b)
+{
+    free(b->words);
+    b->words = NULL;
+    free_index(b);
+}
+
+static void combine(uint64_t *d, const uint64_t *a, const uint64_t *b,
+                    size_t n, enum op op)
+{
+    size_t i;
+
+    switch (op) {
+    case AND:
+        for (i = 0; i < n; i++)
+            d[i] = a[i] & b[i];
+        break;
+    case OR:
+        for (i = 0; i < n; i++)
+            d[i] = a[i] | b[i];
+        break;
+    case XOR:
+        for (i = 0; i < n; i++)
+            d[i] = a[i] ^ b[i];
+        break;
+    case ANDNOT:
+        for (i = 0; i < n; i++)
+            d[i] = a[i] & ~b[i];
+        break;
+    }
+}
+
+#if defined(__x86_64__)
+/* the same, four words to a register; n is a multiple of four */
+__attribute__((target("avx2")))
+static void combine_avx2(uint64_t *d, const uint64_t *a, const uint64_t *b,
+                         size_t n, enum op op)
+{
+    __m256i x, y;
+    size_t i;
+
+    for (i = 0; i < n; i += 4) {
+        x = _mm256_load_si256((const __m256i *)(a + i));
+        y = _mm256_load_si256((const __m256i *)(b + i));
+        switch (op) {
+        case AND:
+            x = _mm256_and_si256(x, y);
+            break;
+        case OR:
+            x = _mm256_or_si256(x, y);
+            break;
+        case XOR:
+            x = _mm256_xor_si256(x, y);
+            break;
+        case ANDNOT:
+            x = _mm256_andnot_si256(y, x);  /* ~y & x */
+            break;
+        }
+        _mm256_store_si256((__m256i *)(d + i), x);
+    }
+}
+#endif
+
+static int apply(struct bitmap *dst, const struct bitmap *a,
+                 const struct bitmap *b, enum op op)
+{
+    if (a->nbits != b->nbits || dst->nbits != a->nbits)
+        return -1;
+    free_index(dst);
+#if defined(__x86_64__)
+    if (__builtin_cpu_supports("avx2")) {
+        combine_avx2(dst->words, a->words, b->words, a->nwords, op);
+        return 0;
+    }
+#endif
+    combine(dst->words, a->words, b->words, a->nwords, op);
+    return 0;
+}
+
+/* each returns 0, or -1 if the bitmaps are not all the same size */
+int bitmap_and(struct bitmap *dst, const struct bitmap *a, const struct bitmap *b)
+{
+    return apply(dst, a, b, AND);
+}
+
+int bitmap_or(struct bitmap *dst, const struct bitmap *a, const struct bitmap *b)
+{
+    return apply(dst, a, b, OR);
+}
+
+int bitmap_xor(struct bitmap *dst, const struct bitmap *a, const struct bitmap *b)
+{
+    return apply(dst, a, b, XOR);
+}
+
+int bitmap_andnot(struct bitmap *dst, const struct bitmap *a, const struct bitmap *b)
+{
+    return apply(dst, a, b, ANDNOT);
+}
+
+/* flip every bit, leaving the padding past nbits zero */
+void bitmap_not(struct bitmap *b)
+{
+    size_t i;
+
+    free_index(b);
+    for (i = 0; i < b->nwords; i++)
+        b->words[i] = ~b->words[i];
+    for (i = (b->nbits + 63) / 64; i < b->nwords; i++)
+        b->words[i] = 0;
+    if (b->nbits % 64 != 0)
+        b->words[b->nbits / 64] &= ((uint64_t)1 << (b->nbits % 64)) - 1;
+}
+
+/* the 1s in n words, or in the AND of two runs of n words if b is not NULL.
+ * Four running totals keep four popcounts in flight at once. */
+static inline uint64_t count_words(const uint64_t *a, const uint64_t *b, size_t n)
+{
+    uint64_t c0 = 0, c1 = 0, c2 = 0, c3 = 0;
+    size_t i;
+
+    if (b == NULL)
+        for (i = 0; i < n; i += 4) {
+            c0 += __builtin_popcountll(a[i]);
+            c1 += __builtin_popcountll(a[i + 1]);
+            c2 += __builtin_popcountll(a[i + 2]);
+            c3 += __builtin_popcountll(a[i + 3]);
+        }
+    else
+        for (i = 0; i < n; i += 4) {
+            c0 += __builtin_popcountll(a[i] & b[i]);
+            c1 += __builtin_popcountll(a[i + 1] & b[i + 1]);
+            c2 += __builtin_popcountll(a[i + 2] & b[i + 2]);
+            c3 += __builtin_popcountll(a[i + 3] & b[i + 3]);
+        }
+    return c0 + c1 + c2 + c3;
+}
+
+#if defined(__x86_64__)
+/* the same, inlined where __builtin_popcountll is the popcnt instruction
+ * rather than a bit-twiddling routine */
+__attribute__((target("popcnt")))
+static uint64_t count_popcnt(const uint64_t *a, const uint64_t *b, size_t n)
+{
+    return count_words(a, b, n);
+}
+#endif
+
+/* n is a multiple of four */
+static uint64_t count(const uint64_t *a, const uint64_t *b, size_t n)
+{
+#if defined(__x86_64__)
+    if (__builtin_cpu_supports("popcnt"))
+        return count_popcnt(a, b, n);
+#endif
+    return count_words(a, b, n);
+}
+
+/* return the number of 1s in b */
+uint64_t bitmap_count(const struct bitmap *b)
+{
+    return count(b->words, NULL, b->nwords);
+}
+
+/* return the number of 1s in a & b without building a & b;
+ * the bitmaps must be the same size */
+uint64_t bitmap_and_count(const struct bitmap *a, const struct bitmap *b)
+{
+    return count(a->words, b->words, a->nwords < b->nwords ? a->nwords : b->nwords);
+}
+
+/* build the rank and select index of b; return 0 on success,
+ * -1 if memory runs out.
+ *
+ * Rank keeps a 64-bit total of the 1s before every superblock and a
+ * 16-bit total of the 1s before every block counted from the start of
+ * its superblock, so a rank is two lookups and at most eight popcounts.
+ * Select keeps the superblock holding every SELSAMPLE'th 1, which narrows
+ * the search for any 1 down to a short binary search over superblocks.
+ */
+int bitmap_index(struct bitmap *b)
+{
+    size_t spw = SUPERBITS / 64, bpw = BLOCKBITS / 64;   /* words per */
+    size_t nsuper = b->nwords / spw + 1, nblock = b->nwords / bpw + 1, w, j;
+    uint64_t total = 0;
+
+    free_index(b);
+    b->ones = bitmap_count(b);
+    b->nsample = b->ones / SELSAMPLE + 1;
+    b->super = malloc(nsuper * sizeof(b->super[0]));
+    b->block = malloc(nblock * sizeof(b->block[0]));
+    /* one more sample, of the last superblock, ends every search */
+    b->sample = malloc((b->nsample + 1) * sizeof(b->sample[0]));
+    if (b->super == NULL || b->block == NULL || b->sample == NULL) {
+        free_index(b);
+        return -1;
+    }
+    for (w = 0, j = 0; w < b->nwords; w++) {
+        if (w % spw == 0)
+            b->super[w / spw] = total;
+        if (w % bpw == 0)
+            b->block[w / bpw] = total - b->super[w / spw];
+        total += __builtin_popcountll(b->words[w]);
+        for ( ; j < b->nsample && j * SELSAMPLE < total; j++)
+            b->sample[j] = w / spw;
+    }
+    /* the entries for the very end, so rank(nbits) needs no special case */
+    if (b->nwords % spw == 0)
+        b->super[b->nwords / spw] = total;
+    if (b->nwords % bpw == 0)
+        b->block[b->nwords / bpw] = total - b->super[b->nwords / spw];
+    /* samples past the last 1 */
+    for ( ; j <= b->nsample; j++)
+        b->sample[j] = nsuper - 1;
+    return 0;
+}
+
+/* return the number of 1s before bit i */
+static inline uint64_t rank_in(const struct bitmap *b, size_t i)
+{
+    size_t w, end = i / 64;
+    uint64_t r;
+
+    w = i / BLOCKBITS * (BLOCKBITS / 64);
+    r = b->super[i / SUPERBITS] + b->block[i / BLOCKBITS];
+    for ( ; w < end; w++)
+        r += __builtin_popcountll(b->words[w]);
+    if (i % 64 != 0)
+        r += __builtin_popcountll(b->words[end] & (((uint64_t)1 << (i % 64)) - 1));
+    return r;
+}
+
+/* the position of the 1 numbered k (from 0) in the word x */
+static int select_word(uint64_t x, int k)
+{
+    for ( ; k > 0; k--)
+        x &= x - 1;     /* clear the lowest 1 */
+    return __builtin_ctzll(x);
+}
+
+/* return the position of the 1 numbered k, counting from 0, which b
+ * must have; word finds a 1 within a word */
+static inline size_t select_in(const struct bitmap *b, uint64_t k,
+                               int (*word)(uint64_t, int))
+{
+    size_t lo, hi, mid, blk, end, w;
+    uint64_t c;
+
+    /* the last superblock with at most k 1s before it holds 1 number k */
+    lo = b->sample[k / SELSAMPLE];
+    hi = b->sample[k / SELSAMPLE + 1];
+    while (lo < hi) {
+        mid = lo + (hi - lo + 1) / 2;
+        if (b->super[mid] <= k)
+            lo = mid;
+        else
+            hi = mid - 1;
+    }
+    k -= b->super[lo];
+    /* then the last block in it with at most k 1s before it */
+    blk = lo * (SUPERBITS / BLOCKBITS);
+    end = blk + SUPERBITS / BLOCKBITS;
+    while (blk + 1 < end && (blk + 1) * (BLOCKBITS / 64) < b->nwords
+           && b->block[blk + 1] <= k)
+        blk++;
+    k -= b->block[blk];
+    /* then the word */
+    for (w = blk * (BLOCKBITS / 64); (c = __builtin_popcountll(b->words[w])) <= k; w++)
+        k -= c;
+    return w * 64 + word(b->words[w], k);
+}
+
+#if defined(__x86_64__)
+/* pdep deposits a single 1 at the place of x's 1 number k */
+__attribute__((target("bmi2")))
+static inline int select_word_bmi2(uint64_t x, int k)
+{
+    return __builtin_ctzll(_pdep_u64((uint64_t)1 << k, x));
+}
+
+/* rank and select, inlined where popcnt and pdep are instructions */
+__attribute__((target("popcnt")))
+static uint64_t rank_popcnt(const struct bitmap *b, size_t i)
+{
+    return rank_in(b, i);
+}
+
+__attribute__((target("popcnt,bmi2")))
+static size_t select_bmi2(const struct bitmap *b, uint64_t k)
+{
+    return select_in(b, k, select_word_bmi2);
+}
+#endif
+
+/* return the number of 1s before bit i, for i up to nbits;
+ * b must have been indexed since it last changed */
+uint64_t bitmap_rank(const struct bitmap *b, size_t i)
+{
+#if defined(__x86_64__)
+    if (__builtin_cpu_supports("popcnt"))
+        return rank_popcnt(b, i);
+#endif
+    return rank_in(b, i);
+}
+
+/* return the position of the 1 numbered k, counting from 0, or nbits
+ * if b has no more than k 1s; b must have been indexed since it last
+ * changed */
+size_t bitmap_select(const struct bitmap *b, uint64_t k)
+{
+    if (k >= b->ones)
+        return b->nbits;
+#if defined(__x86_64__)
+    if (__builtin_cpu_supports("popcnt") && __builtin_cpu_supports("bmi2"))
+        return select_bmi2(b, k);
+#endif
+    return select_in(b, k, select_word);
+}
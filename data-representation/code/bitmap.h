@@ -0,0 +1,66 @@
+/* bitmaps of any size: the & | ^ ~ of bits.c on billions of bits at once.
+ *
+ * Bit i lives in bit i % 64 of word i / 64. The words are padded to a
+ * multiple of four (one AVX2 register) and the padding is kept zero, so
+ * whole-bitmap operations never need a scalar tail.
+ *
+ * rank and select need an index, built by bitmap_index; it costs about
+ * 5% of the bitmap's size and must be rebuilt after the bitmap changes.
+ */
+#ifndef BITMAP_H
+#define BITMAP_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define SUPERBITS  4096     /* bits per superblock of the rank index */
+#define BLOCKBITS  512      /* bits per block of the rank index */
+#define SELSAMPLE  4096     /* the select index records every this many 1s */
+
+struct bitmap {
+    uint64_t *words;
+    size_t nbits;
+    size_t nwords;          /* including the padding */
+    /* the index, or NULL until bitmap_index builds it */
+    uint64_t *super;        /* 1s before each superblock */
+    uint16_t *block;        /* 1s before each block, within its superblock */
+    uint32_t *sample;       /* the superblock holding 1 number j * SELSAMPLE */
+    size_t nsample;
+    uint64_t ones;          /* 1s in the whole bitmap, when indexed */
+};
+
+int bitmap_init(struct bitmap *b, size_t nbits);
+void bitmap_free(struct bitmap *b);
+
+/* the single-bit operations are small enough to be inlined */
+static inline void bitmap_set(struct bitmap *b, size_t i)
+{
+    b->words[i / 64] |= (uint64_t)1 << (i % 64);
+}
+
+static inline void bitmap_clear(struct bitmap *b, size_t i)
+{
+    b->words[i / 64] &= ~((uint64_t)1 << (i % 64));
+}
+
+static inline int bitmap_test(const struct bitmap *b, size_t i)
+{
+    return b->words[i / 64] >> (i % 64) & 1;
+}
+
+/* dst = a op b, bit by bit; all three must be the same size,
+ * and dst may be a or b */
+int bitmap_and(struct bitmap *dst, const struct bitmap *a, const struct bitmap *b);
+int bitmap_or(struct bitmap *dst, const struct bitmap *a, const struct bitmap *b);
+int bitmap_xor(struct bitmap *dst, const struct bitmap *a, const struct bitmap *b);
+int bitmap_andnot(struct bitmap *dst, const struct bitmap *a, const struct bitmap *b);
+void bitmap_not(struct bitmap *b);
+
+uint64_t bitmap_count(const struct bitmap *b);
+uint64_t bitmap_and_count(const struct bitmap *a, const struct bitmap *b);
+
+int bitmap_index(struct bitmap *b);
+uint64_t bitmap_rank(const struct bitmap *b, size_t i);
+size_t bitmap_select(const struct bitmap *b, uint64_t k);
+
+#endif
@@ -1,13 +1,18 @@
 #include <stdio.h>
 #include <string.h>
 
-void xor_cipher(char *message, char key)
+/* XOR the len characters of message with key.
+ * The length is passed in rather than found with strlen:
+ * calling strlen in the loop condition would rescan the whole
+ * message on every iteration, and would stop early if some
+ * character XORed to '\0'.
+ */
+void xor_cipher(char *message, size_t len, char key)
 {
     size_t i;
 
-    for (i = 0; i < strlen(message); i++) {
-        message[i] = message[i] ^ key;
-    }
+    for (i = 0; i < len; i++)
+        message[i] ^= key;
 }
 
 int main(void) 
@@ -40,10 +45,11 @@ int main(void)
     /* xor cipher example */
     char message[] = "hello";
     char key = 31;
+    size_t len = strlen(message);
     printf("original message: %s\n", message);
-    xor_cipher(message, key);
+    xor_cipher(message, len, key);
     printf("encoded message: %s\n", message);
-    xor_cipher(message, key);
+    xor_cipher(message, len, key);
     printf("decoded message: %s\n", message);
 
     /* left shift << */
@@ -0,0 +1,211 @@
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "byteorder.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#define CHUNK 32            /* bytes per AVX2 register */
+
+static int host_bigendian(void);
+static void make_masks(struct layout *l);
+
+/* parse the layout desc into l, for records stored big-endian if
+ * bigendian is set and little-endian otherwise; return 0 on success,
+ * -1 if desc is not a layout or memory runs out */
+int layout_init(struct layout *l, const char *desc, int bigendian)
+{
+    struct field f[MAXRECORD / 2];
+    size_t off = 0, nf = 0, a, b, t;
+    long count;
+    char *end;
+    int size;
+
+    memset(l, 0, sizeof(*l));
+    while (*desc != '\0') {
+        count = 1;
+        if (*desc >= '0' && *desc <= '9') {
+            count = strtol(desc, &end, 10);
+            desc = end;
+        }
+        switch (*desc++) {
+        case 'x': case 'X': case 'b': case 'B':
+            size = 1;
+            break;
+        case 'h': case 'H':
+            size = 2;
+            break;
+        case 'i': case 'I':
+            size = 4;
+            break;
+        case 'q': case 'Q':
+            size = 8;
+            break;
+        default:
+            return -1;
+        }
+        if (count < 0 || count > MAXRECORD || off + count * size > MAXRECORD)
+            return -1;
+        for ( ; count > 0; count--, off += size)
+            if (size > 1) {
+                f[nf].off = off;
+                f[nf++].size = size;
+            }
+    }
+    if (off == 0)
+        return -1;
+    l->reclen = off;
+    l->nfield = nf;
+    l->swap = nf > 0 && bigendian != host_bigendian();
+    if ((l->field = malloc((nf > 0 ? nf : 1) * sizeof(f[0]))) == NULL)
+        return -1;
+    memcpy(l->field, f, nf * sizeof(f[0]));
+    /* period = lcm(reclen, CHUNK) */
+    for (a = l->reclen, b = CHUNK; b != 0; t = a % b, a = b, b = t)
+        ;
+    l->period = l->reclen / a * CHUNK;
+    if ((l->mask = malloc(2 * l->period)) == NULL) {
+        free(l->field);
+        return -1;
+    }
+    make_masks(l);
+    return 0;
+}
+
+void layout_free(struct layout *l)
+{
+    free(l->field);
+    free(l->mask);
+    l->field = NULL;
+    l->mask = NULL;
+}
+
+static int host_bigendian(void)
+{
+    int x = 1;
+
+    return *(unsigned char *)&x == 0;
+}
+
+/* Where every byte of a period comes from. Swapping a field only moves
+ * bytes within it, and no field is wider than 8 bytes, so a byte never
+ * moves more than 7 places. vpshufb can pick any byte of a 16-byte lane,
+ * so each 16 bytes of output are picked from two 16-byte windows of the
+ * input: A, starting 8 bytes before them, and B, starting 8 bytes after
+ * their start; between them they cover every byte that can land there.
+ * Each mask byte is an index into its window, or 0x80 for "take the
+ * byte from the other window", which vpshufb turns into a zero.
+ */
+static void make_masks(struct layout *l)
+{
+    signed char move[MAXRECORD];    /* move[r]: byte r comes from r + move[r] */
+    unsigned char *a, *b;
+    size_t i, j, k;
+    long from;
+
+    memset(move, 0, l->reclen);
+    for (j = 0; j < l->nfield; j++)
+        for (k = 0; k < l->field[j].size; k++)
+            move[l->field[j].off + k] = l->field[j].size - 1 - 2 * k;
+    for (i = 0; i < l->period; i += CHUNK) {
+        a = l->mask + 2 * i;
+        b = a + CHUNK;
+        for (j = 0; j < CHUNK; j++) {
+            /* where the byte comes from, relative to the start of its lane */
+            from = j % 16 + move[(i + j) % l->reclen];
+            a[j] = from < 8 ? from + 8 : 0x80;
+            b[j] = from < 8 ? 0x80 : from - 8;
+        }
+    }
+}
+
+/* convert the nrec records at src into dst, which may be src itself,
+ * one field at a time */
+static void swap_fields(const struct layout *l, unsigned char *dst,
+                        const unsigned char *src, size_t nrec)
+{
+    const struct field *f, *fend = l->field + l->nfield;
+    uint16_t v16;
+    uint32_t v32;
+    uint64_t v64;
+
+    if (dst != src)
+        memmove(dst, src, nrec * l->reclen);
+    for ( ; nrec > 0; nrec--, dst += l->reclen)
+        for (f = l->field; f < fend; f++)
+            switch (f->size) {
+            case 2:
+                memcpy(&v16, dst + f->off, 2);
+                v16 = __builtin_bswap16(v16);
+                memcpy(dst + f->off, &v16, 2);
+                break;
+            case 4:
+                memcpy(&v32, dst + f->off, 4);
+                v32 = __builtin_bswap32(v32);
+                memcpy(dst + f->off, &v32, 4);
+                break;
+            case 8:
+                memcpy(&v64, dst + f->off, 8);
+                v64 = __builtin_bswap64(v64);
+                memcpy(dst + f->off, &v64, 8);
+                break;
+            }
+}
+
+#if defined(__x86_64__)
+/* convert whole periods of records 32 bytes at a time, as long as the
+ * 32 bytes after the last period can be read too; return the number of
+ * bytes done. Each step keeps the input chunks before and after the
+ * current one in registers, so dst may be src: a chunk is only stored
+ * once the input it overwrites has been loaded.
+ */
+__attribute__((target("avx2")))
+static size_t swap_avx2(const struct layout *l, unsigned char *dst,
+                        const unsigned char *src, size_t n)
+{
+    __m256i prev = _mm256_setzero_si256(), cur, next, a, b;
+    const unsigned char *mask;
+    size_t done, end, i;
+
+    if (n < l->period + CHUNK)
+        return 0;
+    end = (n - CHUNK) / l->period * l->period;
+    next = _mm256_loadu_si256((const __m256i *)src);
+    for (done = 0; done < end; done += l->period)
+        for (i = 0, mask = l->mask; i < l->period; i += CHUNK, mask += 2 * CHUNK) {
+            cur = next;
+            next = _mm256_loadu_si256((const __m256i *)(src + done + i + CHUNK));
+            /* lane by lane: a starts 8 bytes before the lane, b 8 after */
+            a = _mm256_alignr_epi8(cur, _mm256_permute2x128_si256(prev, cur, 0x21), 8);
+            b = _mm256_alignr_epi8(_mm256_permute2x128_si256(cur, next, 0x21), cur, 8);
+            a = _mm256_shuffle_epi8(a, _mm256_loadu_si256((const __m256i *)mask));
+            b = _mm256_shuffle_epi8(b, _mm256_loadu_si256((const __m256i *)(mask + CHUNK)));
+            _mm256_storeu_si256((__m256i *)(dst + done + i), _mm256_or_si256(a, b));
+            prev = cur;
+        }
+    return end;
+}
+#endif
+
+/* convert the nrec records at src from the layout's byte order to the
+ * host's, or back, into dst; dst may be src to convert in place */
+void swap_records(const struct layout *l, void *dst, const void *src,
+                  size_t nrec)
+{
+    unsigned char *d = dst;
+    const unsigned char *s = src;
+    size_t done = 0;
+
+    if (!l->swap) {
+        if (dst != src)
+            memmove(dst, src, nrec * l->reclen);
+        return;
+    }
+#if defined(__x86_64__)
+    if (__builtin_cpu_supports("avx2"))
+        done = swap_avx2(l, d, s, nrec * l->reclen);
+#endif
+    swap_fields(l, d + done, s + done, nrec - done / l->reclen);
+}
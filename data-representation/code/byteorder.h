@@ -0,0 +1,44 @@
+/* convert arrays of fixed-size binary records between byte orders.
+ *
+ * endian.c shows that an int is stored with its bytes in some order;
+ * a file written on a machine that uses the other order has every
+ * multi-byte field backwards. A layout says where the fields of one
+ * record are and how wide they are, in the style of Python's struct
+ * module: each field is one letter, optionally preceded by a count.
+ *
+ *   x  1-byte pad      b  1-byte field     h  2-byte field
+ *   i  4-byte field    q  8-byte field
+ *
+ * so "q2hi4b" is an 8-byte field, two 2-byte fields, a 4-byte field and
+ * four single bytes: 20 bytes a record. Capital letters mean the same.
+ */
+#ifndef BYTEORDER_H
+#define BYTEORDER_H
+
+#include <stddef.h>
+
+#define MAXRECORD 4096      /* longest record, in bytes */
+
+/* a field wider than one byte, the only kind that needs swapping */
+struct field {
+    unsigned short off;
+    unsigned char size;
+};
+
+/* a parsed layout, ready to convert records from a given byte order */
+struct layout {
+    size_t reclen;          /* bytes per record */
+    struct field *field;    /* the fields that need swapping */
+    size_t nfield;
+    int swap;               /* 0 if the records are in host order already */
+    size_t period;          /* bytes after which records and 32-byte chunks
+                               line up again: lcm(reclen, 32) */
+    unsigned char *mask;    /* two shuffle masks per 32 bytes of a period */
+};
+
+int layout_init(struct layout *l, const char *desc, int bigendian);
+void layout_free(struct layout *l);
+void swap_records(const struct layout *l, void *dst, const void *src,
+                  size_t nrec);
+
+#endif
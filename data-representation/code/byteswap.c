@@ -0,0 +1,101 @@
+/* byteswap: convert a file of binary records from one byte order to the
+ * other, field by field, as endian.c shows an int's bytes.
+ *
+ * usage: byteswap [-l] layout [infile [outfile]]
+ *   -l  the records are little-endian (default: big-endian)
+ * The layout is described in byteorder.h, e.g. "q2hi4b". Records that are
+ * already in the host's byte order are copied through unchanged.
+ * Without infile/outfile, byteswap reads standard input and writes
+ * standard output.
+ */
+#define _GNU_SOURCE 1
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include "blockio.h"
+#include "byteorder.h"
+
+/* the state kept across blocks */
+struct conv {
+    struct layout l;
+    int out;
+    unsigned char *buf;     /* one block of converted records */
+    size_t partial;         /* bytes of a record cut off by the end */
+};
+
+static int swap_block(const unsigned char *p, size_t n, void *arg);
+
+int main(int argc, char *argv[])
+{
+    struct conv cv;
+    size_t blocksize;
+    int c, big = 1, in = 0, rc;
+
+    while ((c = getopt(argc, argv, "l")) != -1)
+        switch (c) {
+        case 'l':
+            big = 0;
+            break;
+        default:
+            argc = 0;
+            break;
+        }
+    argc -= optind;
+    argv += optind;
+    if (argc < 1 || argc > 3) {
+        fprintf(stderr, "Usage: byteswap [-l] layout [infile [outfile]]\n");
+        return 1;
+    }
+    if (layout_init(&cv.l, argv[0], big) < 0) {
+        fprintf(stderr, "byteswap: bad layout %s (at most %d bytes of x, b, h, i, q)\n",
+                argv[0], MAXRECORD);
+        return 1;
+    }
+    cv.out = 1;
+    cv.partial = 0;
+    if (argc > 1 && (in = open(argv[1], O_RDONLY)) < 0) {
+        perror(argv[1]);
+        return 1;
+    }
+    if (argc > 2 && (cv.out = open(argv[2], O_WRONLY | O_CREAT | O_TRUNC, 0666)) < 0) {
+        perror(argv[2]);
+        return 1;
+    }
+    /* whole records to a block, so no record is ever split between two */
+    blocksize = BLOCKSIZE / cv.l.reclen * cv.l.reclen;
+    if ((cv.buf = malloc(blocksize)) == NULL) {
+        perror("byteswap");
+        return 1;
+    }
+
+    if ((rc = read_blocks(in, blocksize, swap_block, &cv)) < 0)
+        perror("byteswap");
+    else if (cv.partial > 0) {
+        fprintf(stderr, "byteswap: last %zu bytes are not a whole record; "
+                "copied unchanged\n", cv.partial);
+        rc = 1;
+    }
+    layout_free(&cv.l);
+    free(cv.buf);
+    if (cv.out != 1 && close(cv.out) < 0) {
+        perror(argv[2]);
+        return 1;
+    }
+    return rc != 0;
+}
+
+/* convert the records in the n bytes at p and write them out;
+ * return 0 on success, -1 on a write error */
+static int swap_block(const unsigned char *p, size_t n, void *arg)
+{
+    struct conv *cv = arg;
+    size_t nrec = n / cv->l.reclen;
+
+    swap_records(&cv->l, cv->buf, p, nrec);
+    /* only the last block can end in part of a record */
+    cv->partial = n - nrec * cv->l.reclen;
+    if (write_all(cv->out, cv->buf, nrec * cv->l.reclen) < 0)
+        return -1;
+    return write_all(cv->out, p + nrec * cv->l.reclen, cv->partial);
+}
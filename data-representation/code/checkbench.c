@@ -0,0 +1,184 @@
+/* check the overflow-detecting array operations in checked.h against
+ * ckd_add and friends one element at a time, then time them against
+ * plain loops that let overflow wrap silently, as in overflow.c.
+ *
+ * usage: checkbench [Melements]
+ */
+#define _GNU_SOURCE 1
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "benchutil.h"
+#include "checked.h"
+
+#define REPS  5
+#define NTEST 100003        /* elements in each correctness test */
+
+/* fill p with n elements of size bytes: mostly small numbers, which do
+ * not overflow, with a few anywhere in the type's range, which might */
+static void fill(void *p, size_t size, size_t n, uint64_t seed)
+{
+    unsigned char *q = p;
+    uint64_t v;
+    size_t i;
+
+    for (i = 0; i < n; i++, q += size) {
+        v = next_random(&seed);
+        if (v % 1000 != 0)
+            v = v >> 32 & 7;
+        memcpy(q, &v, size);    /* the low bytes, on a little-endian machine */
+    }
+}
+
+/* the value an overflowing x op y saturates to, where op is 'a'dd,
+ * 's'ub or 'm'ul */
+#define CLAMP_SIGNED(MIN, MAX, op, x, y)                                      \
+    (((op) == 'm' ? ((x) < 0) != ((y) < 0) : (x) < 0) ? (MIN) : (MAX))
+#define CLAMP_UNSIGNED(MIN, MAX, op, x, y)                                    \
+    ((op) == 's' ? (MIN) : (MAX))
+
+/* compare one array op, checked and saturating, with ckd_op on each
+ * element; print and count any disagreement */
+#define TEST(sfx, T, MIN, MAX, CLAMP, op, ckd)                                \
+    do {                                                                      \
+        size_t i, first = NTEST, got;                                         \
+        T r;                                                                  \
+                                                                              \
+        for (i = 0; i < NTEST; i++) {                                         \
+            if (ckd(&r, a.sfx[i], b.sfx[i])) {                                \
+                first = first < i ? first : i;                                \
+                want.sfx[i] = CLAMP(MIN, MAX, #op[0], a.sfx[i], b.sfx[i]);   \
+            } else                                                            \
+                want.sfx[i] = r;                                              \
+        }                                                                     \
+        got = saturate_##op##_##sfx(d.sfx, a.sfx, b.sfx, NTEST);              \
+        if (got != first || memcmp(d.sfx, want.sfx, NTEST * sizeof(T)) != 0) {\
+            printf("saturate_" #op "_" #sfx " is wrong\n");                   \
+            bad++;                                                            \
+        }                                                                     \
+        for (i = 0; i < NTEST; i++)                                           \
+            ckd(&want.sfx[i], a.sfx[i], b.sfx[i]);                            \
+        got = checked_##op##_##sfx(d.sfx, a.sfx, b.sfx, NTEST);               \
+        if (got != first || memcmp(d.sfx, want.sfx, NTEST * sizeof(T)) != 0) {\
+            printf("checked_" #op "_" #sfx " is wrong\n");                    \
+            bad++;                                                            \
+        }                                                                     \
+    } while (0)
+
+#define TESTS(sfx, T, MIN, MAX, CLAMP)                                        \
+    do {                                                                      \
+        fill(a.sfx, sizeof(T), NTEST, 1);                                     \
+        fill(b.sfx, sizeof(T), NTEST, 2);                                     \
+        TEST(sfx, T, MIN, MAX, CLAMP, add, ckd_add);                          \
+        TEST(sfx, T, MIN, MAX, CLAMP, sub, ckd_sub);                          \
+        TEST(sfx, T, MIN, MAX, CLAMP, mul, ckd_mul);                          \
+    } while (0)
+
+/* arrays of every type in the same memory */
+union arrays {
+    int8_t *i8;
+    int16_t *i16;
+    int32_t *i32;
+    int64_t *i64;
+    uint8_t *u8;
+    uint16_t *u16;
+    uint32_t *u32;
+    uint64_t *u64;
+};
+
+static int test(void)
+{
+    union arrays a, b, d, want;
+    int bad = 0;
+
+    a.u64 = malloc(NTEST * sizeof(uint64_t));
+    b.u64 = malloc(NTEST * sizeof(uint64_t));
+    d.u64 = malloc(NTEST * sizeof(uint64_t));
+    want.u64 = malloc(NTEST * sizeof(uint64_t));
+    if (a.u64 == NULL || b.u64 == NULL || d.u64 == NULL || want.u64 == NULL)
+        return -1;
+    TESTS(i8, int8_t, INT8_MIN, INT8_MAX, CLAMP_SIGNED);
+    TESTS(i16, int16_t, INT16_MIN, INT16_MAX, CLAMP_SIGNED);
+    TESTS(i32, int32_t, INT32_MIN, INT32_MAX, CLAMP_SIGNED);
+    TESTS(i64, int64_t, INT64_MIN, INT64_MAX, CLAMP_SIGNED);
+    TESTS(u8, uint8_t, 0, UINT8_MAX, CLAMP_UNSIGNED);
+    TESTS(u16, uint16_t, 0, UINT16_MAX, CLAMP_UNSIGNED);
+    TESTS(u32, uint32_t, 0, UINT32_MAX, CLAMP_UNSIGNED);
+    TESTS(u64, uint64_t, 0, UINT64_MAX, CLAMP_UNSIGNED);
+    free(a.u64);
+    free(b.u64);
+    free(d.u64);
+    free(want.u64);
+    return bad;
+}
+
+/* the loops checked.h replaces: overflow wraps and nobody notices */
+#define PLAIN(sfx, T, op)                                                     \
+static void plain_##sfx(T *dst, const T *a, const T *b, size_t n)            \
+{                                                                             \
+    size_t i;                                                                 \
+                                                                              \
+    for (i = 0; i < n; i++)                                                   \
+        dst[i] = a[i] op b[i];                                                \
+}
+
+PLAIN(add_i8, uint8_t, +)
+PLAIN(add_i32, uint32_t, +)
+PLAIN(mul_i32, uint32_t, *)
+PLAIN(add_u64, uint64_t, +)
+
+#define TIME(name, stmt)                                                      \
+    do {                                                                      \
+        for (best = 1e9, r = 0; r < REPS; r++) {                              \
+            t = now();                                                        \
+            stmt;                                                             \
+            t = now() - t;                                                    \
+            best = t < best ? t : best;                                       \
+        }                                                                     \
+        printf("%-22s %8.2f Gelem/s\n", name, n / best / 1e9);                \
+    } while (0)
+
+int main(int argc, char *argv[])
+{
+    union arrays a, b, d;
+    size_t n, i;
+    double t, best;
+    int r;
+
+    n = (size_t)(argc > 1 ? atol(argv[1]) : 16) * 1000000;
+    if (n == 0) {
+        printf("Usage: checkbench [Melements]\n");
+        return 1;
+    }
+    if (test() != 0) {
+        printf("checkbench: the array operations disagree with ckd_*\n");
+        return 1;
+    }
+    a.u64 = malloc(n * sizeof(uint64_t));
+    b.u64 = malloc(n * sizeof(uint64_t));
+    d.u64 = malloc(n * sizeof(uint64_t));
+    if (a.u64 == NULL || b.u64 == NULL || d.u64 == NULL) {
+        perror("checkbench");
+        return 1;
+    }
+    /* small numbers: the common case, where nothing overflows */
+    for (i = 0; i < n; i++)
+        a.u64[i] = b.u64[i] = i % 1000;
+    printf("%zu M elements, best of %d\n", n / 1000000, REPS);
+    TIME("plain add int8", plain_add_i8(d.u8, a.u8, b.u8, n));
+    TIME("checked_add_i8", checked_add_i8(d.i8, a.i8, b.i8, n));
+    TIME("saturate_add_i8", saturate_add_i8(d.i8, a.i8, b.i8, n));
+    TIME("plain add int32", plain_add_i32(d.u32, a.u32, b.u32, n));
+    TIME("checked_add_i32", checked_add_i32(d.i32, a.i32, b.i32, n));
+    TIME("saturate_add_i32", saturate_add_i32(d.i32, a.i32, b.i32, n));
+    TIME("plain mul int32", plain_mul_i32(d.u32, a.u32, b.u32, n));
+    TIME("checked_mul_i32", checked_mul_i32(d.i32, a.i32, b.i32, n));
+    TIME("saturate_mul_i32", saturate_mul_i32(d.i32, a.i32, b.i32, n));
+    TIME("plain add uint64", plain_add_u64(d.u64, a.u64, b.u64, n));
+    TIME("checked_add_u64", checked_add_u64(d.u64, a.u64, b.u64, n));
+    TIME("saturate_add_u64", saturate_add_u64(d.u64, a.u64, b.u64, n));
+    free(a.u64);
+    free(b.u64);
+    free(d.u64);
+    return 0;
+}
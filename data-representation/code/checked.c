@@ -0,0 +1,157 @@
+#include "checked.h"
+
+/* Each kernel goes over its arrays a block at a time. The first pass
+ * only asks whether anything in the block overflows; it has no stores
+ * and no branches, so it compiles to vector code, and the block is in
+ * the cache for the second pass, which stores the results. Only in the
+ * rare block that does overflow is the first culprit looked for one
+ * element at a time, before the results can overwrite a or b.
+ */
+#define BLOCK 256
+
+/* Each op below computes x op y for elements of type T into r, wrapped;
+ * sets o if that overflowed; and sets s to the value to saturate to.
+ * UT is T's unsigned twin: wrapping is only defined for unsigned types.
+ * W is a type at least twice as wide as T, for multiplying. */
+#define BITS(T) (8 * sizeof(T) - 1)
+/* MAX for a positive result, MAX + 1 == MIN for a negative one */
+#define CLAMP(T, UT, neg) (T)(((UT)-1 >> 1) + ((UT)(neg) >> BITS(T)))
+
+/* a sum overflows if its sign differs from both operands' */
+#define ADD_SIGNED(T, UT, W)                                                  \
+    r = (T)((UT)x + (UT)y);                                                   \
+    o = ((x ^ r) & (y ^ r)) < 0;                                              \
+    s = CLAMP(T, UT, x)
+
+/* a difference overflows if the operands' signs differ and the result's
+ * differs from x's */
+#define SUB_SIGNED(T, UT, W)                                                  \
+    r = (T)((UT)x - (UT)y);                                                   \
+    o = ((x ^ y) & (x ^ r)) < 0;                                              \
+    s = CLAMP(T, UT, x)
+
+/* a product overflows if the full product does not fit back in T */
+#define MUL_SIGNED(T, UT, W)                                                  \
+    r = (T)((W)x * y);                                                        \
+    o = (W)x * y != r;                                                        \
+    s = CLAMP(T, UT, x ^ y)
+
+/* there is nothing twice as wide as 64 bits to vectorize with */
+#define MUL_SIGNED64(T, UT, W)                                                \
+    o = __builtin_mul_overflow(x, y, &r);                                     \
+    s = CLAMP(T, UT, x ^ y)
+
+#define ADD_UNSIGNED(T, UT, W)                                                \
+    r = (T)(x + y);                                                           \
+    o = r < x;                                                                \
+    s = (T)-1
+
+#define SUB_UNSIGNED(T, UT, W)                                                \
+    r = (T)(x - y);                                                           \
+    o = x < y;                                                                \
+    s = 0
+
+#define MUL_UNSIGNED(T, UT, W)                                                \
+    r = (T)((W)x * y);                                                        \
+    o = (W)x * y > (T)-1;                                                     \
+    s = (T)-1
+
+#define MUL_UNSIGNED64(T, UT, W)                                              \
+    o = __builtin_mul_overflow(x, y, &r);                                     \
+    s = (T)-1
+
+/* one kernel, and its checked and saturating entry points, which use the
+ * AVX2 build of it where the CPU has AVX2 */
+#define KERNEL(op, sfx, T, UT, W, OP)                                         \
+static inline size_t op##_##sfx(T *dst, const T *a, const T *b, size_t n,    \
+                                int sat)                                      \
+{                                                                             \
+    size_t i, j, len, first = n;                                              \
+    T x, y, r, s;                                                             \
+    int o, any;                                                               \
+                                                                              \
+    for (i = 0; i < n; i += len) {                                            \
+        len = n - i < BLOCK ? n - i : BLOCK;                                  \
+        for (j = 0, any = 0; j < len; j++) {                                  \
+            x = a[i + j];                                                     \
+            y = b[i + j];                                                     \
+            OP(T, UT, W);                                                     \
+            any |= o;                                                         \
+        }                                                                     \
+        for (j = 0; any && first == n; j++) {                                 \
+            x = a[i + j];                                                     \
+            y = b[i + j];                                                     \
+            OP(T, UT, W);                                                     \
+            if (o)                                                            \
+                first = i + j;                                                \
+        }                                                                     \
+        for (j = 0; j < len; j++) {                                           \
+            x = a[i + j];                                                     \
+            y = b[i + j];                                                     \
+            OP(T, UT, W);                                                     \
+            dst[i + j] = sat && o ? s : r;                                    \
+        }                                                                     \
+    }                                                                         \
+    return first;                                                             \
+}                                                                             \
+                                                                              \
+TARGET_AVX2                                                                   \
+static size_t op##_##sfx##_checked_avx2(T *dst, const T *a, const T *b,      \
+                                        size_t n)                             \
+{                                                                             \
+    return op##_##sfx(dst, a, b, n, 0);                                       \
+}                                                                             \
+                                                                              \
+TARGET_AVX2                                                                   \
+static size_t op##_##sfx##_saturate_avx2(T *dst, const T *a, const T *b,     \
+                                         size_t n)                            \
+{                                                                             \
+    return op##_##sfx(dst, a, b, n, 1);                                       \
+}                                                                             \
+                                                                              \
+size_t checked_##op##_##sfx(T *dst, const T *a, const T *b, size_t n)        \
+{                                                                             \
+    if (HAVE_AVX2)                                                            \
+        return op##_##sfx##_checked_avx2(dst, a, b, n);                       \
+    return op##_##sfx(dst, a, b, n, 0);                                       \
+}                                                                             \
+                                                                              \
+size_t saturate_##op##_##sfx(T *dst, const T *a, const T *b, size_t n)       \
+{                                                                             \
+    if (HAVE_AVX2)                                                            \
+        return op##_##sfx##_saturate_avx2(dst, a, b, n);                      \
+    return op##_##sfx(dst, a, b, n, 1);                                       \
+}
+
+#if defined(__x86_64__)
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#define HAVE_AVX2 __builtin_cpu_supports("avx2")
+#else
+#define TARGET_AVX2
+#define HAVE_AVX2 0
+#endif
+
+KERNEL(add, i8, int8_t, uint8_t, int32_t, ADD_SIGNED)
+KERNEL(sub, i8, int8_t, uint8_t, int32_t, SUB_SIGNED)
+KERNEL(mul, i8, int8_t, uint8_t, int32_t, MUL_SIGNED)
+KERNEL(add, i16, int16_t, uint16_t, int32_t, ADD_SIGNED)
+KERNEL(sub, i16, int16_t, uint16_t, int32_t, SUB_SIGNED)
+KERNEL(mul, i16, int16_t, uint16_t, int32_t, MUL_SIGNED)
+KERNEL(add, i32, int32_t, uint32_t, int64_t, ADD_SIGNED)
+KERNEL(sub, i32, int32_t, uint32_t, int64_t, SUB_SIGNED)
+KERNEL(mul, i32, int32_t, uint32_t, int64_t, MUL_SIGNED)
+KERNEL(add, i64, int64_t, uint64_t, int64_t, ADD_SIGNED)
+KERNEL(sub, i64, int64_t, uint64_t, int64_t, SUB_SIGNED)
+KERNEL(mul, i64, int64_t, uint64_t, int64_t, MUL_SIGNED64)
+KERNEL(add, u8, uint8_t, uint8_t, uint32_t, ADD_UNSIGNED)
+KERNEL(sub, u8, uint8_t, uint8_t, uint32_t, SUB_UNSIGNED)
+KERNEL(mul, u8, uint8_t, uint8_t, uint32_t, MUL_UNSIGNED)
+KERNEL(add, u16, uint16_t, uint16_t, uint32_t, ADD_UNSIGNED)
+KERNEL(sub, u16, uint16_t, uint16_t, uint32_t, SUB_UNSIGNED)
+KERNEL(mul, u16, uint16_t, uint16_t, uint32_t, MUL_UNSIGNED)
+KERNEL(add, u32, uint32_t, uint32_t, uint64_t, ADD_UNSIGNED)
+KERNEL(sub, u32, uint32_t, uint32_t, uint64_t, SUB_UNSIGNED)
+KERNEL(mul, u32, uint32_t, uint32_t, uint64_t, MUL_UNSIGNED)
+KERNEL(add, u64, uint64_t, uint64_t, uint64_t, ADD_UNSIGNED)
+KERNEL(sub, u64, uint64_t, uint64_t, uint64_t, SUB_UNSIGNED)
+KERNEL(mul, u64, uint64_t, uint64_t, uint64_t, MUL_UNSIGNED64)
@@ -0,0 +1,54 @@
+/* arithmetic that notices overflow, for single values and whole arrays.
+ *
+ * overflow.c shows an unsigned int wrapping from UINT_MAX to 0 without
+ * a word, and mixed.c a loop that never ends because an unsigned i is
+ * never below 0. The C23 ckd_add, ckd_sub and ckd_mul catch this for one
+ * value at a time: each stores a + b (or a - b, a * b) in *r, wrapped if
+ * need be, and returns true if it did not fit. They are provided here on
+ * compilers that lack <stdckdint.h>.
+ *
+ * For arrays, every op and type has two forms:
+ *
+ *   checked_add_i32(dst, a, b, n)   dst[i] = a[i] + b[i], wrapped
+ *   saturate_add_i32(dst, a, b, n)  dst[i] = a[i] + b[i], clamped to
+ *                                   INT32_MIN..INT32_MAX
+ *
+ * and likewise for sub and mul, and for i8, i16, i64 and the unsigned
+ * u8 to u64. Both return the index of the first element that overflowed,
+ * or n if none did. dst may be a or b, to work in place.
+ */
+#ifndef CHECKED_H
+#define CHECKED_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__has_include)
+#if __has_include(<stdckdint.h>)
+#include <stdckdint.h>
+#endif
+#endif
+#ifndef ckd_add
+#define ckd_add(r, a, b) __builtin_add_overflow((a), (b), (r))
+#define ckd_sub(r, a, b) __builtin_sub_overflow((a), (b), (r))
+#define ckd_mul(r, a, b) __builtin_mul_overflow((a), (b), (r))
+#endif
+
+#define CHECKED_DECLARE(sfx, T)                                               \
+    size_t checked_add_##sfx(T *dst, const T *a, const T *b, size_t n);      \
+    size_t checked_sub_##sfx(T *dst, const T *a, const T *b, size_t n);      \
+    size_t checked_mul_##sfx(T *dst, const T *a, const T *b, size_t n);      \
+    size_t saturate_add_##sfx(T *dst, const T *a, const T *b, size_t n);     \
+    size_t saturate_sub_##sfx(T *dst, const T *a, const T *b, size_t n);     \
+    size_t saturate_mul_##sfx(T *dst, const T *a, const T *b, size_t n);
+
+CHECKED_DECLARE(i8, int8_t)
+CHECKED_DECLARE(i16, int16_t)
+CHECKED_DECLARE(i32, int32_t)
+CHECKED_DECLARE(i64, int64_t)
+CHECKED_DECLARE(u8, uint8_t)
+CHECKED_DECLARE(u16, uint16_t)
+CHECKED_DECLARE(u32, uint32_t)
+CHECKED_DECLARE(u64, uint64_t)
+
+#endif
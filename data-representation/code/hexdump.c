@@ -0,0 +1,394 @@
+/* hexdump: show every byte of a file in hex, 16 to a row, like xxd;
+ * show_bytes in endian.c grown up to keep pace with a disk.
+ *
+ * usage: hexdump [-t threads] [infile [outfile]]
+ *        hexdump -r [infile [outfile]]
+ *   -r  reverse: turn a dump back into the bytes it shows
+ *   -t  number of threads (default: one per CPU)
+ * Without infile/outfile, hexdump reads standard input and writes
+ * standard output.
+ *
+ * A row is the offset of its first byte, the bytes in hex in groups of
+ * two, and the bytes themselves with anything unprintable shown as '.':
+ *
+ *   00000000: 2369 6e63 6c75 6465 203c 7374 6469 6f2e  #include <stdio.
+ *
+ * show_bytes makes one printf call per byte, which has to parse its
+ * format string every time. Here each byte becomes its two hex digits
+ * with one lookup in a table of digit pairs, and its gutter character
+ * with one lookup in another; rows are built straight into one big
+ * buffer per block, which goes out with a single write. Every full row
+ * is the same length, so each thread knows where its rows go in the
+ * buffer without waiting for the others.
+ */
+#define _GNU_SOURCE 1
+#include <ctype.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "blockio.h"
+#include "parallel.h"
+
+#define ROW      16                 /* bytes per row */
+#define MINDIGIT 8                  /* offsets have at least this many digits */
+#define MAXDIGIT 16                 /* and at most this many */
+/* the length of a full row whose offset has w digits */
+#define ROWLEN(w) ((w) + 2 + 5 * ROW / 2 + 1 + ROW + 1)
+#define OUTSIZE  (1024 * 1024)      /* bytes -r collects between writes */
+
+/* the state kept across blocks while dumping */
+struct dump {
+    int nthreads;
+    int out;
+    unsigned long long off;         /* offset of the next block */
+    char *buf;                      /* the rows of one block */
+};
+
+/* one thread's share of the rows of a block */
+struct dumpjob {
+    const unsigned char *p;
+    size_t n;
+    unsigned long long off;
+    int width;                      /* digits in each offset */
+    char *out;
+    size_t len;                     /* characters written to out */
+};
+
+/* the state kept across blocks while undumping */
+struct undump {
+    int out;
+    unsigned long long pos;         /* bytes produced so far */
+    unsigned long long lineno;
+    unsigned char *buf;             /* bytes waiting to be written */
+    size_t nbuf;
+    char *line;                     /* a row split between two blocks */
+    size_t nline, maxline;
+};
+
+static const char digits[] = "0123456789abcdef";
+static char hexpair[256][2];        /* the two hex digits of each byte */
+static char gutter[256];            /* how each byte shows in the gutter */
+static signed char hexval[256];     /* the value of each hex digit, or -1 */
+
+static void make_tables(void);
+static int dump_block(const unsigned char *p, size_t n, void *arg);
+static void *dump_job(void *arg);
+static int undump_block(const unsigned char *p, size_t n, void *arg);
+static int undump_row(struct undump *u, const char *s, size_t len);
+static int flush(struct undump *u);
+
+int main(int argc, char *argv[])
+{
+    struct dump d;
+    struct undump u;
+    int c, reverse = 0, nthreads, in = 0, out = 1, rc;
+
+    nthreads = cpu_count();
+    while ((c = getopt(argc, argv, "rt:")) != -1)
+        switch (c) {
+        case 'r':
+            reverse = 1;
+            break;
+        case 't':
+            nthreads = atoi(optarg);
+            break;
+        default:
+            nthreads = 0;
+            break;
+        }
+    argc -= optind;
+    argv += optind;
+    if (nthreads < 1 || argc > 2) {
+        fprintf(stderr, "Usage: hexdump [-r] [-t threads] [infile [outfile]]\n");
+        return 1;
+    }
+    if (argc > 0 && (in = open(argv[0], O_RDONLY)) < 0) {
+        perror(argv[0]);
+        return 1;
+    }
+    if (argc > 1 && (out = open(argv[1], O_WRONLY | O_CREAT | O_TRUNC, 0666)) < 0) {
+        perror(argv[1]);
+        return 1;
+    }
+    make_tables();
+
+    if (!reverse) {
+        memset(&d, 0, sizeof(d));
+        d.nthreads = nthreads;
+        d.out = out;
+        if ((d.buf = malloc(ROWLEN(MAXDIGIT) * (BLOCKSIZE / ROW))) == NULL) {
+            perror("hexdump");
+            return 1;
+        }
+        rc = read_blocks(in, BLOCKSIZE, dump_block, &d);
+        free(d.buf);
+    } else {
+        memset(&u, 0, sizeof(u));
+        u.out = out;
+        if ((u.buf = malloc(OUTSIZE)) == NULL) {
+            perror("hexdump");
+            return 1;
+        }
+        rc = read_blocks(in, BLOCKSIZE, undump_block, &u);
+        /* the last row need not end in a newline */
+        if (rc == 0 && u.nline > 0)
+            rc = undump_row(&u, u.line, u.nline);
+        if (rc == 0)
+            rc = flush(&u);
+        free(u.buf);
+        free(u.line);
+    }
+    /* positive codes are bad input, already reported */
+    if (rc < 0)
+        perror("hexdump");
+    if (out != 1 && close(out) < 0) {
+        perror(argv[1]);
+        return 1;
+    }
+    return rc != 0;
+}
+
+static void make_tables(void)
+{
+    int b;
+
+    for (b = 0; b < 256; b++) {
+        hexpair[b][0] = digits[b >> 4];
+        hexpair[b][1] = digits[b & 15];
+        gutter[b] = b >= ' ' && b < 127 ? b : '.';
+        hexval[b] = -1;
+    }
+    for (b = 0; b < 16; b++) {
+        hexval[(unsigned char)digits[b]] = b;
+        hexval[toupper(digits[b])] = b;
+    }
+}
+
+/* return the number of digits the offset of a row needs */
+static int offset_width(unsigned long long off)
+{
+    int w;
+
+    for (w = MINDIGIT; w < MAXDIGIT && off >> (4 * w) != 0; w++)
+        ;
+    return w;
+}
+
+/* dump the n bytes at p into the output of the dump in arg, splitting
+ * the rows across threads; return 0 on success, -1 on a write error */
+static int dump_block(const unsigned char *p, size_t n, void *arg)
+{
+    struct dump *d = arg;
+    struct dumpjob job[MAXTHREADS];
+    size_t rows, share, len;
+    int i, njobs, width;
+
+    /* every block but the last is BLOCKSIZE bytes, a power of 16, so a
+     * block never straddles an offset where the width grows: sizing all
+     * its rows by its last row gives each row the width it needs */
+    rows = (n + ROW - 1) / ROW;
+    width = offset_width(d->off + (rows - 1) * ROW);
+    njobs = job_count(n, PARALLEL_MINSHARE, d->nthreads);
+    share = rows / njobs;
+    for (i = 0; i < njobs; i++) {
+        job[i].p = p + i * share * ROW;
+        job[i].n = i < njobs - 1 ? share * ROW : n - i * share * ROW;
+        job[i].off = d->off + i * share * ROW;
+        job[i].width = width;
+        job[i].out = d->buf + i * share * ROWLEN(width);
+    }
+    run_parallel(dump_job, job, sizeof(job[0]), njobs);
+    /* only the last job can end in a short row, so the rows are
+     * already side by side in the buffer */
+    for (i = 0, len = 0; i < njobs; i++)
+        len += job[i].len;
+    d->off += n;
+    return write_all(d->out, d->buf, len);
+}
+
+/* format the n (at most ROW) bytes at p, which start at offset off,
+ * as a row at o; return the end of the row */
+static inline char *format_row(char *o, const unsigned char *p, size_t n,
+                               unsigned long long off, int width)
+{
+    size_t i;
+    int k;
+
+    for (k = width - 1; k >= 0; k--, off >>= 4)
+        o[k] = digits[off & 15];
+    o += width;
+    *o++ = ':';
+    *o++ = ' ';
+    for (i = 0; i < ROW; i++) {
+        if (i < n)
+            memcpy(o, hexpair[p[i]], 2);
+        else
+            o[0] = o[1] = ' ';
+        o += 2;
+        if (i % 2 == 1)
+            *o++ = ' ';
+    }
+    *o++ = ' ';
+    for (i = 0; i < n; i++)
+        *o++ = gutter[p[i]];
+    *o++ = '\n';
+    return o;
+}
+
+static void *dump_job(void *arg)
+{
+    struct dumpjob *job = arg;
+    char *o = job->out;
+    size_t i;
+
+    /* full rows get a constant n, so the compiler can unroll them */
+    for (i = 0; i + ROW <= job->n; i += ROW)
+        o = format_row(o, job->p + i, ROW, job->off + i, job->width);
+    if (i < job->n)
+        o = format_row(o, job->p + i, job->n - i, job->off + i, job->width);
+    job->len = o - job->out;
+    return NULL;
+}
+
+/* turn the rows in the n bytes at p back into bytes; a row cut off at
+ * the end of the block is kept until the next block finishes it.
+ * Return 0 on success, -1 on a write error, 1 on a bad row */
+static int undump_block(const unsigned char *p, size_t n, void *arg)
+{
+    struct undump *u = arg;
+    const unsigned char *nl, *end = p + n;
+    size_t len;
+    char *bigger;
+    int rc;
+
+    if (u->nline > 0) {
+        nl = memchr(p, '\n', n);
+        len = (nl != NULL ? nl : end) - p;
+        if (u->nline + len > u->maxline) {
+            if ((bigger = realloc(u->line, 2 * (u->nline + len))) == NULL)
+                return -1;
+            u->line = bigger;
+            u->maxline = 2 * (u->nline + len);
+        }
+        memcpy(u->line + u->nline, p, len);
+        u->nline += len;
+        if (nl == NULL)
+            return 0;
+        if ((rc = undump_row(u, u->line, u->nline)) != 0)
+            return rc;
+        u->nline = 0;
+        p = nl + 1;
+    }
+    while ((nl = memchr(p, '\n', end - p)) != NULL) {
+        if ((rc = undump_row(u, (const char *)p, nl - p)) != 0)
+            return rc;
+        p = nl + 1;
+    }
+    if (p < end) {
+        if ((size_t)(end - p) > u->maxline) {
+            free(u->line);
+            if ((u->line = malloc(end - p)) == NULL)
+                return -1;
+            u->maxline = end - p;
+        }
+        memcpy(u->line, p, end - p);
+        u->nline = end - p;
+    }
+    return 0;
+}
+
+/* make room for at least n more bytes in the output buffer;
+ * return 0 on success, -1 on a write error */
+static int reserve(struct undump *u, size_t n)
+{
+    return u->nbuf + n > OUTSIZE ? flush(u) : 0;
+}
+
+/* decode a full row's hex at s, laid out the way dump_block lays it out,
+ * into the output; return 0 if it is not laid out that way */
+static int undump_full(struct undump *u, const unsigned char *s)
+{
+    unsigned char *o = u->buf + u->nbuf;
+    int i, bad = 0;
+
+    for (i = 0; i < ROW; i += 2, s += 5) {
+        /* a -1 anywhere leaves the sign bit set in bad */
+        bad |= hexval[s[0]] | hexval[s[1]] | hexval[s[2]] | hexval[s[3]]
+               | (s[4] == ' ' ? 0 : -1);
+        o[i] = hexval[s[0]] << 4 | hexval[s[1]];
+        o[i + 1] = hexval[s[2]] << 4 | hexval[s[3]];
+    }
+    if (bad < 0)
+        return 0;
+    u->nbuf += ROW;
+    return 1;
+}
+
+/* turn one row of len characters at s back into the bytes it shows.
+ * Bytes come in pairs of hex digits, maybe split up by single spaces;
+ * two spaces in a row end them, so the gutter is never read as hex.
+ * Rows must come in order; a gap between them is filled with zeros.
+ * Return 0 on success, -1 on a write error, 1 on a bad row */
+static int undump_row(struct undump *u, const char *s, size_t len)
+{
+    const unsigned char *r = (const unsigned char *)s;
+    unsigned long long off = 0;
+    size_t i, gap;
+
+    u->lineno++;
+    if (len > 0 && r[len - 1] == '\r')
+        len--;
+    if (len == 0)
+        return 0;
+    for (i = 0; i < len && i < MAXDIGIT && hexval[r[i]] >= 0; i++)
+        off = off << 4 | hexval[r[i]];
+    if (i == 0 || i >= len || r[i] != ':') {
+        fprintf(stderr, "hexdump: line %llu: no offset\n", u->lineno);
+        return 1;
+    }
+    if (off < u->pos) {
+        fprintf(stderr, "hexdump: line %llu: rows out of order\n", u->lineno);
+        return 1;
+    }
+    for ( ; u->pos < off; u->pos += gap) {
+        gap = off - u->pos < OUTSIZE ? off - u->pos : OUTSIZE;
+        if (reserve(u, gap) < 0)
+            return -1;
+        memset(u->buf + u->nbuf, 0, gap);
+        u->nbuf += gap;
+    }
+    i++;
+    if (reserve(u, ROW) < 0)
+        return -1;
+    if (len - i >= 1 + 5 * ROW / 2 + 1 && r[i] == ' ' && r[i + 1 + 5 * ROW / 2] == ' '
+        && undump_full(u, r + i + 1)) {
+        u->pos += ROW;
+        return 0;
+    }
+    while (i < len) {
+        if (r[i] == ' ') {
+            if (i + 1 < len && r[i + 1] == ' ')
+                break;
+            i++;
+        } else if (i + 1 < len && hexval[r[i]] >= 0 && hexval[r[i + 1]] >= 0) {
+            if (reserve(u, 1) < 0)
+                return -1;
+            u->buf[u->nbuf++] = hexval[r[i]] << 4 | hexval[r[i + 1]];
+            u->pos++;
+            i += 2;
+        } else
+            break;
+    }
+    return 0;
+}
+
+/* write out the bytes collected so far; return 0 or -1 on error */
+static int flush(struct undump *u)
+{
+    if (write_all(u->out, u->buf, u->nbuf) < 0)
+        return -1;
+    u->nbuf = 0;
+    return 0;
+}
@@ -0,0 +1,200 @@
+/* iplookup: say which AWS region and service each address belongs to.
+ *
+ * usage: iplookup [-c] [-f field] [-t threads] ranges.json [file]
+ *   -c  print how many addresses fell in each region and service
+ *       instead, most first
+ *   -f  take the address from this field of each line (counting from
+ *       1, fields split by spaces and tabs), as in a VPC flow log,
+ *       where srcaddr is field 4 (default 1)
+ * ranges.json is AWS's ip-ranges.json (see ipranges.h). For each line
+ * of the input, iplookup prints the address, the region and the service
+ * of the longest range that holds it, separated by tabs, or "-" for both
+ * if none does or it is not an address.
+ *
+ * Lines are taken a batch at a time, so the IPv6 lookups of a batch can
+ * go side by side (see iptrie_find_batch). IPv4 addresses are looked up
+ * one at a time: their walks are short, and batching them measured
+ * slower in iptriebench.
+ */
+#define _GNU_SOURCE 1
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "blockio.h"
+#include "fmtbuf.h"
+#include "ipranges.h"
+#include "parallel.h"
+
+#define BATCH 4096
+
+/* one batch of lines, and their addresses split by kind */
+struct batch {
+    struct strview addr[BATCH];     /* the field looked up */
+    int family[BATCH];              /* 4, 6, or -1 if not an address */
+    size_t slot[BATCH];             /* where its address is in a4 or a6 */
+    struct ipaddr a4[BATCH], a6[BATCH];
+    uint16_t v4[BATCH], v6[BATCH];
+    size_t n, n4, n6;
+};
+
+static struct strview field(struct strview line, int f);
+static void classify(const struct ipranges *r, struct batch *b);
+
+int main(int argc, char *argv[])
+{
+    static struct batch b;
+    struct ipranges r;
+    struct input in;
+    struct fmtbuf out;
+    struct ipclass *cls;
+    struct strview line;
+    const char *name;
+    uint64_t *count;
+    unsigned v;
+    size_t pos, i, *order;
+    int c, fd, f = 1, counting = 0, nthreads, rc = 0;
+    const char *nl;
+
+    nthreads = cpu_count();
+    while ((c = getopt(argc, argv, "cf:t:")) != -1)
+        switch (c) {
+        case 'c':
+            counting = 1;
+            break;
+        case 'f':
+            f = atoi(optarg);
+            break;
+        case 't':
+            nthreads = atoi(optarg);
+            break;
+        default:
+            f = 0;
+        }
+    if (f < 1 || nthreads < 1 || argc - optind < 1 || argc - optind > 2) {
+        fprintf(stderr, "Usage: iplookup [-c] [-f field] [-t threads] ranges.json [file]\n");
+        return 1;
+    }
+    if ((fd = open(argv[optind], O_RDONLY)) < 0 || ipranges_load(&r, fd, nthreads) < 0) {
+        if (fd >= 0 && errno == EINVAL)
+            fprintf(stderr, "iplookup: %s: not a list of ranges like ip-ranges.json\n", argv[optind]);
+        else
+            perror(argv[optind]);
+        return 1;
+    }
+    close(fd);
+    name = optind + 1 < argc ? argv[optind + 1] : "standard input";
+    fd = optind + 1 < argc ? open(name, O_RDONLY) : 0;
+    if (fd < 0 || map_input(fd, &in) < 0) {
+        perror(name);
+        return 1;
+    }
+
+    /* the class of no range is 0, shown as "-" */
+    cls = r.cls;
+    cls[0].region = cls[0].service = sv_fromstr("-");
+    if ((count = calloc(r.ncls + 1, sizeof(count[0]))) == NULL) {
+        perror("iplookup");
+        return 1;
+    }
+    fb_init(&out);
+    for (pos = 0; pos < in.n; ) {
+        for (b.n = 0; b.n < BATCH && pos < in.n; b.n++) {
+            nl = memchr(in.p + pos, '\n', in.n - pos);
+            line = sv_make((const char *)in.p + pos, nl != NULL ? nl - (const char *)in.p - pos : in.n - pos);
+            pos += line.len + 1;
+            b.addr[b.n] = field(line, f);
+        }
+        classify(&r, &b);
+        for (i = 0; i < b.n; i++) {
+            v = b.family[i] == 4 ? b.v4[b.slot[i]] : b.family[i] == 6 ? b.v6[b.slot[i]] : 0;
+            count[v]++;
+            if (counting)
+                continue;
+            fb_mem(&out, b.addr[i].ptr, b.addr[i].len);
+            fb_char(&out, '\t');
+            fb_mem(&out, cls[v].region.ptr, cls[v].region.len);
+            fb_char(&out, '\t');
+            fb_mem(&out, cls[v].service.ptr, cls[v].service.len);
+            fb_char(&out, '\n');
+        }
+        if (out.err || write_all(1, out.p, out.len) < 0) {
+            perror("iplookup");
+            return 1;
+        }
+        fb_reset(&out);
+    }
+
+    if (counting) {
+        if ((order = malloc((r.ncls + 1) * sizeof(order[0]))) == NULL) {
+            perror("iplookup");
+            return 1;
+        }
+        /* most first, by a straight insertion sort: there are only as
+         * many classes as regions times services */
+        for (i = 0; i <= r.ncls; i++) {
+            for (pos = i; pos > 0 && count[order[pos - 1]] < count[i]; pos--)
+                order[pos] = order[pos - 1];
+            order[pos] = i;
+        }
+        for (i = 0; i <= r.ncls && count[order[i]] > 0; i++) {
+            v = order[i];
+            fb_uint(&out, count[v], 7, -1);
+            fb_char(&out, ' ');
+            fb_mem(&out, cls[v].region.ptr, cls[v].region.len);
+            fb_char(&out, ' ');
+            fb_mem(&out, cls[v].service.ptr, cls[v].service.len);
+            fb_char(&out, '\n');
+        }
+        if (out.err || write_all(1, out.p, out.len) < 0)
+            rc = 1;
+        free(order);
+    }
+    fb_free(&out);
+    free(count);
+    unmap_input(&in);
+    ipranges_free(&r);
+    return rc;
+}
+
+/* field f of line, counting from 1; empty if it has fewer */
+static struct strview field(struct strview line, int f)
+{
+    size_t i = 0, start;
+
+    for (;;) {
+        while (i < line.len && (line.ptr[i] == ' ' || line.ptr[i] == '\t' || line.ptr[i] == '\r'))
+            i++;
+        start = i;
+        while (i < line.len && line.ptr[i] != ' ' && line.ptr[i] != '\t' && line.ptr[i] != '\r')
+            i++;
+        if (--f == 0 || i == line.len)
+            return sv_make(line.ptr + start, f == 0 ? i - start : 0);
+    }
+}
+
+/* parse the batch's addresses and look them all up */
+static void classify(const struct ipranges *r, struct batch *b)
+{
+    struct ipaddr a;
+    size_t i;
+    int len;
+
+    b->n4 = b->n6 = 0;
+    for (i = 0; i < b->n; i++) {
+        b->family[i] = ip_parse(b->addr[i].ptr, b->addr[i].len, &a, &len);
+        if (b->family[i] == 4) {
+            b->slot[i] = b->n4;
+            b->a4[b->n4++] = a;
+        } else if (b->family[i] == 6) {
+            b->slot[i] = b->n6;
+            b->a6[b->n6++] = a;
+        }
+    }
+    for (i = 0; i < b->n4; i++)
+        b->v4[i] = iptrie_find(&r->v4, b->a4[i]);
+    iptrie_find_batch(&r->v6, b->a6, b->n6, b->v6);
+}
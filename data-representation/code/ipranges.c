@@ -0,0 +1,161 @@
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ipranges.h"
+
+#define MAXCLASSES 0xFFFF   /* the most values a trie holds */
+
+/* what json_each hands add_range */
+struct loading {
+    struct ipranges *r;
+    const char *key;        /* "ip_prefix" or "ipv6_prefix" */
+    int family;             /* 4 or 6 */
+    int amazon;             /* add the AMAZON ranges (1) or the others (0) */
+};
+
+/* FNV-1a of v, going on from h */
+static uint64_t hash(struct strview v, uint64_t h)
+{
+    size_t i;
+
+    for (i = 0; i < v.len; i++)
+        h = (h ^ (unsigned char)v.ptr[i]) * 0x100000001b3ULL;
+    return h;
+}
+
+static uint64_t hash_class(struct strview region, struct strview service)
+{
+    return hash(service, hash(region, 0xcbf29ce484222325ULL) ^ '\t');
+}
+
+/* make the hash table of classes twice as big (a class number in each
+ * slot, 0 in the empty ones, never more than half full) and the list of
+ * classes as big as it can then get; return -1 if memory runs out */
+static int grow_classes(struct ipranges *r)
+{
+    size_t n = r->nslots > 0 ? 2 * r->nslots : 256, i, k, *slot;
+    struct ipclass *cls;
+
+    if ((cls = realloc(r->cls, (n / 2 + 1) * sizeof(cls[0]))) == NULL)
+        return -1;
+    r->cls = cls;
+    if ((slot = calloc(n, sizeof(slot[0]))) == NULL)
+        return -1;
+    for (k = 1; k <= r->ncls; k++) {
+        for (i = hash_class(cls[k].region, cls[k].service) & (n - 1); slot[i] != 0; i = (i + 1) & (n - 1))
+            ;
+        slot[i] = k;
+    }
+    free(r->slot);
+    r->slot = slot;
+    r->nslots = n;
+    return 0;
+}
+
+/* the number of the class of region and service, which is added if it
+ * is new; 0 if memory runs out or there are too many classes */
+static unsigned class_of(struct ipranges *r, struct strview region, struct strview service)
+{
+    size_t i, k;
+
+    if (2 * (r->ncls + 1) > r->nslots && grow_classes(r) < 0)
+        return 0;
+    for (i = hash_class(region, service) & (r->nslots - 1); (k = r->slot[i]) != 0;
+         i = (i + 1) & (r->nslots - 1))
+        if (sv_eq(r->cls[k].region, region) && sv_eq(r->cls[k].service, service))
+            return k;
+    if (r->ncls == MAXCLASSES)
+        return 0;
+    k = ++r->ncls;
+    r->cls[k].region = region;
+    r->cls[k].service = service;
+    r->slot[i] = k;
+    return k;
+}
+
+/* add the range in the object at entry k, if it is one of the kind
+ * being added; return 0, or -1 with errno EINVAL if it is not a range */
+static int add_range(const struct jsonidx *ix, size_t k, void *arg)
+{
+    struct loading *l = arg;
+    size_t prefix = json_member(ix, k, sv_fromstr(l->key));
+    size_t region = json_member(ix, k, sv_fromstr("region"));
+    size_t service = json_member(ix, k, sv_fromstr("service"));
+    struct strview v;
+    struct ipaddr a;
+    unsigned c;
+    int len;
+
+    if (json_type(ix, prefix) != '"' || json_type(ix, region) != '"'
+        || json_type(ix, service) != '"') {
+        errno = EINVAL;
+        return -1;
+    }
+    if (sv_eq(json_value(ix, service), sv_fromstr("AMAZON")) != l->amazon)
+        return 0;
+    v = json_value(ix, prefix);
+    if (ip_parse(v.ptr, v.len, &a, &len) != l->family) {
+        errno = EINVAL;
+        return -1;
+    }
+    if ((c = class_of(l->r, json_value(ix, region), json_value(ix, service))) == 0) {
+        errno = ENOMEM;
+        return -1;
+    }
+    return iptrie_add(l->family == 4 ? &l->r->v4 : &l->r->v6, a, len, c);
+}
+
+/* read the ranges from fd, indexing the JSON with up to nthreads
+ * threads; return 0, or -1 with errno EINVAL if it is not an
+ * ip-ranges.json, or the error that stopped it */
+int ipranges_load(struct ipranges *r, int fd, int nthreads)
+{
+    static const struct {
+        const char *path, *key;
+        int family;
+    } lists[] = {
+        { "prefixes[]", "ip_prefix", 4 },
+        { "ipv6_prefixes[]", "ipv6_prefix", 6 },
+    };
+    struct loading l;
+    int i, err;
+
+    memset(r, 0, sizeof(*r));
+    iptrie_init(&r->v4, 32);
+    iptrie_init(&r->v6, 128);
+    if (grow_classes(r) < 0 || map_input(fd, &r->in) < 0
+        || json_index(&r->ix, (const char *)r->in.p, r->in.n, nthreads) < 0)
+        goto fail;
+    /* AMAZON first, so that another service listing the same range
+     * replaces it */
+    l.r = r;
+    for (l.amazon = 1; l.amazon >= 0; l.amazon--)
+        for (i = 0; i < 2; i++) {
+            l.key = lists[i].key;
+            l.family = lists[i].family;
+            if (json_each(&r->ix, lists[i].path, add_range, &l) != 0)
+                goto fail;
+        }
+    if (iptrie_build(&r->v4) < 0 || iptrie_build(&r->v6) < 0)
+        goto fail;
+    return 0;
+fail:
+    err = errno;
+    ipranges_free(r);
+    errno = err;
+    return -1;
+}
+
+void ipranges_free(struct ipranges *r)
+{
+    iptrie_free(&r->v4);
+    iptrie_free(&r->v6);
+    free(r->cls);
+    free(r->slot);
+    json_free(&r->ix);
+    unmap_input(&r->in);
+    r->cls = NULL;
+    r->slot = NULL;
+    r->ncls = r->nslots = 0;
+}
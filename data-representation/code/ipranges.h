@@ -0,0 +1,44 @@
+/* the address ranges of AWS's ip-ranges.json, ready to look up.
+ *
+ * The file lists each range as an object such as
+ *     { "ip_prefix": "3.2.34.0/26", "region": "af-south-1",
+ *       "service": "AMAZON", "network_border_group": "af-south-1" }
+ * under "prefixes", and the IPv6 ones under "ipv6_prefixes" with
+ * "ipv6_prefix" instead. Each different pair of region and service is
+ * a class, numbered from 1, and the ranges go into one trie per kind of
+ * address mapping them to their class (see iptrie.h).
+ *
+ * AWS lists every range under AMAZON as well as under the service that
+ * uses it, so where the same range is listed more than once, the class
+ * of a service other than AMAZON wins.
+ *
+ * The names point into the file, which stays mapped until ipranges_free.
+ */
+#ifndef IPRANGES_H
+#define IPRANGES_H
+
+#include <stddef.h>
+#include "blockio.h"
+#include "iptrie.h"
+#include "jsonidx.h"
+#include "strview.h"
+
+struct ipclass {
+    struct strview region;
+    struct strview service;
+};
+
+struct ipranges {
+    struct input in;
+    struct jsonidx ix;
+    struct ipclass *cls;    /* cls[1] to cls[ncls]; a lookup of 0 is none */
+    size_t ncls;
+    size_t *slot;           /* a hash table of the classes, for loading */
+    size_t nslots;
+    struct iptrie v4, v6;
+};
+
+int ipranges_load(struct ipranges *r, int fd, int nthreads);
+void ipranges_free(struct ipranges *r);
+
+#endif
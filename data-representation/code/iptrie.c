@@ -0,0 +1,428 @@
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include "iptrie.h"
+
+#define DIRECTBITS 16
+#define BATCH 8             /* lookups side by side in iptrie_find_batch */
+
+int iptrie_init(struct iptrie *t, int bits)
+{
+    memset(t, 0, sizeof(*t));
+    if (bits != 32 && bits != 128) {
+        errno = EINVAL;
+        return -1;
+    }
+    t->bits = bits;
+    return 0;
+}
+
+void iptrie_free(struct iptrie *t)
+{
+    free(t->prefix);
+    free(t->direct);
+    free(t->node);
+    free(t->leaf);
+    iptrie_init(t, t->bits);
+}
+
+/* the array p of cap items of size bytes, made bigger if need be to
+ * hold need; NULL if memory runs out, when p is left as it was */
+static void *grow(void *p, size_t *cap, size_t need, size_t size)
+{
+    size_t c = *cap > 0 ? *cap : 64;
+
+    while (c < need)
+        c *= 2;
+    if (c == *cap)
+        return p;
+    if ((p = realloc(p, c * size)) != NULL)
+        *cap = c;
+    return p;
+}
+
+/* a with the bits from len on cleared */
+static struct ipaddr clear_from(struct ipaddr a, int len)
+{
+    if (len < 64) {
+        a.hi &= len == 0 ? 0 : ~(uint64_t)0 << (64 - len);
+        a.lo = 0;
+    } else if (len < 128)
+        a.lo &= len == 64 ? 0 : ~(uint64_t)0 << (128 - len);
+    return a;
+}
+
+/* add the prefix of the first len bits of a, mapping to value (1 to
+ * 65535); return 0, or -1 if len or value is out of range or memory
+ * runs out. The trie needs building again afterwards. */
+int iptrie_add(struct iptrie *t, struct ipaddr a, int len, unsigned value)
+{
+    struct ipprefix *p;
+
+    if (len < 0 || len > t->bits || value < 1 || value > 0xFFFF) {
+        errno = EINVAL;
+        return -1;
+    }
+    if ((p = grow(t->prefix, &t->prefixcap, t->nprefixes + 1, sizeof(p[0]))) == NULL)
+        return -1;
+    t->prefix = p;
+    p = &t->prefix[t->nprefixes++];
+    p->addr = clear_from(a, len);
+    p->len = len;
+    p->value = value;
+    return 0;
+}
+
+/* the n bits of a from bit off on; they never straddle hi and lo */
+static inline unsigned bits_at(struct ipaddr a, unsigned off, unsigned n)
+{
+    return off < 64 ? a.hi << off >> (64 - n) : a.lo << (off - 64) >> (64 - n);
+}
+
+/* by address, then shorter first, then in the order added: the
+ * pointers point into the array of prefixes as added */
+static int by_address(const void *x, const void *y)
+{
+    const struct ipprefix *a = *(const struct ipprefix *const *)x;
+    const struct ipprefix *b = *(const struct ipprefix *const *)y;
+
+    if (a->addr.hi != b->addr.hi)
+        return a->addr.hi < b->addr.hi ? -1 : 1;
+    if (a->addr.lo != b->addr.lo)
+        return a->addr.lo < b->addr.lo ? -1 : 1;
+    if (a->len != b->len)
+        return a->len - b->len;
+    return (a > b) - (a < b);
+}
+
+/* share the n prefixes at p, sorted by address, all longer than off and
+ * all starting with the same off bits, among the 2^stride children of
+ * the node they are in. A prefix that ends within the stride covers a
+ * run of children, and sets their value unless a longer prefix already
+ * has (len holds the length of the prefix that set each value; the
+ * caller starts it at -1). The rest go to the child they pass through:
+ * sorted by address, the ones for a child come one after another, from
+ * start for count. */
+static void share(const struct ipprefix **p, size_t n, unsigned off, unsigned stride,
+                  uint16_t *value, short *len, size_t *start, size_t *count)
+{
+    size_t i, c, span;
+
+    for (i = 0; i < n; i++) {
+        c = bits_at(p[i]->addr, off, stride);
+        if ((unsigned)p[i]->len > off + stride) {
+            if (count[c]++ == 0)
+                start[c] = i;
+            continue;
+        }
+        for (span = (size_t)1 << (off + stride - p[i]->len); span > 0; span--, c++)
+            if (p[i]->len >= len[c]) {
+                value[c] = p[i]->value;
+                len[c] = p[i]->len;
+            }
+    }
+}
+
+/* make node k for the n prefixes at p, which are longer than off and
+ * start with the same off bits; inherit is the value of the longest
+ * prefix that covers the whole node. Return 0, or -1 if memory runs out. */
+static int build_node(struct iptrie *t, size_t k, const struct ipprefix **p, size_t n,
+                      unsigned off, unsigned inherit)
+{
+    uint16_t value[64];
+    short len[64];
+    size_t start[64], count[64], base1;
+    struct ipnode node = { 0, 0, 0, 0 }, *nodes;
+    uint16_t *leaves;
+    int c, prev = -1;
+
+    for (c = 0; c < 64; c++) {
+        value[c] = inherit;
+        len[c] = -1;
+        count[c] = 0;
+    }
+    share(p, n, off, 6, value, len, start, count);
+    for (c = 0; c < 64; c++)
+        if (count[c] > 0)
+            node.vector |= (uint64_t)1 << c;
+    /* one leaf for each run of children with the same value, runs
+     * carrying on across the children that are nodes */
+    node.base0 = t->nleaves;
+    for (c = 0; c < 64; c++)
+        if (count[c] == 0 && value[c] != prev) {
+            if ((leaves = grow(t->leaf, &t->leafcap, t->nleaves + 1, sizeof(leaves[0]))) == NULL)
+                return -1;
+            t->leaf = leaves;
+            t->leaf[t->nleaves++] = value[c];
+            node.leafvec |= (uint64_t)1 << c;
+            prev = value[c];
+        }
+    /* the child nodes side by side; grow can move the array, so nodes
+     * are kept by number, never by pointer */
+    base1 = t->nnodes;
+    t->nnodes += __builtin_popcountll(node.vector);
+    if ((nodes = grow(t->node, &t->nodecap, t->nnodes, sizeof(nodes[0]))) == NULL)
+        return -1;
+    t->node = nodes;
+    node.base1 = base1;
+    t->node[k] = node;
+    for (c = 0; c < 64; c++)
+        if (count[c] > 0 && build_node(t, base1++, p + start[c], count[c], off + 6, value[c]) < 0)
+            return -1;
+    return 0;
+}
+
+/* make the trie from the prefixes added so far; return 0, or -1 if
+ * memory runs out */
+int iptrie_build(struct iptrie *t)
+{
+    const struct ipprefix **p = malloc((t->nprefixes + 1) * sizeof(p[0]));
+    uint16_t *value = malloc((1 << DIRECTBITS) * sizeof(value[0]));
+    short *len = malloc((1 << DIRECTBITS) * sizeof(len[0]));
+    size_t *start = malloc((1 << DIRECTBITS) * sizeof(start[0]));
+    size_t *count = calloc(1 << DIRECTBITS, sizeof(count[0]));
+    struct ipnode *nodes;
+    size_t i, k;
+    int rc = -1;
+
+    free(t->direct);
+    free(t->node);
+    free(t->leaf);
+    t->node = NULL;
+    t->leaf = NULL;
+    t->nnodes = t->nodecap = t->nleaves = t->leafcap = 0;
+    t->direct = malloc((1 << DIRECTBITS) * sizeof(t->direct[0]));
+    if (p == NULL || value == NULL || len == NULL || start == NULL || count == NULL
+        || t->direct == NULL)
+        goto done;
+    for (i = 0; i < t->nprefixes; i++)
+        p[i] = &t->prefix[i];
+    qsort(p, t->nprefixes, sizeof(p[0]), by_address);
+    for (i = 0; i < 1 << DIRECTBITS; i++) {
+        value[i] = 0;
+        len[i] = -1;
+    }
+    share(p, t->nprefixes, 0, DIRECTBITS, value, len, start, count);
+    for (i = 0; i < 1 << DIRECTBITS; i++) {
+        t->direct[i] = value[i];
+        if (count[i] == 0)
+            continue;
+        if ((nodes = grow(t->node, &t->nodecap, t->nnodes + 1, sizeof(nodes[0]))) == NULL)
+            goto done;
+        t->node = nodes;
+        k = t->nnodes++;
+        t->direct[i] = IPTRIE_NODE | k;
+        if (build_node(t, k, p + start[i], count[i], DIRECTBITS, value[i]) < 0)
+            goto done;
+    }
+    rc = 0;
+done:
+    free(p);
+    free(value);
+    free(len);
+    free(start);
+    free(count);
+    return rc;
+}
+
+/* the value of the longest prefix that covers a, or 0 */
+static inline unsigned find_in(const struct iptrie *t, struct ipaddr a)
+{
+    const struct ipnode *n;
+    uint32_t d = t->direct[a.hi >> (64 - DIRECTBITS)];
+    uint64_t bit, below;
+    unsigned off;
+
+    if (!(d & IPTRIE_NODE))
+        return d;
+    for (n = &t->node[d & ~IPTRIE_NODE], off = DIRECTBITS; ; off += 6) {
+        bit = (uint64_t)1 << bits_at(a, off, 6);
+        below = bit | (bit - 1);        /* bits 0..i */
+        if (!(n->vector & bit))
+            return t->leaf[n->base0 + __builtin_popcountll(n->leafvec & below) - 1];
+        n = &t->node[n->base1 + __builtin_popcountll(n->vector & below) - 1];
+    }
+}
+
+/* find_in for n addresses, BATCH at a time: each step takes every one
+ * still going down one level, and asks for the node it needs next
+ * before going on to the others */
+static inline void find_batch_in(const struct iptrie *t, const struct ipaddr *a, size_t n,
+                                 uint16_t *value)
+{
+    const struct ipnode *node[BATCH];
+    uint64_t bit, below;
+    uint32_t d;
+    unsigned live, off, j;
+    size_t i;
+
+    for (i = 0; i + BATCH <= n; i += BATCH) {
+        for (j = 0, live = 0; j < BATCH; j++) {
+            d = t->direct[a[i + j].hi >> (64 - DIRECTBITS)];
+            value[i + j] = d;
+            if (d & IPTRIE_NODE) {
+                node[j] = &t->node[d & ~IPTRIE_NODE];
+                __builtin_prefetch(node[j]);
+                live |= 1u << j;
+            }
+        }
+        for (off = DIRECTBITS; live != 0; off += 6)
+            for (j = 0; j < BATCH; j++) {
+                if (!(live >> j & 1))
+                    continue;
+                bit = (uint64_t)1 << bits_at(a[i + j], off, 6);
+                below = bit | (bit - 1);
+                if (node[j]->vector & bit) {
+                    node[j] = &t->node[node[j]->base1
+                                       + __builtin_popcountll(node[j]->vector & below) - 1];
+                    __builtin_prefetch(node[j]);
+                } else {
+                    value[i + j] = t->leaf[node[j]->base0
+                                           + __builtin_popcountll(node[j]->leafvec & below) - 1];
+                    live &= ~(1u << j);
+                }
+            }
+    }
+    for ( ; i < n; i++)
+        value[i] = find_in(t, a[i]);
+}
+
+#if defined(__x86_64__)
+/* the same, inlined where __builtin_popcountll is the popcnt instruction
+ * rather than a bit-twiddling routine */
+__attribute__((target("popcnt")))
+static unsigned find_popcnt(const struct iptrie *t, struct ipaddr a)
+{
+    return find_in(t, a);
+}
+
+__attribute__((target("popcnt")))
+static void find_batch_popcnt(const struct iptrie *t, const struct ipaddr *a, size_t n,
+                              uint16_t *value)
+{
+    find_batch_in(t, a, n, value);
+}
+#endif
+
+/* the value of the longest prefix that covers a, or 0; t must have
+ * been built since the last prefix was added */
+unsigned iptrie_find(const struct iptrie *t, struct ipaddr a)
+{
+#if defined(__x86_64__)
+    if (__builtin_cpu_supports("popcnt"))
+        return find_popcnt(t, a);
+#endif
+    return find_in(t, a);
+}
+
+/* iptrie_find for each of the n addresses at a, into value */
+void iptrie_find_batch(const struct iptrie *t, const struct ipaddr *a, size_t n,
+                       uint16_t *value)
+{
+#if defined(__x86_64__)
+    if (__builtin_cpu_supports("popcnt")) {
+        find_batch_popcnt(t, a, n, value);
+        return;
+    }
+#endif
+    find_batch_in(t, a, n, value);
+}
+
+static int hexdigit(int c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if ((c | 0x20) >= 'a' && (c | 0x20) <= 'f')
+        return (c | 0x20) - 'a' + 10;
+    return -1;
+}
+
+/* read a decimal number of 1 to 3 digits, up to max, at s[*i] */
+static int decimal(const char *s, size_t n, size_t *i, int max)
+{
+    int v = 0, d;
+
+    for (d = 0; *i < n && d < 4 && s[*i] >= '0' && s[*i] <= '9'; d++, ++*i)
+        v = v * 10 + s[*i] - '0';
+    return d == 0 || d > 3 || v > max ? -1 : v;
+}
+
+/* a.b.c.d, into the top 32 bits of a */
+static int parse4(const char *s, size_t n, struct ipaddr *a)
+{
+    uint64_t v = 0;
+    size_t i = 0;
+    int k, b;
+
+    for (k = 0; k < 4; k++) {
+        if (k > 0 && (i >= n || s[i++] != '.'))
+            return -1;
+        if ((b = decimal(s, n, &i, 255)) < 0)
+            return -1;
+        v = v << 8 | b;
+    }
+    a->hi = v << 32;
+    a->lo = 0;
+    return i == n ? 0 : -1;
+}
+
+/* eight groups of 1 to 4 hex digits between colons, where one run of
+ * groups that are 0 can be left out as "::" */
+static int parse6(const char *s, size_t n, struct ipaddr *a)
+{
+    unsigned g[8], v;
+    int ng = 0, gap = -1, d, k;
+    size_t i = 0;
+
+    if (n >= 2 && s[0] == ':' && s[1] == ':') {
+        gap = 0;
+        i = 2;
+    }
+    while (i < n) {
+        for (v = 0, d = 0; i < n && d < 5 && hexdigit(s[i]) >= 0; d++, i++)
+            v = v << 4 | hexdigit(s[i]);
+        if (d == 0 || d > 4 || ng == 8)
+            return -1;
+        g[ng++] = v;
+        if (i == n)
+            break;
+        if (s[i++] != ':' || i == n)
+            return -1;
+        if (s[i] == ':') {
+            if (gap >= 0)
+                return -1;
+            gap = ng;
+            i++;
+        }
+    }
+    if (gap < 0 ? ng != 8 : ng > 7)
+        return -1;
+    a->hi = a->lo = 0;
+    for (k = 0; k < ng; k++) {
+        /* the groups after the gap go at the end */
+        d = gap >= 0 && k >= gap ? k + 8 - ng : k;
+        if (d < 4)
+            a->hi |= (uint64_t)g[k] << (48 - 16 * d);
+        else
+            a->lo |= (uint64_t)g[k] << (48 - 16 * (d - 4));
+    }
+    return 0;
+}
+
+/* read the n characters at s as an IPv4 or IPv6 address, with or
+ * without a /length after it, into a and *len (the full 32 or 128 bits
+ * if there is no length); return 4 or 6 for the kind of address, or -1
+ * if it is neither */
+int ip_parse(const char *s, size_t n, struct ipaddr *a, int *len)
+{
+    const char *slash = memchr(s, '/', n);
+    size_t m = slash != NULL ? (size_t)(slash - s) : n, i = m + 1;
+    int v6 = memchr(s, ':', m) != NULL;
+
+    if ((v6 ? parse6(s, m, a) : parse4(s, m, a)) < 0)
+        return -1;
+    *len = v6 ? 128 : 32;
+    if (slash != NULL && ((*len = decimal(s, n, &i, *len)) < 0 || i != n))
+        return -1;
+    return v6 ? 6 : 4;
+}
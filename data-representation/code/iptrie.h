@@ -0,0 +1,83 @@
+/* longest-prefix match for IPv4 and IPv6 addresses: which of a set of
+ * prefixes such as 3.2.34.0/26 is the longest to cover an address.
+ *
+ * The trie is a poptrie (Asai and Ohara, "Poptrie: A Compressed Trie
+ * with Population Count for Fast and Scalable Software IP Routing
+ * Table Lookup", 2015). The first 16 bits of an address index a table
+ * of 65536 entries directly; after that each node takes 6 more bits,
+ * which pick one of its 64 children. A node does not keep 64 pointers.
+ * It keeps two 64-bit masks: vector, with bit i set if child i is a
+ * node, and leafvec, with bit i set where a run of equal answers (leaves)
+ * starts. A node's child nodes sit side by side from base1, and its
+ * leaves from base0, so the child for bits i is found by counting,
+ * with the masks of bits.c and a popcount:
+ *
+ *     node i:  base1 + popcount(vector & bits 0..i) - 1
+ *     leaf i:  base0 + popcount(leafvec & bits 0..i) - 1
+ *
+ * That makes a node 24 bytes, and the whole set of AWS's ranges fits in
+ * cache. Runs of the same answer take one leaf, so a short prefix that
+ * covers many children costs little.
+ *
+ * iptrie_find_batch looks up several addresses side by side, so that
+ * while one waits for its node to come from memory the others go on.
+ * How much that gains depends on how much of it the processor already
+ * does across separate calls; iptriebench times both. Here it pays for
+ * IPv6, whose walks are deeper, but not for IPv4, which iplookup
+ * therefore looks up one at a time.
+ *
+ * Prefixes are added with iptrie_add, then iptrie_build makes the trie.
+ * A prefix added twice keeps the later value. Values are 1 to 65535; a
+ * lookup that no prefix covers gives 0.
+ */
+#ifndef IPTRIE_H
+#define IPTRIE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define IPTRIE_NODE 0x80000000u     /* a direct entry that is a node */
+
+/* an address as 128 bits, the first at the top of hi; an IPv4 address
+ * is the top 32 bits of hi, with the rest 0 */
+struct ipaddr {
+    uint64_t hi;
+    uint64_t lo;
+};
+
+/* a prefix as added, in the order added */
+struct ipprefix {
+    struct ipaddr addr;     /* with the bits past len cleared */
+    int len;
+    unsigned value;
+};
+
+struct ipnode {
+    uint64_t vector;        /* children that are nodes */
+    uint64_t leafvec;       /* children where a run of leaves starts */
+    uint32_t base0;         /* first leaf */
+    uint32_t base1;         /* first child node */
+};
+
+struct iptrie {
+    int bits;               /* 32 or 128 */
+    struct ipprefix *prefix;
+    size_t nprefixes, prefixcap;
+    /* made by iptrie_build */
+    uint32_t *direct;       /* 65536 values or IPTRIE_NODE | node */
+    struct ipnode *node;
+    size_t nnodes, nodecap;
+    uint16_t *leaf;
+    size_t nleaves, leafcap;
+};
+
+int iptrie_init(struct iptrie *t, int bits);
+int iptrie_add(struct iptrie *t, struct ipaddr a, int len, unsigned value);
+int iptrie_build(struct iptrie *t);
+void iptrie_free(struct iptrie *t);
+unsigned iptrie_find(const struct iptrie *t, struct ipaddr a);
+void iptrie_find_batch(const struct iptrie *t, const struct ipaddr *a, size_t n,
+                       uint16_t *value);
+int ip_parse(const char *s, size_t n, struct ipaddr *a, int *len);
+
+#endif
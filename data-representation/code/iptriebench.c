@@ -0,0 +1,259 @@
+/* check iptrie against a scan of every prefix, on made-up prefixes
+ * nested inside one another and on the ranges of an ip-ranges.json,
+ * then time lookups in both ways, one at a time and in batches.
+ *
+ * usage: iptriebench ranges.json
+ * Half the addresses looked up are inside a range, half anywhere.
+ */
+#define _GNU_SOURCE 1
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "benchutil.h"
+#include "ipranges.h"
+#include "iptrie.h"
+#include "parallel.h"
+
+#define REPS 5
+#define NCHECK 3000         /* made-up prefixes */
+#define NCHECKADDR 20000    /* addresses looked up among them */
+#define NLINEAR 1000        /* addresses timed with the scan */
+#define NLOOKUPS (1 << 20)  /* addresses timed with the trie */
+
+/* the first len bits of an address, all 1 */
+static struct ipaddr mask(int len)
+{
+    struct ipaddr m;
+
+    m.hi = len == 0 ? 0 : len >= 64 ? ~(uint64_t)0 : ~(uint64_t)0 << (64 - len);
+    m.lo = len <= 64 ? 0 : len == 128 ? ~(uint64_t)0 : ~(uint64_t)0 << (128 - len);
+    return m;
+}
+
+/* an address of bits bits anywhere */
+static struct ipaddr anywhere(int bits, uint64_t *seed)
+{
+    struct ipaddr a;
+
+    a.hi = next_random(seed);
+    a.lo = bits == 128 ? next_random(seed) : 0;
+    if (bits == 32)
+        a.hi &= mask(32).hi;
+    return a;
+}
+
+/* an address of bits bits inside the prefix p */
+static struct ipaddr inside(const struct ipprefix *p, int bits, uint64_t *seed)
+{
+    struct ipaddr a = anywhere(bits, seed), m = mask(p->len);
+
+    a.hi = (p->addr.hi & m.hi) | (a.hi & ~m.hi);
+    a.lo = (p->addr.lo & m.lo) | (a.lo & ~m.lo);
+    return a;
+}
+
+/* what iptrie_find should give, by trying every prefix: the longest to
+ * cover a, and of those added more than once, the last */
+static unsigned linear_find(const struct iptrie *t, struct ipaddr a)
+{
+    const struct ipprefix *p;
+    struct ipaddr m;
+    unsigned value = 0;
+    size_t i;
+    int best = -1;
+
+    for (i = 0; i < t->nprefixes; i++) {
+        p = &t->prefix[i];
+        m = mask(p->len);
+        if (p->len >= best && ((a.hi ^ p->addr.hi) & m.hi) == 0 && ((a.lo ^ p->addr.lo) & m.lo) == 0) {
+            best = p->len;
+            value = p->value;
+        }
+    }
+    return value;
+}
+
+/* n addresses, half inside t's prefixes and half anywhere */
+static struct ipaddr *addresses(const struct iptrie *t, size_t n, uint64_t *seed)
+{
+    struct ipaddr *a = malloc(n * sizeof(a[0]));
+    size_t i;
+
+    for (i = 0; a != NULL && i < n; i++)
+        a[i] = i % 2 == 0 && t->nprefixes > 0
+            ? inside(&t->prefix[next_random(seed) % t->nprefixes], t->bits, seed)
+            : anywhere(t->bits, seed);
+    return a;
+}
+
+/* t's lookups of the n addresses at a, one at a time and in a batch,
+ * against linear_find's; a batch of n - 3 leaves some over */
+static int check_lookups(const struct iptrie *t, const struct ipaddr *a, size_t n)
+{
+    uint16_t *value = malloc(n * sizeof(value[0]));
+    size_t i;
+    int bad = value == NULL;
+
+    for (i = 0; i < n && !bad; i++)
+        bad = iptrie_find(t, a[i]) != linear_find(t, a[i]);
+    if (!bad) {
+        iptrie_find_batch(t, a, n - 3, value);
+        for (i = 0; i < n - 3 && !bad; i++)
+            bad = value[i] != iptrie_find(t, a[i]);
+    }
+    free(value);
+    return bad;
+}
+
+/* prefixes of every length, mostly inside or the same as one made
+ * before, with many values; each built after a few and then after all */
+static int check_made_up(int bits)
+{
+    struct iptrie t;
+    struct ipprefix p, *q;
+    struct ipaddr *a = NULL;
+    uint64_t seed = bits, r;
+    int i, bad = 0;
+
+    iptrie_init(&t, bits);
+    for (i = 0; i < NCHECK && !bad; i++) {
+        r = next_random(&seed);
+        if (i == 0 || r % 4 == 0) {
+            p.len = r / 4 % (bits + 1);
+            p.addr = anywhere(bits, &seed);
+        } else {
+            q = &t.prefix[r / 4 % t.nprefixes];
+            p.len = r % 8 == 1 ? q->len : q->len + (int)(r / 8 % 13);
+            p.len = p.len > bits ? bits : p.len;
+            p.addr = inside(q, bits, &seed);
+        }
+        bad = iptrie_add(&t, p.addr, p.len, 1 + next_random(&seed) % 0xFFFF) < 0;
+        if (i == 20 || i == NCHECK - 1) {
+            free(a);
+            bad |= iptrie_build(&t) < 0
+                || (a = addresses(&t, NCHECKADDR, &seed)) == NULL
+                || check_lookups(&t, a, NCHECKADDR);
+        }
+    }
+    /* and what is out of range is refused */
+    bad |= iptrie_add(&t, p.addr, bits + 1, 1) == 0 || iptrie_add(&t, p.addr, 8, 0) == 0;
+    free(a);
+    iptrie_free(&t);
+    return bad;
+}
+
+static int check_parse(void)
+{
+    static const struct {
+        const char *s;
+        int kind, len;
+        uint64_t hi, lo;
+    } cases[] = {
+        { "3.2.34.0/26", 4, 26, 0x03022200ULL << 32, 0 },
+        { "255.255.255.255", 4, 32, 0xFFFFFFFFULL << 32, 0 },
+        { "0.0.0.0/0", 4, 0, 0, 0 },
+        { "2600:1f14:8000::/36", 6, 36, 0x26001f1480000000ULL, 0 },
+        { "::", 6, 128, 0, 0 },
+        { "::1", 6, 128, 0, 1 },
+        { "fe80::1:2", 6, 128, 0xfe80000000000000ULL, 0x10002 },
+        { "1:2:3:4:5:6:7:8/128", 6, 128, 0x0001000200030004ULL, 0x0005000600070008ULL },
+        { "1.2.3", -1, 0, 0, 0 },
+        { "1.2.3.4.5", -1, 0, 0, 0 },
+        { "256.0.0.0", -1, 0, 0, 0 },
+        { "1.2.3.4/33", -1, 0, 0, 0 },
+        { "1.2.3.4/", -1, 0, 0, 0 },
+        { "1::2::3", -1, 0, 0, 0 },
+        { "1:2:3:4:5:6:7:8:9", -1, 0, 0, 0 },
+        { "12345::", -1, 0, 0, 0 },
+        { "::/129", -1, 0, 0, 0 },
+        { "", -1, 0, 0, 0 },
+    };
+    struct ipaddr a;
+    size_t i;
+    int len, kind;
+
+    for (i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        kind = ip_parse(cases[i].s, strlen(cases[i].s), &a, &len);
+        if (kind != cases[i].kind
+            || (kind > 0 && (len != cases[i].len || a.hi != cases[i].hi || a.lo != cases[i].lo)))
+            return 1;
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    static const char *names[2] = { "IPv4", "IPv6" };
+    struct ipranges r;
+    struct iptrie *t;
+    struct ipaddr *a;
+    uint16_t *value;
+    uint64_t seed = 42;
+    double tm, best;
+    char name[32];
+    long sum = 0;
+    size_t i;
+    int k, rep, fd;
+
+    if (argc != 2) {
+        printf("Usage: iptriebench ranges.json\n");
+        return 1;
+    }
+    if (check_parse() != 0) {
+        printf("iptriebench: ip_parse disagrees\n");
+        return 1;
+    }
+    if (check_made_up(32) != 0 || check_made_up(128) != 0) {
+        printf("iptriebench: iptrie disagrees with a scan of the prefixes\n");
+        return 1;
+    }
+    if ((fd = open(argv[1], O_RDONLY)) < 0 || ipranges_load(&r, fd, cpu_count()) < 0) {
+        perror(argv[1]);
+        return 1;
+    }
+    close(fd);
+
+#define TIME(what, n, stmt)                                                   \
+    do {                                                                      \
+        for (best = 1e9, rep = 0; rep < REPS; rep++) {                        \
+            tm = now();                                                       \
+            stmt;                                                             \
+            tm = now() - tm;                                                  \
+            best = tm < best ? tm : best;                                     \
+        }                                                                     \
+        snprintf(name, sizeof(name), "%s %s", names[k], what);                \
+        printf("%-22s %12.0f lookups/s\n", name, (n) / best);                 \
+    } while (0)
+
+    printf("%zu classes, best of %d\n", r.ncls, REPS);
+    for (k = 0; k < 2; k++) {
+        t = k == 0 ? &r.v4 : &r.v6;
+        printf("%s: %zu prefixes, %zu nodes, %zu leaves, %zu KB\n", names[k], t->nprefixes,
+               t->nnodes, t->nleaves,
+               ((1 << 16) * sizeof(t->direct[0]) + t->nnodes * sizeof(t->node[0])
+                + t->nleaves * sizeof(t->leaf[0])) / 1024);
+        a = addresses(t, NLOOKUPS, &seed);
+        value = malloc(NLOOKUPS * sizeof(value[0]));
+        if (a == NULL || value == NULL) {
+            perror("iptriebench");
+            return 1;
+        }
+        if (check_lookups(t, a, NLINEAR) != 0) {
+            printf("iptriebench: iptrie disagrees with a scan of %s\n", argv[1]);
+            return 1;
+        }
+        TIME("scan", NLINEAR, for (i = 0; i < NLINEAR; i++)
+                                  sum += linear_find(t, a[i]));
+        TIME("iptrie_find", NLOOKUPS, for (i = 0; i < NLOOKUPS; i++)
+                                          sum += iptrie_find(t, a[i]));
+        TIME("iptrie_find_batch", NLOOKUPS, iptrie_find_batch(t, a, NLOOKUPS, value);
+                                            sum += value[NLOOKUPS - 1]);
+        free(a);
+        free(value);
+    }
+    ipranges_free(&r);
+    return sum == 42;
+}
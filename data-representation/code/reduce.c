@@ -0,0 +1,201 @@
+#include <math.h>
+#include <stdlib.h>
+#include "parallel.h"
+#include "reduce.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#define NLANE 16            /* running totals per block */
+
+/* what is added up */
+enum kind {
+    SUM,                    /* x[i] */
+    DOT,                    /* x[i] * y[i] */
+    SQDEV                   /* (x[i] - mean)^2 */
+};
+
+/* one thread's share of the blocks */
+struct reducejob {
+    enum kind kind;
+    const double *x, *y;
+    double mean;
+    size_t n;               /* elements in the whole array */
+    size_t first, last;     /* blocks [first, last) */
+    double *total;          /* the total of every block */
+};
+
+/* add up the NLANE running totals pairwise */
+static double fold(double lane[])
+{
+    int w, i;
+
+    for (w = NLANE / 2; w > 0; w /= 2)
+        for (i = 0; i < w; i++)
+            lane[i] += lane[i + w];
+    return lane[0];
+}
+
+/* add elements [from, n) of a block, element i to lane i % NLANE */
+static void add_lanes(enum kind kind, const double *x, const double *y,
+                      double mean, size_t from, size_t n, double lane[])
+{
+    size_t i;
+    double d;
+
+    for (i = from; i < n; i++)
+        switch (kind) {
+        case SUM:
+            lane[i % NLANE] += x[i];
+            break;
+        case DOT:
+            lane[i % NLANE] += x[i] * y[i];
+            break;
+        case SQDEV:
+            d = x[i] - mean;
+            lane[i % NLANE] += d * d;
+            break;
+        }
+}
+
+#if defined(__x86_64__)
+/* the same for whole groups of NLANE elements, a register holding four
+ * lanes; return how many elements were done */
+__attribute__((target("avx2")))
+static size_t add_lanes_avx2(enum kind kind, const double *x, const double *y,
+                             double mean, size_t n, double lane[])
+{
+    __m256d acc[4], v, w, m = _mm256_set1_pd(mean);
+    size_t i;
+    int k;
+
+    for (k = 0; k < 4; k++)
+        acc[k] = _mm256_setzero_pd();
+    for (i = 0; i + NLANE <= n; i += NLANE)
+        for (k = 0; k < 4; k++) {
+            v = _mm256_loadu_pd(x + i + 4 * k);
+            switch (kind) {
+            case SUM:
+                break;
+            case DOT:
+                /* a separate multiply and add: a fused one rounds once,
+                 * not twice, and would not match add_lanes */
+                v = _mm256_mul_pd(v, _mm256_loadu_pd(y + i + 4 * k));
+                break;
+            case SQDEV:
+                w = _mm256_sub_pd(v, m);
+                v = _mm256_mul_pd(w, w);
+                break;
+            }
+            acc[k] = _mm256_add_pd(acc[k], v);
+        }
+    for (k = 0; k < 4; k++)
+        _mm256_storeu_pd(lane + 4 * k, acc[k]);
+    return i;
+}
+#endif
+
+/* the total of one block of n elements */
+static double block_total(enum kind kind, const double *x, const double *y,
+                          double mean, size_t n)
+{
+    double lane[NLANE] = { 0 };
+    size_t done = 0;
+
+#if defined(__x86_64__)
+    if (__builtin_cpu_supports("avx2"))
+        done = add_lanes_avx2(kind, x, y, mean, n, lane);
+#endif
+    add_lanes(kind, x, y, mean, done, n, lane);
+    return fold(lane);
+}
+
+static void *reduce_job(void *arg)
+{
+    struct reducejob *job = arg;
+    size_t b, start, len;
+
+    for (b = job->first; b < job->last; b++) {
+        start = b * REDUCE_BLOCK;
+        len = job->n - start < REDUCE_BLOCK ? job->n - start : REDUCE_BLOCK;
+        job->total[b] = block_total(job->kind, job->x + start,
+                                    job->y != NULL ? job->y + start : NULL,
+                                    job->mean, len);
+    }
+    return NULL;
+}
+
+/* add up the n totals at t in a fixed pairwise tree */
+static double tree(const double *t, size_t n)
+{
+    if (n == 1)
+        return t[0];
+    return tree(t, n / 2) + tree(t + n / 2, n - n / 2);
+}
+
+/* add up whatever kind says over the n elements into *result;
+ * return 0 on success, -1 if memory runs out */
+static int reduce(enum kind kind, const double *x, const double *y,
+                  double mean, size_t n, int nthreads, double *result)
+{
+    struct reducejob job[MAXTHREADS];
+    size_t nblock = (n + REDUCE_BLOCK - 1) / REDUCE_BLOCK, share;
+    double *total;
+    int i, njobs;
+
+    *result = 0.0;
+    if (n == 0)
+        return 0;
+    if ((total = malloc(nblock * sizeof(total[0]))) == NULL)
+        return -1;
+    njobs = job_count(nblock, 1, nthreads);
+    share = nblock / njobs;
+    for (i = 0; i < njobs; i++) {
+        job[i].kind = kind;
+        job[i].x = x;
+        job[i].y = y;
+        job[i].mean = mean;
+        job[i].n = n;
+        job[i].first = i * share;
+        job[i].last = i < njobs - 1 ? (i + 1) * share : nblock;
+        job[i].total = total;
+    }
+    run_parallel(reduce_job, job, sizeof(job[0]), njobs);
+    *result = tree(total, nblock);
+    free(total);
+    return 0;
+}
+
+/* return the sum of the n elements of x, or NAN if memory runs out */
+double reduce_sum(const double *x, size_t n, int nthreads)
+{
+    double sum;
+
+    return reduce(SUM, x, NULL, 0.0, n, nthreads, &sum) == 0 ? sum : NAN;
+}
+
+/* return the dot product of x and y, or NAN if memory runs out */
+double reduce_dot(const double *x, const double *y, size_t n, int nthreads)
+{
+    double dot;
+
+    return reduce(DOT, x, y, 0.0, n, nthreads, &dot) == 0 ? dot : NAN;
+}
+
+/* set *mean and *var to the mean and sample variance of the n elements
+ * of x, taking the mean first and then the squared distances from it,
+ * which is more accurate than summing x and x^2 in one pass.
+ * Return 0 on success, -1 if n < 2 or memory runs out.
+ */
+int reduce_meanvar(const double *x, size_t n, int nthreads,
+                   double *mean, double *var)
+{
+    if (n < 2 || reduce(SUM, x, NULL, 0.0, n, nthreads, mean) < 0)
+        return -1;
+    *mean /= n;
+    if (reduce(SQDEV, x, NULL, *mean, n, nthreads, var) < 0)
+        return -1;
+    *var /= n - 1;
+    return 0;
+}
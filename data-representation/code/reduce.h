@@ -0,0 +1,36 @@
+/* sums of arrays of doubles that come out the same to the last bit
+ * however many threads compute them.
+ *
+ * floats.c shows that (3.14f + 1e20f) - 1e20f is not 3.14f + (1e20f - 1e20f):
+ * floating-point addition is not associative, so a sum depends on the
+ * order it is added up in. Splitting a sum between threads changes that
+ * order with every thread count. Here the order is fixed by the array's
+ * length alone:
+ *
+ *   - the array is cut into blocks of REDUCE_BLOCK elements;
+ *   - within a block, element i is added to running total i % 16, and
+ *     the 16 totals are added up pairwise, always the same way;
+ *   - the block totals are added up in a fixed pairwise tree.
+ *
+ * Threads only decide who computes which block totals, never how the
+ * totals are combined. The 16 running totals are exactly what four AVX2
+ * registers hold, so the vector loop adds in the same order as the plain
+ * one and both give the same answer too. The pairwise sums are also more
+ * accurate than one long running total.
+ *
+ * These need the default, strict floating-point rules: with -ffast-math
+ * or fused multiply-adds the compiler may reorder or merge operations.
+ */
+#ifndef REDUCE_H
+#define REDUCE_H
+
+#include <stddef.h>
+
+#define REDUCE_BLOCK 4096   /* elements per block */
+
+double reduce_sum(const double *x, size_t n, int nthreads);
+double reduce_dot(const double *x, const double *y, size_t n, int nthreads);
+int reduce_meanvar(const double *x, size_t n, int nthreads,
+                   double *mean, double *var);
+
+#endif
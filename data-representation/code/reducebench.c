@@ -0,0 +1,122 @@
+/* show that a sum split naively between threads changes with the number
+ * of threads, while reduce_sum does not, and compare their speed.
+ *
+ * usage: reducebench [Melements]
+ * The data mixes huge and tiny values, as in floats.c's
+ * (3.14 + 1e20) - 1e20, so the order of the additions shows.
+ */
+#define _GNU_SOURCE 1
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "benchutil.h"
+#include "parallel.h"
+#include "reduce.h"
+
+#define REPS 5
+#define MAXSHOW 16          /* thread counts tried for the same answer */
+
+/* one thread's share of a naive sum */
+struct naivejob {
+    const double *x;
+    size_t n;
+    double sum;
+};
+
+static void *naive_job(void *arg)
+{
+    struct naivejob *job = arg;
+    size_t i;
+
+    job->sum = 0.0;
+    for (i = 0; i < job->n; i++)
+        job->sum += job->x[i];
+    return NULL;
+}
+
+/* the obvious parallel sum: each thread adds up its share in order,
+ * then the shares are added up */
+static double naive_sum(const double *x, size_t n, int nthreads)
+{
+    struct naivejob job[MAXTHREADS];
+    double sum = 0.0;
+    int i;
+
+    for (i = 0; i < nthreads; i++) {
+        job[i].x = x + i * (n / nthreads);
+        job[i].n = i < nthreads - 1 ? n / nthreads : n - i * (n / nthreads);
+    }
+    run_parallel(naive_job, job, sizeof(job[0]), nthreads);
+    for (i = 0; i < nthreads; i++)
+        sum += job[i].sum;
+    return sum;
+}
+
+int main(int argc, char *argv[])
+{
+    double *x, *y, sum, first, t, best, mean, var, m1, v1, d1;
+    uint64_t seed = 1, r;
+    size_t n, i;
+    int nthreads, maxthreads, same = 1, rep;
+
+    n = (size_t)(argc > 1 ? atol(argv[1]) : 64) * 1000000;
+    x = malloc(n * sizeof(x[0]));
+    y = malloc(n * sizeof(y[0]));
+    if (n == 0 || x == NULL || y == NULL) {
+        printf("Usage: reducebench [Melements]\n");
+        return 1;
+    }
+    for (i = 0; i < n; i++) {
+        r = next_random(&seed);
+        x[i] = (double)(r >> 11) / (1ULL << 53) - 0.5;
+        if (r % 1000 == 0)
+            x[i] *= 1e16;
+        y[i] = 1.0 - x[i] / 4;
+    }
+    maxthreads = cpu_count();
+
+    printf("%zu M elements\n", n / 1000000);
+    printf("threads  %-26s %-26s\n", "naive sum", "reduce_sum");
+    reduce_meanvar(x, n, 1, &m1, &v1);
+    d1 = reduce_dot(x, y, n, 1);
+    first = reduce_sum(x, n, 1);
+    /* more threads than CPUs still split the work differently */
+    for (nthreads = 1; nthreads <= MAXSHOW; nthreads *= 2) {
+        sum = reduce_sum(x, n, nthreads);
+        printf("%7d  %-26a %-26a\n", nthreads, naive_sum(x, n, nthreads), sum);
+        reduce_meanvar(x, n, nthreads, &mean, &var);
+        same &= memcmp(&sum, &first, sizeof(sum)) == 0
+                && memcmp(&mean, &m1, sizeof(mean)) == 0
+                && memcmp(&var, &v1, sizeof(var)) == 0;
+        sum = reduce_dot(x, y, n, nthreads);
+        same &= memcmp(&sum, &d1, sizeof(sum)) == 0;
+    }
+    if (!same) {
+        printf("reducebench: a reduction changed with the thread count\n");
+        return 1;
+    }
+
+    printf("\nbest of %d\n", REPS);
+    for (nthreads = 1; nthreads <= maxthreads; nthreads *= 2) {
+        for (best = 1e9, rep = 0; rep < REPS; rep++) {
+            t = now();
+            naive_sum(x, n, nthreads);
+            t = now() - t;
+            best = t < best ? t : best;
+        }
+        printf("naive sum  %2d thread%s %8.2f Gelem/s\n", nthreads,
+               nthreads == 1 ? " " : "s", n / best / 1e9);
+        for (best = 1e9, rep = 0; rep < REPS; rep++) {
+            t = now();
+            reduce_sum(x, n, nthreads);
+            t = now() - t;
+            best = t < best ? t : best;
+        }
+        printf("reduce_sum %2d thread%s %8.2f Gelem/s\n", nthreads,
+               nthreads == 1 ? " " : "s", n / best / 1e9);
+    }
+    free(x);
+    free(y);
+    return 0;
+}
@@ -0,0 +1,104 @@
+/* measure xorcrypt's XOR speed in GB/s, against a one-byte-at-a-time
+ * loop like xor_cipher in bits.c and against memcpy, which is about
+ * as fast as memory can be read and written.
+ *
+ * usage: xorbench [MiB] [keylen]
+ */
+#define _GNU_SOURCE 1
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "benchutil.h"
+#include "xorcipher.h"
+
+#define REPS 5
+
+/* xor_cipher from bits.c, with the length known up front */
+static void xor_bytewise(unsigned char *p, size_t n, const unsigned char *key,
+                         size_t keylen)
+{
+    size_t i;
+
+    for (i = 0; i < n; i++)
+        p[i] ^= key[i % keylen];
+}
+
+/* best of REPS runs, in GB/s over n bytes */
+static double gbps(double best, size_t n)
+{
+    return n / best / 1e9;
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned char key[256], *buf, *copy;
+    struct xorkey k;
+    size_t n, keylen, i;
+    double t, best;
+    int r, nthreads, maxthreads;
+
+    n = (argc > 1 ? atol(argv[1]) : 256) * 1024 * 1024;
+    keylen = argc > 2 ? (size_t)atol(argv[2]) : 13;
+    if (n == 0 || keylen == 0 || keylen > sizeof(key)) {
+        printf("Usage: xorbench [MiB] [keylen <= %zu]\n", sizeof(key));
+        return 1;
+    }
+    buf = malloc(n);
+    copy = malloc(n);
+    if (buf == NULL || copy == NULL) {
+        perror("xorbench");
+        return 1;
+    }
+    for (i = 0; i < n; i++)
+        buf[i] = i * 2654435761u >> 24;
+    for (i = 0; i < keylen; i++)
+        key[i] = 'k' + i;
+    if (xorkey_init(&k, key, keylen) < 0) {
+        perror("xorbench");
+        return 1;
+    }
+    memcpy(copy, buf, n);   /* also touches every page of copy */
+
+    printf("%zu MiB, %zu-byte key, best of %d\n", n >> 20, keylen, REPS);
+    for (best = 1e9, r = 0; r < REPS; r++) {
+        t = now();
+        memcpy(copy, buf, n);
+        t = now() - t;
+        best = t < best ? t : best;
+    }
+    printf("%-22s %8.2f GB/s\n", "memcpy", gbps(best, n));
+
+    for (best = 1e9, r = 0; r < REPS; r++) {
+        t = now();
+        xor_bytewise(buf, n, key, keylen);
+        t = now() - t;
+        best = t < best ? t : best;
+    }
+    printf("%-22s %8.2f GB/s\n", "byte loop", gbps(best, n));
+
+    maxthreads = sysconf(_SC_NPROCESSORS_ONLN);
+    for (nthreads = 1; nthreads <= maxthreads; nthreads *= 2) {
+        for (best = 1e9, r = 0; r < REPS; r++) {
+            t = now();
+            xor_parallel(buf, buf, n, &k, 0, nthreads);
+            t = now() - t;
+            best = t < best ? t : best;
+        }
+        printf("xor_parallel %2d thread%s %8.2f GB/s\n", nthreads,
+               nthreads == 1 ? " " : "s", gbps(best, n));
+    }
+
+    /* the fast path must produce exactly what the byte loop does */
+    memcpy(copy, buf, n);
+    xor_bytewise(copy, n, key, keylen);
+    xor_parallel(buf, buf, n, &k, 0, maxthreads);
+    if (memcmp(copy, buf, n) != 0) {
+        printf("xorbench: xor_parallel disagrees with the byte loop\n");
+        return 1;
+    }
+    xorkey_free(&k);
+    free(buf);
+    free(copy);
+    return 0;
+}
@@ -0,0 +1,165 @@
+#include <stdlib.h>
+#include "parallel.h"
+#include "xorcipher.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+/* expand key into k; return 0 on success, -1 if key is empty or
+ * memory runs out */
+int xorkey_init(struct xorkey *k, const unsigned char *key, size_t len)
+{
+    size_t i;
+
+    if (len == 0)
+        return -1;
+    k->stream = malloc(len + XOR_STEP);
+    if (k->stream == NULL)
+        return -1;
+    for (i = 0; i < len + XOR_STEP; i++)
+        k->stream[i] = key[i % len];
+    k->len = len;
+    k->advance = XOR_STEP % len;
+    return 0;
+}
+
+void xorkey_free(struct xorkey *k)
+{
+    free(k->stream);
+    k->stream = NULL;
+}
+
+/* XOR one step of XOR_STEP bytes; the fixed trip count lets
+ * the compiler turn this into vector instructions on its own */
+static void xor_step(unsigned char *dst, const unsigned char *src,
+                     const unsigned char *key)
+{
+    int i;
+
+    for (i = 0; i < XOR_STEP; i++)
+        dst[i] = src[i] ^ key[i];
+}
+
+#if defined(__x86_64__)
+/* the same step as four AVX2 registers */
+__attribute__((target("avx2")))
+static void xor_step_avx2(unsigned char *dst, const unsigned char *src,
+                          const unsigned char *key)
+{
+    int i;
+    __m256i v;
+
+    for (i = 0; i < XOR_STEP; i += 32) {
+        v = _mm256_xor_si256(_mm256_loadu_si256((const __m256i *)(src + i)),
+                             _mm256_loadu_si256((const __m256i *)(key + i)));
+        _mm256_storeu_si256((__m256i *)(dst + i), v);
+    }
+}
+
+/* the whole loop is compiled for AVX2 so xor_step_avx2 is inlined into it */
+__attribute__((target("avx2")))
+static size_t xor_steps_avx2(unsigned char *dst, const unsigned char *src,
+                             size_t n, const struct xorkey *k, size_t *phase)
+{
+    size_t done, ph = *phase;
+
+    for (done = 0; n - done >= XOR_STEP; done += XOR_STEP) {
+        xor_step_avx2(dst + done, src + done, k->stream + ph);
+        ph += k->advance;
+        if (ph >= k->len)
+            ph -= k->len;
+    }
+    *phase = ph;
+    return done;
+}
+#endif
+
+static size_t xor_steps(unsigned char *dst, const unsigned char *src,
+                        size_t n, const struct xorkey *k, size_t *phase)
+{
+    size_t done, ph = *phase;
+
+#if defined(__x86_64__)
+    if (__builtin_cpu_supports("avx2"))
+        return xor_steps_avx2(dst, src, n, k, phase);
+#endif
+    for (done = 0; n - done >= XOR_STEP; done += XOR_STEP) {
+        xor_step(dst + done, src + done, k->stream + ph);
+        ph += k->advance;
+        if (ph >= k->len)
+            ph -= k->len;
+    }
+    *phase = ph;
+    return done;
+}
+
+/* XOR the n bytes at src into dst (which may be src itself).
+ * offset is where src starts in the whole stream, so that a stream
+ * can be processed in pieces and each piece picks up the key
+ * at the right place.
+ */
+void xor_bytes(unsigned char *dst, const unsigned char *src, size_t n,
+               const struct xorkey *k, unsigned long long offset)
+{
+    size_t ph = offset % k->len;
+    size_t done = xor_steps(dst, src, n, k, &ph);
+
+    for ( ; done < n; done++) {
+        dst[done] = src[done] ^ k->stream[ph];
+        if (++ph == k->len)
+            ph = 0;
+    }
+}
+
+/* one thread's share of xor_parallel */
+struct xorjob {
+    unsigned char *dst;
+    const unsigned char *src;
+    size_t n;
+    const struct xorkey *k;
+    unsigned long long offset;
+};
+
+static void *xor_job(void *arg)
+{
+    struct xorjob *job = arg;
+
+    xor_bytes(job->dst, job->src, job->n, job->k, job->offset);
+    return NULL;
+}
+
+/* a quarter of PARALLEL_MINSHARE: XORing does so little per byte that
+ * one thread cannot keep up with memory, so a block is worth splitting
+ * across every thread there is. 256 KiB is BLOCKSIZE / MAXTHREADS, so a
+ * full 16 MiB block of xorcrypt's can use all 64; 1 MiB shares would
+ * stop at 16. A share still takes tens of microseconds, more than a
+ * thread costs to start. */
+#define MINSHARE (256 * 1024)
+
+/* xor_bytes split across up to nthreads threads (see parallel.h) */
+void xor_parallel(unsigned char *dst, const unsigned char *src, size_t n,
+                 const struct xorkey *k, unsigned long long offset,
+                 int nthreads)
+{
+    struct xorjob job[MAXTHREADS];
+    size_t share, start;
+    int i, njobs = job_count(n, MINSHARE, nthreads);
+
+    if (njobs == 1) {
+        xor_bytes(dst, src, n, k, offset);
+        return;
+    }
+    /* shares are whole steps so every thread runs full vectors;
+     * MINSHARE is far bigger than the rounding, so the last share
+     * is never empty */
+    share = (n / njobs + XOR_STEP - 1) / XOR_STEP * XOR_STEP;
+    for (i = 0, start = 0; i < njobs; i++, start += share) {
+        job[i].dst = dst + start;
+        job[i].src = src + start;
+        job[i].n = i < njobs - 1 ? share : n - start;
+        job[i].k = k;
+        job[i].offset = offset + start;
+    }
+    run_parallel(xor_job, job, sizeof(job[0]), njobs);
+}
@@ -0,0 +1,31 @@
+/* XOR a stream of bytes with a repeating multi-byte key.
+ *
+ * XORing with the same key twice gives back the original bytes,
+ * so the same routines encrypt and decrypt. Unlike xor_cipher in bits.c,
+ * the data is a byte array with a length, not a C string, so '\0' bytes
+ * are just data and binary files work.
+ */
+#ifndef XORCIPHER_H
+#define XORCIPHER_H
+
+#include <stddef.h>
+
+#define XOR_STEP 128        /* bytes XORed per step of the inner loop */
+
+/* a key, repeated so that the XOR_STEP bytes of key that line up with
+ * any position in the stream can be loaded straight out of stream[] */
+struct xorkey {
+    unsigned char *stream;  /* key[i % len] for i < len + XOR_STEP */
+    size_t len;             /* length of the key */
+    size_t advance;         /* XOR_STEP % len: how far the key moves per step */
+};
+
+int xorkey_init(struct xorkey *k, const unsigned char *key, size_t len);
+void xorkey_free(struct xorkey *k);
+void xor_bytes(unsigned char *dst, const unsigned char *src, size_t n,
+               const struct xorkey *k, unsigned long long offset);
+void xor_parallel(unsigned char *dst, const unsigned char *src, size_t n,
+                  const struct xorkey *k, unsigned long long offset,
+                  int nthreads);
+
+#endif
@@ -0,0 +1,142 @@
+/* xorcrypt: XOR a file with a repeating key, the file-sized version
+ * of xor_cipher in bits.c.
+ *
+ * usage: xorcrypt [-t threads] [-x] key [infile [outfile]]
+ *   -t  number of threads (default: one per CPU)
+ *   -x  key is given in hex, e.g. 1f2e3d, so it can hold any byte
+ * Without infile/outfile, xorcrypt reads standard input and writes
+ * standard output. Running it twice with the same key gives back the input.
+ *
+ * The input comes a block at a time from read_blocks (see blockio.h). A
+ * regular file is XORed straight from its mapping into an output buffer;
+ * anything else (a pipe, a terminal) is XORed in place, in the buffer
+ * read_blocks reads it into, and written from there.
+ */
+#define _GNU_SOURCE 1
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "blockio.h"
+#include "parallel.h"
+#include "xorcipher.h"
+
+#define MAXKEY 4096         /* longest key, in bytes */
+
+/* what xor_block needs from one block to the next */
+struct crypt {
+    const struct xorkey *k;
+    unsigned char *buf;     /* the XORed block, or NULL to XOR in place */
+    unsigned long long pos; /* offset of the block in the input */
+    int out;
+    int nthreads;
+};
+
+static int parse_hex(const char *s, unsigned char *key, size_t max);
+static int xor_block(const unsigned char *block, size_t n, void *arg);
+
+int main(int argc, char *argv[])
+{
+    unsigned char key[MAXKEY];
+    struct xorkey k;
+    struct crypt run;
+    struct stat st;
+    unsigned char *buf = NULL;
+    int c, hex = 0, nthreads, keylen, in = 0, out = 1, file, rc;
+
+    nthreads = cpu_count();
+    while ((c = getopt(argc, argv, "t:x")) != -1)
+        switch (c) {
+        case 't':
+            nthreads = atoi(optarg);
+            break;
+        case 'x':
+            hex = 1;
+            break;
+        default:
+            nthreads = 0;
+            break;
+        }
+    argc -= optind;
+    argv += optind;
+    if (nthreads < 1 || argc < 1 || argc > 3) {
+        fprintf(stderr, "Usage: xorcrypt [-t threads] [-x] key [infile [outfile]]\n");
+        return 1;
+    }
+
+    if (hex)
+        keylen = parse_hex(argv[0], key, MAXKEY);
+    else if ((keylen = strlen(argv[0])) <= MAXKEY)
+        memcpy(key, argv[0], keylen);
+    else
+        keylen = -1;
+    if (keylen <= 0) {
+        fprintf(stderr, "xorcrypt: key must be 1 to %d bytes%s\n",
+                MAXKEY, hex ? " of hex digit pairs" : "");
+        return 1;
+    }
+
+    if (argc > 1 && (in = open(argv[1], O_RDONLY)) < 0) {
+        perror(argv[1]);
+        return 1;
+    }
+    if (argc > 2 && (out = open(argv[2], O_WRONLY | O_CREAT | O_TRUNC, 0666)) < 0) {
+        perror(argv[2]);
+        return 1;
+    }
+    /* a file's blocks come from a mapping, which cannot be written
+     * over, so only a file needs a buffer to XOR into */
+    file = fstat(in, &st) == 0 && S_ISREG(st.st_mode);
+    if ((file && (buf = malloc(BLOCKSIZE)) == NULL) || xorkey_init(&k, key, keylen) < 0) {
+        perror("xorcrypt");
+        return 1;
+    }
+
+    run.k = &k;
+    run.buf = buf;
+    run.pos = 0;
+    run.out = out;
+    run.nthreads = nthreads;
+    if ((rc = read_blocks(in, BLOCKSIZE, xor_block, &run)) < 0)
+        perror("xorcrypt");
+
+    xorkey_free(&k);
+    free(buf);
+    if (out != 1 && close(out) < 0) {
+        perror(argv[2]);
+        return 1;
+    }
+    return rc < 0;
+}
+
+/* read hex digit pairs from s into key; return the number of bytes,
+ * or -1 if s is not an even number of hex digits or is too long */
+static int parse_hex(const char *s, unsigned char *key, size_t max)
+{
+    size_t n, len = strlen(s);
+    unsigned int byte;
+
+    if (len % 2 != 0 || len / 2 > max)
+        return -1;
+    for (n = 0; n < len / 2; n++) {
+        if (strspn(s + 2 * n, "0123456789abcdefABCDEF") < 2
+            || sscanf(s + 2 * n, "%2x", &byte) != 1)
+            return -1;
+        key[n] = byte;
+    }
+    return n;
+}
+
+/* XOR one block of the input into out; return 0 on success, -1 on a
+ * write error (errno says why) */
+static int xor_block(const unsigned char *block, size_t n, void *arg)
+{
+    struct crypt *c = arg;
+    unsigned char *dst = c->buf != NULL ? c->buf : (unsigned char *)block;
+
+    xor_parallel(dst, block, n, c->k, c->pos, c->nthreads);
+    c->pos += n;
+    return write_all(c->out, dst, n);
+}
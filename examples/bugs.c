@@ -1,4 +1,5 @@
 #include <stdio.h>
+#include "bounds.h"
 
 int foo(int index) 
 {
@@ -6,7 +7,9 @@ int foo(int index)
      * that has to do with the volatile variable. */
     volatile int iList[2] = {0x12345678};
     volatile char cList[2];
-    cList[index] = 0xAA;
+    /* index runs up to 99: built with make BOUNDS=1, the write to
+     * cList[2] is reported and stopped instead of landing in iList */
+    BOUNDS_AT(cList, index) = 0xAA;
     return iList[0];
 }
 
@@ -0,0 +1,34 @@
+/* what every benchmark needs: a clock and a source of random data.
+ *
+ * The random numbers come from a xorshift64 generator, which is fast
+ * and gives the same sequence for the same seed on every machine, so
+ * the data a benchmark checks and times is the same from run to run.
+ * Its state must start nonzero.
+ */
+#ifndef BENCHUTIL_H
+#define BENCHUTIL_H
+
+#include <stdint.h>
+#include <time.h>
+
+/* seconds since some fixed point, from a clock that never goes back */
+static inline double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* the next pseudo-random number after *state (xorshift64) */
+static inline uint64_t next_random(uint64_t *state)
+{
+    uint64_t x = *state;
+
+    x ^= x << 13;
+    x ^= x >> 7;
+    x ^= x << 17;
+    return *state = x;
+}
+
+#endif
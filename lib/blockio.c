@@ -0,0 +1,198 @@
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "blockio.h"
+
+static unsigned char *map_rest(int fd, size_t *skip, size_t *size);
+static int map_blocks(int fd, unsigned char *map, size_t skip, size_t size,
+                      size_t blocksize, block_fn fn, void *arg);
+static int buffer_blocks(int fd, size_t blocksize, block_fn fn, void *arg);
+
+/* call fn(block, n, arg) on each successive block of the input on fd,
+ * from wherever fd is, every block but the last being blocksize bytes
+ * long. fd is left just past the last block handed to fn.
+ * Return 0 at the end of the input, -1 on a read error (errno says why),
+ * or the first non-zero value fn returns, which stops the reading.
+ */
+int read_blocks(int fd, size_t blocksize, block_fn fn, void *arg)
+{
+    unsigned char *map;
+    size_t skip, size;
+
+    if ((map = map_rest(fd, &skip, &size)) != NULL)
+        return map_blocks(fd, map, skip, size, blocksize, fn, arg);
+    /* not a file, or one mmap refuses: fall back to read */
+    return buffer_blocks(fd, blocksize, fn, arg);
+}
+
+/* map what is left of the regular file on fd, from the start of the
+ * page its offset is in, since mmap only maps whole pages; set *skip to
+ * the bytes of that page before the offset and *size to the length of
+ * the mapping. Return NULL if fd is not a file with something left in
+ * it, or if mmap refuses. */
+static unsigned char *map_rest(int fd, size_t *skip, size_t *size)
+{
+    struct stat st;
+    unsigned char *map;
+    off_t off, base;
+
+    if (fstat(fd, &st) < 0 || !S_ISREG(st.st_mode)
+        || (off = lseek(fd, 0, SEEK_CUR)) < 0 || st.st_size <= off)
+        return NULL;
+    base = off - off % sysconf(_SC_PAGESIZE);
+    map = mmap(NULL, st.st_size - base, PROT_READ, MAP_PRIVATE, fd, base);
+    if (map == MAP_FAILED)
+        return NULL;
+    *skip = off - base;
+    *size = st.st_size - base;
+    return map;
+}
+
+/* the mmap half of read_blocks, on the mapping from map_rest;
+ * unmaps map when done */
+static int map_blocks(int fd, unsigned char *map, size_t skip, size_t size,
+                      size_t blocksize, block_fn fn, void *arg)
+{
+    size_t pos, n;
+    int rc = 0;
+
+    /* ask the kernel to read ahead aggressively */
+    madvise(map, size, MADV_SEQUENTIAL);
+    for (pos = skip; pos < size && rc == 0; pos += n) {
+        n = size - pos < blocksize ? size - pos : blocksize;
+        rc = fn(map + pos, n, arg);
+    }
+    /* a mapping does not move the offset the way read does */
+    lseek(fd, pos - skip, SEEK_CUR);
+    munmap(map, size);
+    return rc;
+}
+
+/* the read half of read_blocks */
+static int buffer_blocks(int fd, size_t blocksize, block_fn fn, void *arg)
+{
+    unsigned char *buf = malloc(blocksize);
+    ssize_t n = 0;
+    int rc = 0;
+
+    if (buf == NULL)
+        return -1;
+    while (rc == 0 && (n = read_full(fd, buf, blocksize)) > 0)
+        rc = fn(buf, n, arg);
+    free(buf);
+    return rc == 0 && n < 0 ? -1 : rc;
+}
+
+/* make the whole input on fd, from wherever fd is, available at in->p,
+ * and leave fd at its end; return 0 on success, -1 on error (errno
+ * says why). Unlike read_blocks, this has to hold all of a pipe's input
+ * in memory at once.
+ */
+int map_input(int fd, struct input *in)
+{
+    unsigned char *p, *bigger;
+    size_t size, n, skip;
+    ssize_t r;
+
+    in->p = NULL;
+    in->n = 0;
+    in->mapped = 0;
+    in->skip = 0;
+    if ((p = map_rest(fd, &skip, &size)) != NULL) {
+        madvise(p, size, MADV_WILLNEED);
+        lseek(fd, size - skip, SEEK_CUR);
+        in->p = p + skip;
+        in->n = size - skip;
+        in->mapped = 1;
+        in->skip = skip;
+        return 0;
+    }
+    /* double the buffer each time it fills, so reading n bytes
+     * copies each byte only a few times on average */
+    size = BLOCKSIZE;
+    if ((p = malloc(size)) == NULL)
+        return -1;
+    for (n = 0; (r = read_full(fd, p + n, size - n)) > 0; n += r)
+        if (n + r == size) {
+            if ((bigger = realloc(p, 2 * size)) == NULL) {
+                free(p);
+                return -1;
+            }
+            p = bigger;
+            size *= 2;
+        }
+    if (r < 0) {
+        free(p);
+        return -1;
+    }
+    in->p = p;
+    in->n = n;
+    return 0;
+}
+
+/* release what map_input set up */
+void unmap_input(struct input *in)
+{
+    if (in->mapped)
+        munmap((void *)(in->p - in->skip), in->n + in->skip);
+    else
+        free((void *)in->p);
+    in->p = NULL;
+    in->n = 0;
+}
+
+/* return the start of the first line of the n bytes at p that begins
+ * at or after pos: where a tool that splits a mapped input between
+ * threads cuts it, so that no line is split */
+size_t next_line(const unsigned char *p, size_t n, size_t pos)
+{
+    const unsigned char *nl;
+
+    if (pos == 0 || pos >= n)
+        return pos < n ? pos : n;
+    nl = memchr(p + pos - 1, '\n', n - pos + 1);
+    return nl != NULL ? (size_t)(nl - p) + 1 : n;
+}
+
+/* read until n bytes have arrived or the input ends; a pipe hands
+ * over a little at a time, and full blocks keep all threads busy.
+ * Return the number of bytes read, or -1 on error.
+ */
+ssize_t read_full(int fd, unsigned char *p, size_t n)
+{
+    size_t got = 0;
+    ssize_t r;
+
+    while (got < n) {
+        r = read(fd, p + got, n - got);
+        if (r < 0 && errno == EINTR)
+            continue;
+        if (r < 0)
+            return -1;
+        if (r == 0)
+            break;
+        got += r;
+    }
+    return got;
+}
+
+/* write all n bytes at p to fd; return 0 on success, -1 on error */
+int write_all(int fd, const void *p, size_t n)
+{
+    const char *s = p;
+    ssize_t w;
+
+    while (n > 0) {
+        w = write(fd, s, n);
+        if (w < 0 && errno == EINTR)
+            continue;
+        if (w < 0)
+            return -1;
+        s += w;
+        n -= w;
+    }
+    return 0;
+}
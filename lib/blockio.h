@@ -0,0 +1,38 @@
+/* read a whole input a block at a time, as fast as the system allows.
+ *
+ * A regular file is mapped into memory with mmap and handed out in
+ * blocks straight from the mapping, with no copying at all; anything
+ * else (a pipe, a terminal) is read into one reusable buffer.
+ * Either way the caller only ever sees (pointer, length) blocks. A
+ * block that was read is in read_blocks' own buffer, which the caller
+ * may write over before it returns; a mapped one must not be written.
+ *
+ * Tools that need to see the whole input at once use map_input instead,
+ * which maps a file or, failing that, reads everything into memory.
+ */
+#ifndef BLOCKIO_H
+#define BLOCKIO_H
+
+#include <stddef.h>
+#include <sys/types.h>
+
+#define BLOCKSIZE (16 * 1024 * 1024)
+
+typedef int (*block_fn)(const unsigned char *block, size_t n, void *arg);
+
+/* a whole input in memory */
+struct input {
+    const unsigned char *p;
+    size_t n;
+    int mapped;             /* 1 if p is in an mmap, 0 if it was malloc'd */
+    size_t skip;            /* bytes mapped before p, to reach a page start */
+};
+
+int read_blocks(int fd, size_t blocksize, block_fn fn, void *arg);
+int map_input(int fd, struct input *in);
+void unmap_input(struct input *in);
+size_t next_line(const unsigned char *p, size_t n, size_t pos);
+ssize_t read_full(int fd, unsigned char *p, size_t n);
+int write_all(int fd, const void *p, size_t n);
+
+#endif
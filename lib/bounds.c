@@ -0,0 +1,17 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "bounds.h"
+
+/* say where an access would have gone out of bounds, and stop there */
+void bounds_fail(const char *file, int line, const char *func, const char *what,
+                 int index, size_t n, size_t len)
+{
+    fflush(stdout);
+    if (index)
+        fprintf(stderr, "%s:%d: %s: index %zu is out of bounds of %s, which has %zu\n",
+                file, line, func, n, what, len);
+    else
+        fprintf(stderr, "%s:%d: %s: %zu elements do not fit in %s, which has %zu\n",
+                file, line, func, n, what, len);
+    abort();
+}
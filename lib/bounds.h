@@ -0,0 +1,88 @@
+/* a bounds-checked build, with one check per loop instead of per access.
+ *
+ * bugs.c writes cList[index] for index up to 99 into a 2-element array,
+ * and the getline copies write s[i++] for as long as their lim says,
+ * however big s really is. A function given a bare char s[] cannot
+ * tell; one given a span can. A span is the array and its real length,
+ * made where the array is still an array, and it is what getline and
+ * copy fill:
+ *
+ *     csc250_getline(BOUNDS_SPAN(line), MAXLINE)
+ *         inside, BOUNDS_RANGE(s, 0, lim) checks once, before the loop,
+ *         that the lim bytes it may write fit in s; the loop itself
+ *         writes s.p[i] unchecked
+ *     BOUNDS_AT(cList, index) = 0xAA
+ *         one element, checked on its own
+ *
+ * Built with -DBOUNDS (make BOUNDS=1), a span also remembers the file,
+ * line and function it was made in, and a check that fails reports
+ * that call site and what did not fit, then aborts, so the overrun
+ * never happens. Otherwise a span is just the two words, and the checks
+ * and anything only they compute (such as a strlen for copy) are not
+ * there at all.
+ *
+ * ARRAY_LEN and BOUNDS_SPAN refuse to compile when given a pointer
+ * instead of an array, in either build: the size of a pointer is not
+ * something to check against.
+ */
+#ifndef BOUNDS_H
+#define BOUNDS_H
+
+#include <stddef.h>
+
+/* 0, but a compile error if a is a pointer, as in Linux's __must_be_array */
+#define BOUNDS_MUST_BE_ARRAY(a)                                               \
+    (0 * sizeof(struct {                                                      \
+        int not_an_array : 1 - 2 * __builtin_types_compatible_p(__typeof__(a), \
+                                                                __typeof__(&(a)[0])); \
+    }))
+#define ARRAY_LEN(a) (sizeof(a) / sizeof((a)[0]) + BOUNDS_MUST_BE_ARRAY(a))
+
+void bounds_fail(const char *file, int line, const char *func, const char *what,
+                 int index, size_t n, size_t len) __attribute__((noreturn, cold));
+
+/* a char array to be filled, and how many elements it really has */
+struct charspan {
+    char *p;
+    size_t len;
+#if defined(BOUNDS)
+    const char *what;       /* where the span was made, for the report */
+    const char *file;
+    const char *func;
+    int line;
+#endif
+};
+
+#if defined(BOUNDS)
+
+/* i if it indexes one of len elements, else a report */
+static inline size_t bounds_index(size_t i, size_t len, const char *what,
+                                  const char *file, int line, const char *func)
+{
+    if (__builtin_expect(i >= len, 0))
+        bounds_fail(file, line, func, what, 1, i, len);
+    return i;
+}
+
+/* nothing if [start, start + n) lies within s, else a report */
+static inline void bounds_range(struct charspan s, size_t start, size_t n)
+{
+    if (__builtin_expect(n > s.len || start > s.len - n, 0))
+        bounds_fail(s.file, s.line, s.func, s.what, 0, start + n, s.len);
+}
+
+#define BOUNDS_SPAN(a)                                                        \
+    ((struct charspan){ (a), ARRAY_LEN(a), #a, __FILE__, __func__, __LINE__ })
+#define BOUNDS_AT(a, i)                                                       \
+    ((a)[bounds_index((i), ARRAY_LEN(a), #a, __FILE__, __LINE__, __func__)])
+#define BOUNDS_RANGE(s, start, n) bounds_range((s), (start), (n))
+
+#else
+
+#define BOUNDS_SPAN(a) ((struct charspan){ (a), ARRAY_LEN(a) })
+#define BOUNDS_AT(a, i) ((a)[i])
+#define BOUNDS_RANGE(s, start, n) ((void)0)
+
+#endif
+
+#endif
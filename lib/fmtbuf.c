@@ -0,0 +1,236 @@
+#include <math.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "fmtbuf.h"
+#include "intio.h"
+
+#define MINCAP 256
+#define MAXFIXED 17         /* fb_fixed's own precisions; 10^17 is exact */
+
+static const double powers[MAXFIXED + 1] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9,
+    1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16, 1e17
+};
+
+void fb_init(struct fmtbuf *b)
+{
+    b->p = NULL;
+    b->len = b->cap = 0;
+    b->err = 0;
+}
+
+void fb_free(struct fmtbuf *b)
+{
+    free(b->p);
+    fb_init(b);
+}
+
+/* empty b, keeping its memory for what is written next */
+void fb_reset(struct fmtbuf *b)
+{
+    b->len = 0;
+    b->err = 0;
+}
+
+/* make room for n more bytes, doubling the buffer until they fit;
+ * return where they go, or NULL with b->err set */
+static char *room(struct fmtbuf *b, size_t n)
+{
+    size_t cap;
+    char *p;
+
+    if (b->err)
+        return NULL;
+    if (b->cap - b->len < n) {
+        for (cap = b->cap > 0 ? b->cap : MINCAP; cap - b->len < n; cap *= 2)
+            if (cap > SIZE_MAX / 2) {
+                b->err = 1;
+                return NULL;
+            }
+        if ((p = realloc(b->p, cap)) == NULL) {
+            b->err = 1;
+            return NULL;
+        }
+        b->p = p;
+        b->cap = cap;
+    }
+    return b->p + b->len;
+}
+
+/* what has been written, as a C string */
+const char *fb_cstr(struct fmtbuf *b)
+{
+    char *p = room(b, 1);
+
+    if (p == NULL)
+        return "";
+    *p = '\0';
+    return b->p;
+}
+
+void fb_char(struct fmtbuf *b, char c)
+{
+    char *p = room(b, 1);
+
+    if (p != NULL) {
+        *p = c;
+        b->len++;
+    }
+}
+
+void fb_mem(struct fmtbuf *b, const char *s, size_t n)
+{
+    char *p = room(b, n);
+
+    if (p != NULL) {
+        memcpy(p, s, n);
+        b->len += n;
+    }
+}
+
+/* write the n bytes at s with spaces in front up to width, or after
+ * them up to -width if width is negative */
+static void padded(struct fmtbuf *b, const char *s, size_t n, int width)
+{
+    size_t w = width < 0 ? -(long long)width : width, pad = w > n ? w - n : 0;
+    char *p = room(b, n + pad);
+
+    if (p == NULL)
+        return;
+    if (width >= 0) {
+        memset(p, ' ', pad);
+        memcpy(p + pad, s, n);
+    } else {
+        memcpy(p, s, n);
+        memset(p + n, ' ', pad);
+    }
+    b->len += n + pad;
+}
+
+/* printf's %*.*s: at most prec characters of s, or all if prec < 0 */
+void fb_str(struct fmtbuf *b, const char *s, int width, int prec)
+{
+    padded(b, s, prec < 0 ? strlen(s) : strnlen(s, prec), width);
+}
+
+/* a '-' if neg, the n digits at s with zeros in front up to prec, and
+ * padding up to width, as printf's %*.*d puts them */
+static void number(struct fmtbuf *b, int neg, const char *s, size_t n,
+                   int width, int prec)
+{
+    size_t zeros, len, w, pad;
+    char *p;
+
+    if (prec == 0 && n == 1 && s[0] == '0')
+        n = 0;              /* %.0d prints nothing for 0 */
+    zeros = prec > 0 && (size_t)prec > n ? prec - n : 0;
+    len = neg + zeros + n;
+    w = width < 0 ? -(long long)width : width;
+    pad = w > len ? w - len : 0;
+    if ((p = room(b, len + pad)) == NULL)
+        return;
+    if (width >= 0) {
+        memset(p, ' ', pad);
+        p += pad;
+    }
+    *p = '-';
+    p += neg;
+    memset(p, '0', zeros);
+    memcpy(p + zeros, s, n);
+    if (width < 0)
+        memset(p + zeros + n, ' ', pad);
+    b->len += len + pad;
+}
+
+/* printf's %*.*lld; prec < 0 for none */
+void fb_int(struct fmtbuf *b, int64_t v, int width, int prec)
+{
+    char digits[INTIO_MAXLEN];
+
+    number(b, v < 0, digits, fmt_u64(digits, v < 0 ? 0 - (uint64_t)v : (uint64_t)v),
+           width, prec);
+}
+
+/* printf's %*.*llu */
+void fb_uint(struct fmtbuf *b, uint64_t v, int width, int prec)
+{
+    char digits[INTIO_MAXLEN];
+
+    number(b, 0, digits, fmt_u64(digits, v), width, prec);
+}
+
+/* printf's %*.*f, prec < 0 meaning the default of 6.
+ * d * 10^prec is rounded to a whole number and written with a '.' put
+ * in. printf rounds the exact value of d, to even on a tie; the product
+ * is rounded too, but fma gives its rounding error exactly, which
+ * settles the cases where that rounding matters. Numbers too big for
+ * that to work, infinities and NaNs go to snprintf.
+ */
+void fb_fixed(struct fmtbuf *b, double d, int width, int prec)
+{
+    char digits[INTIO_MAXLEN], buf[INTIO_MAXLEN + 3 + MAXFIXED], *p;
+    double a = fabs(d), scaled, err, q, frac;
+    size_t n, intlen;
+
+    if (prec < 0)
+        prec = 6;
+    if (prec > MAXFIXED || !isfinite(d) || a * powers[prec] >= 0x1p52) {
+        fb_printf(b, "%*.*f", width, prec, d);
+        return;
+    }
+    scaled = a * powers[prec];
+    err = fma(a, powers[prec], -scaled);
+    q = floor(scaled);
+    frac = scaled - q;      /* exact, as scaled < 2^52 */
+    if (frac > 0.5 || (frac == 0.5 && (err > 0 || (err == 0 && fmod(q, 2) != 0))))
+        q += 1;
+    n = fmt_u64(digits, (uint64_t)q);
+
+    /* at least one digit before the point */
+    p = buf;
+    if (signbit(d))
+        *p++ = '-';
+    intlen = n > (size_t)prec ? n - prec : 0;
+    if (intlen == 0)
+        *p++ = '0';
+    memcpy(p, digits, intlen);
+    p += intlen;
+    if (prec > 0) {
+        *p++ = '.';
+        memset(p, '0', prec - (n - intlen));
+        p += prec - (n - intlen);
+        memcpy(p, digits + intlen, n - intlen);
+        p += n - intlen;
+    }
+    padded(b, buf, p - buf, width);
+}
+
+/* printf into b, for what the writers above do not cover; return the
+ * number of characters written, or -1 on error */
+int fb_printf(struct fmtbuf *b, const char *fmt, ...)
+{
+    va_list ap;
+    char *p;
+    int n;
+
+    if ((p = room(b, 1)) == NULL)
+        return -1;
+    va_start(ap, fmt);
+    n = vsnprintf(p, b->cap - b->len, fmt, ap);
+    va_end(ap);
+    if (n < 0) {
+        b->err = 1;
+        return -1;
+    }
+    if ((size_t)n >= b->cap - b->len) {
+        if ((p = room(b, (size_t)n + 1)) == NULL)
+            return -1;
+        va_start(ap, fmt);
+        vsnprintf(p, (size_t)n + 1, fmt, ap);
+        va_end(ap);
+    }
+    b->len += n;
+    return n;
+}
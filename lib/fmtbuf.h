@@ -0,0 +1,54 @@
+/* formatted output into a buffer that grows, without printf's format
+ * string at run time.
+ *
+ * printf("%4d %-10.3f %.*s\n", ...) reads its format string on every
+ * call to find out what to do, and sprintf writes into whatever room the
+ * caller promised there was. A fmtbuf instead grows to fit what is
+ * written, and each conversion has its own writer, so the format is
+ * taken apart once, when the code is written, not on every call:
+ *
+ *     printf("%4d %-10.3f %.*s\n", x, d, m, s)
+ *
+ * becomes
+ *
+ *     fb_int(b, x, 4, -1);      fb_char(b, ' ');
+ *     fb_fixed(b, d, -10, 3);   fb_char(b, ' ');
+ *     fb_str(b, s, 0, m);       fb_char(b, '\n');
+ *
+ * Width and precision mean what they do in printf, including a negative
+ * width for left-justified ('-') and a negative precision for none, and
+ * the output is exactly printf's. fb_printf is there for everything
+ * else; it is printf-checked at compile time like printf itself.
+ *
+ * If memory runs out, err is set and later writes are dropped, as a
+ * stream's error flag works, so a run of writes needs one check at the
+ * end.
+ */
+#ifndef FMTBUF_H
+#define FMTBUF_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+struct fmtbuf {
+    char *p;                /* what has been written, not '\0'-ended */
+    size_t len;
+    size_t cap;
+    int err;                /* 1 once memory has run out */
+};
+
+void fb_init(struct fmtbuf *b);
+void fb_free(struct fmtbuf *b);
+void fb_reset(struct fmtbuf *b);
+const char *fb_cstr(struct fmtbuf *b);
+
+void fb_char(struct fmtbuf *b, char c);
+void fb_mem(struct fmtbuf *b, const char *p, size_t n);
+void fb_str(struct fmtbuf *b, const char *s, int width, int prec);
+void fb_int(struct fmtbuf *b, int64_t v, int width, int prec);
+void fb_uint(struct fmtbuf *b, uint64_t v, int width, int prec);
+void fb_fixed(struct fmtbuf *b, double d, int width, int prec);
+int fb_printf(struct fmtbuf *b, const char *fmt, ...)
+    __attribute__((format(printf, 2, 3)));
+
+#endif
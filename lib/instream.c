@@ -0,0 +1,195 @@
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "instream.h"
+#include "stats.h"
+
+STATS_TIMER(ins_read);      /* time spent waiting in read, once a read */
+
+/* read from fd, from wherever it is, mapping it if it is a regular
+ * file; return 0 on success, -1 on error (errno says why). fd is not
+ * closed by ins_close.
+ */
+int ins_open(struct instream *s, int fd)
+{
+    struct stat st;
+    off_t off;
+    char *p;
+
+    ins_open_mem(s, NULL, 0);
+    s->seekfd = fd;
+    /* the whole file is mapped, which costs nothing for the pages before
+     * the offset that are never touched, and makes pos - map the
+     * offset in the file */
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode)
+        && (off = lseek(fd, 0, SEEK_CUR)) >= 0 && st.st_size > off) {
+        p = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p != MAP_FAILED) {
+            madvise(p + off, st.st_size - off, MADV_SEQUENTIAL);
+            s->map = p;
+            s->mapped = st.st_size;
+            s->start = s->pos = p + off;
+            s->end = p + st.st_size;
+            return 0;
+        }
+    }
+    /* not a file, or one mmap refuses: fall back to read */
+    if ((s->buf = malloc(INS_BUFSIZE)) == NULL)
+        return -1;
+    s->cap = INS_BUFSIZE;
+    s->start = s->pos = s->end = s->buf;
+    s->fd = fd;
+    return 0;
+}
+
+/* read the n bytes at p, which must outlive the stream */
+void ins_open_mem(struct instream *s, const char *p, size_t n)
+{
+    s->start = s->pos = p;
+    s->end = p + n;
+    s->buf = NULL;
+    s->cap = 0;
+    s->map = NULL;
+    s->mapped = 0;
+    s->fd = -1;
+    s->seekfd = -1;
+    s->err = 0;
+}
+
+/* leave the descriptor just past what was read, where it can be
+ * (a pipe cannot go back), and let go of the buffer or mapping */
+void ins_close(struct instream *s)
+{
+    if (s->map != NULL) {
+        lseek(s->seekfd, s->pos - s->map, SEEK_SET);
+        munmap((void *)s->map, s->mapped);
+    } else if (s->seekfd >= 0 && s->pos < s->end)
+        lseek(s->seekfd, -(off_t)(s->end - s->pos), SEEK_CUR);
+    free(s->buf);
+    ins_open_mem(s, NULL, 0);
+}
+
+static struct instream in;
+
+static void close_stdin(void)
+{
+    ins_close(&in);
+}
+
+/* the standard input, opened the first time it is asked for
+ * and closed at exit */
+struct instream *ins_stdin(void)
+{
+    static int opened = 0;
+
+    if (!opened) {
+        if (ins_open(&in, 0) < 0)
+            in.err = 1;
+        atexit(close_stdin);
+        opened = 1;
+    }
+    return &in;
+}
+
+/* make the buffer hold keep bytes before the position and room for n
+ * after it, moving what is kept to the front; return -1 if it cannot */
+static int make_room(struct instream *s, size_t keep, size_t n)
+{
+    size_t have = s->end - s->pos, cap;
+    char *p;
+
+    memmove(s->buf, s->pos - keep, keep + have);
+    if (s->cap < keep + n) {
+        for (cap = s->cap; cap < keep + n; cap *= 2)
+            if (cap > SIZE_MAX / 2)
+                return -1;
+        if ((p = realloc(s->buf, cap)) == NULL)
+            return -1;
+        s->buf = p;
+        s->cap = cap;
+    }
+    s->start = s->buf;
+    s->pos = s->buf + keep;
+    s->end = s->pos + have;
+    return 0;
+}
+
+/* buffer at least n bytes from the position, unless the input ends
+ * first; return how many there are */
+size_t ins_fill(struct instream *s, size_t n)
+{
+    size_t keep;
+    ssize_t r;
+
+    while ((size_t)(s->end - s->pos) < n && s->fd >= 0) {
+        if ((size_t)(s->buf + s->cap - s->pos) < n) {
+            keep = s->pos - s->start < INS_KEEP ? (size_t)(s->pos - s->start) : INS_KEEP;
+            if (make_room(s, keep, n) < 0) {
+                s->err = 1;
+                break;
+            }
+        }
+        {
+            STATS_SCOPE(ins_read);
+            r = read(s->fd, (char *)s->end, s->buf + s->cap - s->end);
+        }
+        if (r > 0)
+            s->end += r;
+        else if (r == 0)
+            s->fd = -1;
+        else if (errno != EINTR) {
+            s->err = 1;
+            s->fd = -1;
+        }
+    }
+    return s->end - s->pos;
+}
+
+/* the next n bytes, or as many as are left, without reading them */
+struct strview ins_peek(struct instream *s, size_t n)
+{
+    size_t have = ins_fill(s, n);
+
+    return sv_make(s->pos, have < n ? have : n);
+}
+
+/* the next n bytes, or as many as are left */
+struct strview ins_take(struct instream *s, size_t n)
+{
+    struct strview v = ins_peek(s, n);
+
+    s->pos += v.len;
+    return v;
+}
+
+/* the next line with its '\n', or without one at the end of the input;
+ * an empty view once there is nothing left */
+struct strview ins_getline(struct instream *s)
+{
+    size_t have, done = 0;
+    const char *nl;
+
+    for (;;) {
+        have = s->end - s->pos;
+        if (have > done && (nl = memchr(s->pos + done, '\n', have - done)) != NULL)
+            return ins_take(s, nl - s->pos + 1);
+        /* only the part not yet searched is searched again */
+        if (ins_fill(s, have + 1) == have)
+            return ins_take(s, have);
+        done = have;
+    }
+}
+
+/* go back over the last n bytes read; return 0, or -1 if they are no
+ * longer buffered, which cannot happen for n up to INS_KEEP */
+int ins_unread(struct instream *s, size_t n)
+{
+    if (n > (size_t)(s->pos - s->start))
+        return -1;
+    s->pos -= n;
+    return 0;
+}
@@ -0,0 +1,67 @@
+/* an input stream: one buffer that can be looked ahead into and backed
+ * up in, over a file descriptor, a mapped file or memory.
+ *
+ * getchar and getch.c's ungetch keep two buffers, stdio's and a small
+ * push-back array beside it, and getline copies each line out of
+ * stdio's buffer into one of its own. Here there is one buffer and a
+ * position in it. ins_getc moves the position on a byte, ins_unread
+ * moves it back, and ins_peek and ins_take hand out the bytes in place
+ * as a strview, so reading a line or a token copies nothing.
+ *
+ * A regular file is mapped, so the buffer is the rest of the file from
+ * where its descriptor was and never needs filling. Anything else (a pipe, a terminal) is read into a
+ * buffer of INS_BUFSIZE, whose last INS_KEEP bytes before the position
+ * are kept when it is refilled; that is how far ins_unread is always
+ * able to go back. The buffer only grows when a peek or a line needs
+ * more than it holds, so in steady state reading allocates nothing.
+ *
+ * A view from ins_peek, ins_take or ins_getline points into the buffer
+ * and is good until the stream is next read from.
+ *
+ * Like stdio, ins_close leaves a file's descriptor just past what was
+ * read, not past what was mapped or buffered, so whatever reads it next
+ * (another program, in a shell script) starts at the right byte; the
+ * stream from ins_stdin is closed that way at exit.
+ */
+#ifndef INSTREAM_H
+#define INSTREAM_H
+
+#include <stddef.h>
+#include "strview.h"
+
+#define INS_BUFSIZE (64 * 1024)
+#define INS_KEEP 64
+
+struct instream {
+    const char *pos;        /* next byte to read */
+    const char *end;        /* end of what is buffered */
+    const char *start;      /* start of what is buffered */
+    char *buf;              /* what was read from fd, NULL otherwise */
+    size_t cap;
+    const char *map;        /* the mapped file, from its first byte */
+    size_t mapped;          /* length of the mapping, 0 if none */
+    int fd;                 /* -1 once at the end, or for memory */
+    int seekfd;             /* file to leave at pos on close, or -1 */
+    int err;                /* 1 once a read or allocation has failed */
+};
+
+int ins_open(struct instream *s, int fd);
+void ins_open_mem(struct instream *s, const char *p, size_t n);
+void ins_close(struct instream *s);
+struct instream *ins_stdin(void);
+
+size_t ins_fill(struct instream *s, size_t n);
+struct strview ins_peek(struct instream *s, size_t n);
+struct strview ins_take(struct instream *s, size_t n);
+struct strview ins_getline(struct instream *s);
+int ins_unread(struct instream *s, size_t n);
+
+/* the next byte as an unsigned char, or EOF (-1) at the end */
+static inline int ins_getc(struct instream *s)
+{
+    if (s->pos == s->end && ins_fill(s, 1) == 0)
+        return -1;
+    return (unsigned char)*s->pos++;
+}
+
+#endif
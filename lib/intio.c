@@ -0,0 +1,183 @@
+#include <string.h>
+#include "intio.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#define ONES  0x0101010101010101ULL
+
+/* "00", "01", ... "99", for writing two digits at once */
+static const char pairs[201] =
+    "0001020304050607080910111213141516171819"
+    "2021222324252627282930313233343536373839"
+    "4041424344454647484950515253545556575859"
+    "6061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+static const uint64_t powers[20] = {
+    1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL,
+    10000000ULL, 100000000ULL, 1000000000ULL, 10000000000ULL,
+    100000000000ULL, 1000000000000ULL, 10000000000000ULL,
+    100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL,
+    100000000000000000ULL, 1000000000000000000ULL, 10000000000000000000ULL
+};
+
+static int digit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+/* the value of 8 digit characters loaded as one word, the first in the
+ * low byte: neighbours are combined into pairs (10 * d0 + d1), pairs
+ * into fours and fours into the eight, one multiply a step */
+static uint64_t swar8(uint64_t w)
+{
+    w &= 0x0F * ONES;
+    w = (w * 10 + (w >> 8)) & 0x00FF00FF00FF00FFULL;
+    w = (w * 100 + (w >> 16)) & 0x0000FFFF0000FFFFULL;
+    return (w * 10000 + (w >> 32)) & 0xFFFFFFFF;
+}
+
+/* how many of the 8 characters in w, from the low byte up, are digits
+ * before the first that is not. A byte is a digit if its high half is 3
+ * and stays 3 when 6 is added; the add can carry into the next byte
+ * only from a byte that is not a digit, so the bytes before the first
+ * non-digit are always judged right.
+ */
+static int digits_in(uint64_t w)
+{
+    uint64_t bad = ((w & 0xF0 * ONES) ^ 0x30 * ONES)
+                   | (((w + 0x06 * ONES) & 0xF0 * ONES) ^ 0x30 * ONES);
+
+    return bad != 0 ? __builtin_ctzll(bad) / 8 : 8;
+}
+
+#if defined(__x86_64__)
+/* 16 x 0x80 then 0 ... 15: loaded from shift + n, a pshufb mask that
+ * moves the first n bytes to the top of the register, zeros below */
+static const unsigned char shift[32] = {
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80,
+    0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15
+};
+
+/* set *v to the number in the digits at the start of the 16 bytes at p
+ * and return how many digits there are, up to 16 */
+__attribute__((target("sse4.1")))
+static int digits16(const char *p, uint64_t *v)
+{
+    __m128i d, nine = _mm_set1_epi8(9);
+    unsigned bad;
+    int n;
+
+    d = _mm_sub_epi8(_mm_loadu_si128((const __m128i *)p), _mm_set1_epi8('0'));
+    /* as unsigned bytes, a digit minus '0' is at most 9 */
+    bad = ~_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(d, nine), nine)) & 0xFFFF;
+    n = bad != 0 ? __builtin_ctz(bad) : 16;
+    if (n == 0)
+        return 0;
+    /* line the n digits up at the top, as if padded with leading zeros */
+    d = _mm_shuffle_epi8(d, _mm_loadu_si128((const __m128i *)(shift + n)));
+    d = _mm_maddubs_epi16(d, _mm_setr_epi8(10, 1, 10, 1, 10, 1, 10, 1,
+                                           10, 1, 10, 1, 10, 1, 10, 1));
+    d = _mm_madd_epi16(d, _mm_setr_epi16(100, 1, 100, 1, 100, 1, 100, 1));
+    d = _mm_packus_epi32(d, d);
+    d = _mm_madd_epi16(d, _mm_setr_epi16(10000, 1, 10000, 1, 10000, 1, 10000, 1));
+    *v = (uint64_t)_mm_cvtsi128_si32(d) * 100000000 + (uint32_t)_mm_extract_epi32(d, 1);
+    return n;
+}
+#endif
+
+/* read the digits at the start of [p, end) into *v; return where they
+ * end, or NULL if there are none or the number does not fit */
+const char *parse_u64(const char *p, const char *end, uint64_t *v)
+{
+    const char *start = p;
+    uint64_t x = 0, w;
+    int n;
+
+#if defined(__x86_64__)
+    if (end - p >= 16 && __builtin_cpu_supports("sse4.1")) {
+        n = digits16(p, &x);
+        p += n;
+        if (n < 16)
+            goto done;
+    }
+#endif
+    while (end - p >= 8) {
+        memcpy(&w, p, 8);
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+        w = __builtin_bswap64(w);
+#endif
+        if ((n = digits_in(w)) == 0)
+            goto done;
+        /* shifting the n digits to the top pads them with zeros */
+        w = swar8(w << (8 * (8 - n)));
+        if (__builtin_mul_overflow(x, powers[n], &x)
+            || __builtin_add_overflow(x, w, &x))
+            return NULL;
+        p += n;
+        if (n < 8)
+            goto done;
+    }
+    for ( ; p < end && digit(*p); p++)
+        if (__builtin_mul_overflow(x, 10, &x)
+            || __builtin_add_overflow(x, (uint64_t)(*p - '0'), &x))
+            return NULL;
+done:
+    if (p == start)
+        return NULL;
+    *v = x;
+    return p;
+}
+
+/* the same with an optional sign in front */
+const char *parse_i64(const char *p, const char *end, int64_t *v)
+{
+    uint64_t mag;
+    int neg = 0;
+
+    if (p < end && (*p == '-' || *p == '+'))
+        neg = *p++ == '-';
+    if ((p = parse_u64(p, end, &mag)) == NULL
+        || mag > (uint64_t)INT64_MAX + neg)
+        return NULL;
+    *v = neg ? (int64_t)(0 - mag) : (int64_t)mag;
+    return p;
+}
+
+/* how many digits v has: about log10(2) = 1233 / 4096 digits a bit,
+ * then one compare to see which side of the power of ten it falls */
+static int ndigits(uint64_t v)
+{
+    int t = (64 - __builtin_clzll(v | 1)) * 1233 >> 12;
+
+    return t + ((v | 1) >= powers[t]);
+}
+
+/* write v in decimal at buf, which must have room for INTIO_MAXLEN
+ * characters, with no '\0'; return how many were written */
+size_t fmt_u64(char *buf, uint64_t v)
+{
+    int n = ndigits(v), i = n;
+
+    while (v >= 100) {
+        i -= 2;
+        memcpy(buf + i, pairs + v % 100 * 2, 2);
+        v /= 100;
+    }
+    if (v >= 10)
+        memcpy(buf, pairs + v * 2, 2);
+    else
+        buf[0] = '0' + v;
+    return n;
+}
+
+size_t fmt_i64(char *buf, int64_t v)
+{
+    if (v >= 0)
+        return fmt_u64(buf, v);
+    buf[0] = '-';
+    return fmt_u64(buf + 1, 0 - (uint64_t)v) + 1;
+}
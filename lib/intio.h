@@ -0,0 +1,29 @@
+/* reading and writing decimal integers without scanf and printf.
+ *
+ * scanf("%d") and printf("%d") interpret their format string on every
+ * call, go through locale and stream machinery, and take one digit at a
+ * time. Here a number is parsed straight from memory, 16 digits per
+ * SSE4.1 step (8 per 64-bit word without it): the digits are lined up
+ * in one register, then combined into pairs, the pairs into fours, and
+ * the fours into eights with three multiply-adds. Overflow is detected,
+ * not wrapped. Writing a number takes two digits at a time from a
+ * 200-byte table, so it divides by 100 rather than by 10, into a buffer
+ * the caller owns.
+ *
+ * The parse functions take the characters as [p, end) and return where
+ * the number ends, so nothing needs a '\0' after it.
+ */
+#ifndef INTIO_H
+#define INTIO_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define INTIO_MAXLEN 20     /* the longest int64_t or uint64_t written */
+
+const char *parse_u64(const char *p, const char *end, uint64_t *v);
+const char *parse_i64(const char *p, const char *end, int64_t *v);
+size_t fmt_u64(char *buf, uint64_t v);
+size_t fmt_i64(char *buf, int64_t v);
+
+#endif
@@ -0,0 +1,489 @@
+#include <errno.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include "jsonidx.h"
+#include "parallel.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#define EVEN_BITS 0x5555555555555555ULL
+
+/* what one 64-byte block hands on to the next */
+struct scan {
+    uint64_t escaped;       /* 1 if the next byte is escaped */
+    uint64_t instring;      /* all ones if the next byte is inside a string */
+    uint64_t scalar;        /* 1 if the last byte was part of a number etc. */
+};
+
+/* a 64-byte block as one bit per byte for each kind of character */
+struct masks {
+    uint64_t quote;
+    uint64_t backslash;
+    uint64_t punct;         /* { } [ ] : , */
+    uint64_t space;         /* white space, or any control character */
+};
+
+/* one thread's share of the text */
+struct indexjob {
+    const unsigned char *p;
+    size_t start, end;
+    uint32_t *out;          /* NULL to only follow the strings */
+    struct scan s;
+    size_t count;
+};
+
+static int ispunct_json(unsigned char c)
+{
+    return c == '{' || c == '}' || c == '[' || c == ']' || c == ':' || c == ',';
+}
+
+/* can c be part of a number, true, false or null? Anything that is not
+ * punctuation, white space or a quote is let in here, so that a stray
+ * character still gets an entry where it starts */
+static int isplain(unsigned char c)
+{
+    return !ispunct_json(c) && c > ' ' && c != '"';
+}
+
+/* the bytes a backslash escapes: the one after each run of an odd
+ * number of backslashes. Adding the runs that start on an odd bit to
+ * the runs carries each of those to the byte past its end, which tells
+ * the two kinds of run apart; this is the method of Langdale and Lemire,
+ * "Parsing gigabytes of JSON per second" (2019) */
+static inline uint64_t find_escaped(struct scan *s, uint64_t backslash)
+{
+    uint64_t follows, odd_starts, sum;
+
+    backslash &= ~s->escaped;   /* an escaped backslash escapes nothing */
+    follows = backslash << 1 | s->escaped;
+    odd_starts = backslash & ~EVEN_BITS & ~follows;
+    s->escaped = __builtin_add_overflow(odd_starts, backslash, &sum);
+    return (EVEN_BITS ^ sum << 1) & follows;
+}
+
+/* bit k of the result is the XOR of bits 0 to k of x */
+static inline uint64_t prefix_xor(uint64_t x)
+{
+    x ^= x << 1;
+    x ^= x << 2;
+    x ^= x << 4;
+    x ^= x << 8;
+    x ^= x << 16;
+    x ^= x << 32;
+    return x;
+}
+
+/* the entries of a block, given which bytes are inside strings (counting
+ * the opening quotes but not the closing ones) */
+static inline uint64_t entries(struct scan *s, const struct masks *m,
+                               uint64_t quote, uint64_t instring)
+{
+    uint64_t plain = ~(m->punct | m->space | m->quote | instring);
+    uint64_t starts = plain & ~(plain << 1 | s->scalar);
+
+    s->scalar = plain >> 63;
+    return (m->punct & ~instring) | (quote & instring) | starts;
+}
+
+/* write the offsets of the set bits of bits, plus base, at out; eight
+ * at a time whether there are that many or not, which saves a branch
+ * for each. The extra ones are overwritten later, and since no block has
+ * more entries than bytes, they never pass the end of the block */
+static inline uint32_t *flatten(uint32_t *out, uint32_t base, uint64_t bits)
+{
+    int n = __builtin_popcountll(bits), i, j;
+
+    for (i = 0; i < n; i += 8)
+        for (j = 0; j < 8; j++) {
+            /* the top bit only keeps the count defined once bits is 0 */
+            out[i + j] = base + __builtin_ctzll(bits | 1ULL << 63);
+            bits &= bits - 1;
+        }
+    return out + n;
+}
+
+/* classify the 64 bytes at p a byte at a time */
+static void classify(const unsigned char *p, struct masks *m)
+{
+    uint64_t bit;
+    int i;
+
+    memset(m, 0, sizeof(*m));
+    for (i = 0; i < 64; i++) {
+        bit = 1ULL << i;
+        if (p[i] == '"')
+            m->quote |= bit;
+        else if (p[i] == '\\')
+            m->backslash |= bit;
+        else if (ispunct_json(p[i]))
+            m->punct |= bit;
+        else if (p[i] <= ' ')
+            m->space |= bit;
+    }
+}
+
+/* index the n bytes at p (a multiple of 64), which start at offset base
+ * of the text, into out; return the new end of out */
+static uint32_t *index_portable(const unsigned char *p, size_t n, uint32_t base,
+                                uint32_t *out, struct scan *s)
+{
+    struct masks m;
+    uint64_t quote, instring;
+    size_t i;
+
+    for (i = 0; i < n; i += 64) {
+        classify(p + i, &m);
+        quote = m.quote & ~find_escaped(s, m.backslash);
+        instring = prefix_xor(quote) ^ s->instring;
+        s->instring = (uint64_t)((int64_t)instring >> 63);
+        if (out != NULL)
+            out = flatten(out, base + i, entries(s, &m, quote, instring));
+    }
+    return out;
+}
+
+#if defined(__x86_64__)
+__attribute__((target("avx2")))
+static inline void classify_avx2(const unsigned char *p, struct masks *m)
+{
+    __m256i v, lower, punct, space;
+    int h;
+
+    memset(m, 0, sizeof(*m));
+    for (h = 0; h < 64; h += 32) {
+        v = _mm256_loadu_si256((const __m256i *)(p + h));
+        /* setting the 0x20 bit makes '[' and ']' into '{' and '}' */
+        lower = _mm256_or_si256(v, _mm256_set1_epi8(0x20));
+        punct = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(lower, _mm256_set1_epi8('{')),
+                            _mm256_cmpeq_epi8(lower, _mm256_set1_epi8('}'))),
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(':')),
+                            _mm256_cmpeq_epi8(v, _mm256_set1_epi8(','))));
+        /* the bytes up to ' ' are those that min(v, ' ') leaves alone */
+        space = _mm256_cmpeq_epi8(_mm256_min_epu8(v, _mm256_set1_epi8(' ')), v);
+        m->quote |= (uint64_t)(uint32_t)_mm256_movemask_epi8(
+            _mm256_cmpeq_epi8(v, _mm256_set1_epi8('"'))) << h;
+        m->backslash |= (uint64_t)(uint32_t)_mm256_movemask_epi8(
+            _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\'))) << h;
+        m->punct |= (uint64_t)(uint32_t)_mm256_movemask_epi8(punct) << h;
+        m->space |= (uint64_t)(uint32_t)_mm256_movemask_epi8(space) << h;
+    }
+}
+
+/* index_portable with AVX2 compares, and the prefix XOR as one carry-less
+ * multiply by all ones */
+__attribute__((target("avx2,pclmul,popcnt")))
+static uint32_t *index_avx2(const unsigned char *p, size_t n, uint32_t base,
+                            uint32_t *out, struct scan *s)
+{
+    struct masks m;
+    uint64_t quote, instring;
+    size_t i;
+
+    for (i = 0; i < n; i += 64) {
+        classify_avx2(p + i, &m);
+        quote = m.quote & ~find_escaped(s, m.backslash);
+        instring = _mm_cvtsi128_si64(_mm_clmulepi64_si128(
+            _mm_set_epi64x(0, quote), _mm_set1_epi8(-1), 0)) ^ s->instring;
+        s->instring = (uint64_t)((int64_t)instring >> 63);
+        if (out != NULL)
+            out = flatten(out, base + i, entries(s, &m, quote, instring));
+    }
+    return out;
+}
+#endif
+
+/* index the bytes from start to end of p into out, or only follow the
+ * strings if out is NULL; return the number of entries */
+static size_t index_range(const unsigned char *p, size_t start, size_t end,
+                          uint32_t *out, struct scan *s)
+{
+    unsigned char last[64];
+    uint32_t *o = out;
+    size_t whole = (end - start) & ~(size_t)63;
+
+#if defined(__x86_64__)
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("pclmul"))
+        o = index_avx2(p + start, whole, start, o, s);
+    else
+#endif
+        o = index_portable(p + start, whole, start, o, s);
+    if (start + whole < end) {
+        /* the last bytes, padded out to a block with spaces */
+        memset(last, ' ', sizeof(last));
+        memcpy(last, p + start + whole, end - start - whole);
+        o = index_portable(last, sizeof(last), start + whole, o, s);
+    }
+    return o - out;
+}
+
+static void *index_job(void *arg)
+{
+    struct indexjob *job = arg;
+
+    job->count = index_range(job->p, job->start, job->end, job->out, &job->s);
+    return NULL;
+}
+
+/* is the byte at i escaped? It is if an odd number of backslashes
+ * come just before it */
+static int escaped_at(const unsigned char *p, size_t i)
+{
+    size_t j;
+
+    for (j = i; j > 0 && p[j - 1] == '\\'; j--)
+        ;
+    return (i - j) & 1;
+}
+
+/* set up ix for the n bytes at p, with room for an entry per byte
+ * plus a block; return 0, or -1 if there is no room or p is too long */
+static int alloc_index(struct jsonidx *ix, const char *p, size_t n)
+{
+    ix->p = p;
+    ix->n = n;
+    ix->count = 0;
+    ix->pos = NULL;
+    if (n >= UINT32_MAX - 64) {
+        errno = EFBIG;
+        return -1;
+    }
+    /* pages that are never written to are never really allocated */
+    if ((ix->pos = malloc((n + 64) * sizeof(uint32_t))) == NULL)
+        return -1;
+    return 0;
+}
+
+/* finish an index of count entries, instring telling whether the text
+ * ends inside a string; return 0, or -1 if it does */
+static int finish_index(struct jsonidx *ix, size_t count, int instring)
+{
+    uint32_t *pos;
+
+    if (instring) {
+        json_free(ix);
+        errno = EINVAL;
+        return -1;
+    }
+    ix->pos[count] = ix->n;
+    ix->count = count;
+    if ((pos = realloc(ix->pos, (count + 1) * sizeof(uint32_t))) != NULL)
+        ix->pos = pos;
+    return 0;
+}
+
+/* index the n bytes at p with up to nthreads threads; return 0, or -1
+ * with errno EINVAL if a string is not closed, EFBIG if p is 4 GB or
+ * more, or ENOMEM */
+int json_index(struct jsonidx *ix, const char *p, size_t n, int nthreads)
+{
+    struct indexjob job[MAXTHREADS];
+    const unsigned char *u = (const unsigned char *)p;
+    uint64_t instring, odd;
+    size_t share, count;
+    int i, njobs;
+
+    if (alloc_index(ix, p, n) < 0)
+        return -1;
+    njobs = job_count(n, PARALLEL_MINSHARE, nthreads);
+    /* shares are whole blocks, so a block never straddles two */
+    share = n / njobs & ~(size_t)63;
+    for (i = 0; i < njobs; i++) {
+        job[i].p = u;
+        job[i].start = i * share;
+        job[i].end = i < njobs - 1 ? (i + 1) * share : n;
+        job[i].out = NULL;
+        memset(&job[i].s, 0, sizeof(job[i].s));
+        job[i].s.escaped = escaped_at(u, job[i].start);
+    }
+    /* a share starts inside a string if the shares before it hold an odd
+     * number of quotes, so count them first (the state ends up all ones
+     * if a share's own count is odd) */
+    if (njobs > 1)
+        run_parallel(index_job, job, sizeof(job[0]), njobs);
+    for (i = 0, instring = 0; i < njobs; i++) {
+        odd = job[i].s.instring;
+        job[i].s.instring = instring;
+        job[i].s.escaped = escaped_at(u, job[i].start);
+        job[i].s.scalar = i > 0 && !instring && isplain(u[job[i].start - 1]);
+        instring ^= odd;
+        /* a share writes its entries where its own bytes are, which the
+         * shares before it cannot reach: none has more entries than bytes */
+        job[i].out = ix->pos + job[i].start;
+    }
+    run_parallel(index_job, job, sizeof(job[0]), njobs);
+    for (i = 0, count = 0; i < njobs; i++) {
+        memmove(ix->pos + count, job[i].out, job[i].count * sizeof(uint32_t));
+        count += job[i].count;
+    }
+    return finish_index(ix, count, job[njobs - 1].s.instring != 0);
+}
+
+/* json_index a byte at a time, without threads; the reference the
+ * block version must agree with */
+int json_index_bytes(struct jsonidx *ix, const char *p, size_t n)
+{
+    const unsigned char *u = (const unsigned char *)p;
+    int instring = 0, escaped = 0, scalar = 0, quote;
+    size_t i, count = 0;
+
+    if (alloc_index(ix, p, n) < 0)
+        return -1;
+    for (i = 0; i < n; i++) {
+        quote = u[i] == '"' && !escaped;
+        escaped = u[i] == '\\' && !escaped;
+        if (quote && !instring)
+            ix->pos[count++] = i;
+        instring ^= quote;
+        if (!instring && isplain(u[i]) && !scalar)
+            ix->pos[count++] = i;
+        else if (!instring && ispunct_json(u[i]))
+            ix->pos[count++] = i;
+        scalar = !instring && isplain(u[i]);
+    }
+    return finish_index(ix, count, instring);
+}
+
+void json_free(struct jsonidx *ix)
+{
+    free(ix->pos);
+    ix->pos = NULL;
+    ix->count = 0;
+}
+
+/* the character the value at entry k starts with: '{', '[', '"', or the
+ * first of a number, true, false or null; 0 past the last entry */
+int json_type(const struct jsonidx *ix, size_t k)
+{
+    return k < ix->count ? (unsigned char)ix->p[ix->pos[k]] : 0;
+}
+
+/* the entry after the value at entry k, or JSON_NONE if there is no
+ * value there, or it is an object or array that is never closed */
+size_t json_skip(const struct jsonidx *ix, size_t k)
+{
+    size_t depth = 0;
+    int c = json_type(ix, k);
+
+    if (c == 0 || c == '}' || c == ']' || c == ':' || c == ',')
+        return JSON_NONE;
+    if (c != '{' && c != '[')
+        return k + 1;
+    for ( ; k < ix->count; k++) {
+        c = ix->p[ix->pos[k]];
+        if (c == '{' || c == '[')
+            depth++;
+        else if ((c == '}' || c == ']') && --depth == 0)
+            return k + 1;
+    }
+    return JSON_NONE;
+}
+
+/* the text of the value at entry k: a string without its quotes (and
+ * with its escapes as written), or an object or array from its first
+ * bracket to its last; empty if there is no value there */
+struct strview json_value(const struct jsonidx *ix, size_t k)
+{
+    const char *s, *e;
+    size_t next = json_skip(ix, k);
+    int c = json_type(ix, k);
+
+    if (next == JSON_NONE)
+        return sv_make(ix->p, 0);
+    s = ix->p + ix->pos[k];
+    if (c == '{' || c == '[')
+        return sv_make(s, ix->p + ix->pos[next - 1] + 1 - s);
+    /* the value ends where the next entry starts, less white space */
+    for (e = ix->p + ix->pos[next]; e > s + 1 && (unsigned char)e[-1] <= ' '; e--)
+        ;
+    if (c == '"')
+        return sv_make(s + 1, e - s - 2);
+    return sv_make(s, e - s);
+}
+
+/* the value of the member called name of the object at entry k, or
+ * JSON_NONE if it has none (or k is not an object) */
+size_t json_member(const struct jsonidx *ix, size_t k, struct strview name)
+{
+    if (json_type(ix, k) != '{')
+        return JSON_NONE;
+    for (k++; json_type(ix, k) == '"' && json_type(ix, k + 1) == ':'; k++) {
+        if (sv_eq(json_value(ix, k), name))
+            return k + 2;
+        if ((k = json_skip(ix, k + 2)) == JSON_NONE || json_type(ix, k) != ',')
+            break;
+    }
+    return JSON_NONE;
+}
+
+/* follow path from the value at entry k, calling fn for each value it
+ * leads to, and setting *stop to what fn returns; return the entry after
+ * the value, or JSON_NONE if the text is broken on the way */
+static size_t walk(const struct jsonidx *ix, size_t k, const char *path,
+                   json_fn fn, void *arg, int *stop)
+{
+    size_t len;
+    int c;
+
+    while (*path == '.')
+        path++;
+    c = json_type(ix, k);
+    if (*path == '\0') {
+        *stop = fn(ix, k, arg);
+        return json_skip(ix, k);
+    }
+    if (path[0] == '[' && path[1] == ']') {
+        if (c != '[')
+            return json_skip(ix, k);
+        if (json_type(ix, ++k) == ']')
+            return k + 1;
+        for (;;) {
+            if ((k = walk(ix, k, path + 2, fn, arg, stop)) == JSON_NONE || *stop)
+                return k;
+            if ((c = json_type(ix, k)) != ',')
+                return c == ']' ? k + 1 : JSON_NONE;
+            k++;
+        }
+    }
+    /* a member name runs up to the next '.' or "[]" */
+    for (len = 0; path[len] != '\0' && path[len] != '.'; len++)
+        if (path[len] == '[' && path[len + 1] == ']')
+            break;
+    if (c != '{')
+        return json_skip(ix, k);
+    if (json_type(ix, ++k) == '}')
+        return k + 1;
+    for (;;) {
+        if (json_type(ix, k) != '"' || json_type(ix, k + 1) != ':')
+            return JSON_NONE;
+        if (sv_eq(json_value(ix, k), sv_make(path, len)))
+            k = walk(ix, k + 2, path + len, fn, arg, stop);
+        else
+            k = json_skip(ix, k + 2);
+        if (k == JSON_NONE || *stop)
+            return k;
+        if ((c = json_type(ix, k)) != ',')
+            return c == '}' ? k + 1 : JSON_NONE;
+        k++;
+    }
+}
+
+/* call fn for each value path leads to from the top of the text (see
+ * jsonidx.h); return 0, what fn returned if it stopped the walk, or -1
+ * with errno EINVAL if the text is broken somewhere on the way */
+int json_each(const struct jsonidx *ix, const char *path, json_fn fn, void *arg)
+{
+    int stop = 0;
+    size_t k = ix->count > 0 ? walk(ix, 0, path, fn, arg, &stop) : JSON_NONE;
+
+    if (stop != 0)
+        return stop;
+    if (k == JSON_NONE) {
+        errno = EINVAL;
+        return -1;
+    }
+    return 0;
+}
@@ -0,0 +1,61 @@
+/* find your way around a JSON text without parsing all of it.
+ *
+ * json_index makes one pass over the text and writes down where every
+ * value and punctuation mark starts: each { } [ ] : and , that is not
+ * inside a string, the opening quote of each string, and the first
+ * character of each number, true, false or null. That list (the
+ * structural index) is all the later steps look at; they reach the text
+ * itself only to read the few values they were asked for. A string ends
+ * just before the next entry, less any white space, which is why its
+ * closing quote need not be in the list.
+ *
+ * The pass looks at 64 bytes at a time. AVX2 compares turn them into a
+ * bit mask for each kind of character: quote, backslash, punctuation,
+ * white space. A quote that follows an odd run of backslashes is
+ * escaped and does not count. Which bytes are inside a string is then
+ * the prefix XOR of the quote mask (bit k is the XOR of bits 0 to k),
+ * one carry-less multiply by all ones, and everything else is AND and
+ * shift. Long inputs are cut into shares for several threads: a first
+ * pass counts each share's quotes, which tells every share whether it
+ * starts inside a string.
+ *
+ * json_each walks the index along a path of member names and "[]"s,
+ * such as "prefixes[].service" (every element of the array prefixes,
+ * and the member service of each), and calls a function with each
+ * value it reaches. It skips what the path does not lead into without
+ * looking at its text, and checks only what it reads: it is not a
+ * validator. Names are compared as written, escapes and all.
+ *
+ * Offsets are 32 bits, so a text must be shorter than 4 GB.
+ */
+#ifndef JSONIDX_H
+#define JSONIDX_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "strview.h"
+
+#define JSON_NONE ((size_t)-1)  /* no such value, or the text is broken */
+
+struct jsonidx {
+    const char *p;          /* the text */
+    size_t n;
+    uint32_t *pos;          /* where each entry starts, then n */
+    size_t count;           /* entries, not counting the n at the end */
+};
+
+/* called by json_each with the entry a value starts at; a return
+ * other than 0 stops the walk, and json_each returns it */
+typedef int (*json_fn)(const struct jsonidx *ix, size_t k, void *arg);
+
+int json_index(struct jsonidx *ix, const char *p, size_t n, int nthreads);
+int json_index_bytes(struct jsonidx *ix, const char *p, size_t n);
+void json_free(struct jsonidx *ix);
+
+int json_type(const struct jsonidx *ix, size_t k);
+size_t json_skip(const struct jsonidx *ix, size_t k);
+struct strview json_value(const struct jsonidx *ix, size_t k);
+size_t json_member(const struct jsonidx *ix, size_t k, struct strview name);
+int json_each(const struct jsonidx *ix, const char *path, json_fn fn, void *arg);
+
+#endif
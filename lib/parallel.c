@@ -0,0 +1,77 @@
+#include <pthread.h>
+#include <unistd.h>
+#include "parallel.h"
+#include "stats.h"
+
+/* return the number of CPUs online, at least 1 and at most MAXTHREADS */
+int cpu_count(void)
+{
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+
+    if (n < 1)
+        return 1;
+    return n < MAXTHREADS ? n : MAXTHREADS;
+}
+
+/* how many jobs to split n units of work into: one per thread, but
+ * none with less than minshare units (PARALLEL_MINSHARE for bytes);
+ * always at least 1 and at most MAXTHREADS */
+int job_count(size_t n, size_t minshare, int nthreads)
+{
+    int njobs = n / minshare < (size_t)nthreads ? (int)(n / minshare) : nthreads;
+
+    if (njobs < 1)
+        return 1;
+    return njobs < MAXTHREADS ? njobs : MAXTHREADS;
+}
+
+#if defined(STATS)
+/* what a thread is started with when the stats are compiled in: it runs
+ * its job, then adds its counts into the totals before it goes */
+struct start {
+    void *(*fn)(void *);
+    void *job;
+};
+
+static void *run_and_flush(void *arg)
+{
+    struct start *s = arg;
+    void *r = s->fn(s->job);
+
+    stats_flush();
+    return r;
+}
+#endif
+
+/* call fn on each of the njobs jobs of jobsize bytes at jobs, in parallel,
+ * and return when all are done. The calling thread runs the last job,
+ * and any job whose thread cannot be started.
+ */
+void run_parallel(void *(*fn)(void *), void *jobs, size_t jobsize, int njobs)
+{
+    pthread_t tid[MAXTHREADS];
+    char *job = jobs;
+    int i, started;
+#if defined(STATS)
+    struct start start[MAXTHREADS];
+#endif
+
+    if (njobs > MAXTHREADS)
+        njobs = MAXTHREADS;
+#if defined(STATS)
+    for (started = 0; started < njobs - 1; started++) {
+        start[started].fn = fn;
+        start[started].job = job + started * jobsize;
+        if (pthread_create(&tid[started], NULL, run_and_flush, &start[started]) != 0)
+            break;
+    }
+#else
+    for (started = 0; started < njobs - 1; started++)
+        if (pthread_create(&tid[started], NULL, fn, job + started * jobsize) != 0)
+            break;
+#endif
+    for (i = started; i < njobs; i++)
+        fn(job + i * jobsize);
+    for (i = 0; i < started; i++)
+        pthread_join(tid[i], NULL);
+}
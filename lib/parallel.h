@@ -0,0 +1,25 @@
+/* run the same function on several jobs at once, one thread per job.
+ *
+ * The jobs are an array of structs, one per thread, each holding
+ * everything its thread needs and room for its results; fn gets a
+ * pointer to its own job. Because no two threads share a job,
+ * they need no locks: the caller merges the results once all
+ * threads are done.
+ */
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <stddef.h>
+
+#define MAXTHREADS 64
+
+/* the fewest bytes of input worth another thread: starting one and
+ * merging what it found takes some tens of microseconds, which a
+ * megabyte's worth of work keeps to a small part of the whole */
+#define PARALLEL_MINSHARE (1024 * 1024)
+
+int cpu_count(void);
+int job_count(size_t n, size_t minshare, int nthreads);
+void run_parallel(void *(*fn)(void *), void *jobs, size_t jobsize, int njobs);
+
+#endif
@@ -0,0 +1,119 @@
+#include <string.h>
+#include <unistd.h>
+#include "perfctr.h"
+
+const char *const perfctr_names[PC_COUNT] = {
+    "cycles", "instructions", "cache_misses", "branch_misses"
+};
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+
+static const unsigned long long events[PC_COUNT] = {
+    PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CACHE_MISSES, PERF_COUNT_HW_BRANCH_MISSES
+};
+
+/* open the counters for process pid (0 for this one) and the threads
+ * and children it starts afterwards. They start stopped: perfctr_start
+ * starts them, or if on_exec is set, pid's next exec does. Return how
+ * many could be opened.
+ */
+int perfctr_open(struct perfctr *pc, pid_t pid, int on_exec)
+{
+    struct perf_event_attr attr;
+    int i, n = 0;
+
+    for (i = 0; i < PC_COUNT; i++) {
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = events[i];
+        attr.disabled = 1;
+        attr.enable_on_exec = on_exec != 0;
+        attr.inherit = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        /* more counters than the PMU has are taken in turns, so say how
+         * long each was running to scale its count up by */
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        pc->fd[i] = syscall(SYS_perf_event_open, &attr, pid, -1, -1, 0);
+        n += pc->fd[i] >= 0;
+    }
+    return n;
+}
+
+static void control(struct perfctr *pc, unsigned long request)
+{
+    int i;
+
+    for (i = 0; i < PC_COUNT; i++)
+        if (pc->fd[i] >= 0)
+            ioctl(pc->fd[i], request, 0);
+}
+
+void perfctr_start(struct perfctr *pc)
+{
+    control(pc, PERF_EVENT_IOC_ENABLE);
+}
+
+void perfctr_stop(struct perfctr *pc)
+{
+    control(pc, PERF_EVENT_IOC_DISABLE);
+}
+#else
+/* no perf_event_open: every counter is missing */
+int perfctr_open(struct perfctr *pc, pid_t pid, int on_exec)
+{
+    int i;
+
+    (void)pid;
+    (void)on_exec;
+    for (i = 0; i < PC_COUNT; i++)
+        pc->fd[i] = -1;
+    return 0;
+}
+
+void perfctr_start(struct perfctr *pc)
+{
+    (void)pc;
+}
+
+void perfctr_stop(struct perfctr *pc)
+{
+    (void)pc;
+}
+#endif
+
+/* set v[i] to counter i's count so far, or -1 if it is not there or
+ * never got to run */
+void perfctr_read(struct perfctr *pc, long long v[PC_COUNT])
+{
+    unsigned long long r[3];    /* count, time enabled, time running */
+    int i;
+
+    for (i = 0; i < PC_COUNT; i++) {
+        v[i] = -1;
+        if (pc->fd[i] < 0 || read(pc->fd[i], r, sizeof(r)) != sizeof(r))
+            continue;
+        if (r[2] == 0)
+            v[i] = r[1] == 0 ? 0 : -1;
+        else if (r[2] < r[1])
+            v[i] = (long long)((double)r[0] * r[1] / r[2]);
+        else
+            v[i] = r[0];
+    }
+}
+
+void perfctr_close(struct perfctr *pc)
+{
+    int i;
+
+    for (i = 0; i < PC_COUNT; i++)
+        if (pc->fd[i] >= 0) {
+            close(pc->fd[i]);
+            pc->fd[i] = -1;
+        }
+}
@@ -0,0 +1,38 @@
+/* hardware event counters through Linux's perf_event_open.
+ *
+ * Time says how long something took; the counters say why: how many
+ * cycles it ran for, how many instructions it got through in them, and
+ * how often it missed the cache or mispredicted a branch. Only user
+ * space is counted, which is what an unprivileged process is allowed
+ * to see.
+ *
+ * A counter the kernel or the machine does not offer (in a container,
+ * in a VM, or where perf_event_paranoid forbids it) is left out, and
+ * reads as -1; everything else works without it.
+ */
+#ifndef PERFCTR_H
+#define PERFCTR_H
+
+#include <sys/types.h>
+
+enum {
+    PC_CYCLES,
+    PC_INSTRUCTIONS,
+    PC_CACHE_MISSES,
+    PC_BRANCH_MISSES,
+    PC_COUNT
+};
+
+struct perfctr {
+    int fd[PC_COUNT];       /* -1 for a counter that could not be opened */
+};
+
+extern const char *const perfctr_names[PC_COUNT];
+
+int perfctr_open(struct perfctr *pc, pid_t pid, int on_exec);
+void perfctr_start(struct perfctr *pc);
+void perfctr_stop(struct perfctr *pc);
+void perfctr_read(struct perfctr *pc, long long v[PC_COUNT]);
+void perfctr_close(struct perfctr *pc);
+
+#endif
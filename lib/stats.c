@@ -0,0 +1,137 @@
+#define _GNU_SOURCE 1
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "benchutil.h"
+#include "stats.h"
+
+static int reporting = 0;
+
+#if defined(STATS)
+extern struct stats_entry __stop_stats_entries[] __attribute__((weak));
+
+__thread struct stats_local stats_local[STATS_MAXENTRIES];
+
+/* the clock and the time at the start, to turn timer ticks into
+ * seconds: the TSC's rate is found by comparing it with the time */
+static uint64_t start_ticks;
+static double start_time;
+
+#if !defined(__x86_64__) && !defined(__i386__)
+uint64_t stats_clock(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+#endif
+
+/* every entry must have a place in stats_local before anything updates
+ * one, so this is checked before main, not when reporting */
+__attribute__((constructor))
+static void stats_start(void)
+{
+    if (__stop_stats_entries - __start_stats_entries > STATS_MAXENTRIES) {
+        fprintf(stderr, "stats: more than %d entries\n", STATS_MAXENTRIES);
+        exit(1);
+    }
+    start_ticks = stats_clock();
+    start_time = now();
+}
+
+/* add this thread's values into the totals and start its copies again
+ * from zero; atomic, so threads can flush at the same time */
+void stats_flush(void)
+{
+    struct stats_entry *e;
+    struct stats_local *l;
+    uint64_t old;
+
+    for (e = __start_stats_entries; e < __stop_stats_entries; e++) {
+        l = &stats_local[e - __start_stats_entries];
+        if (e->kind == STATS_KIND_MAXIMUM) {
+            old = __atomic_load_n(&e->value, __ATOMIC_RELAXED);
+            while (l->value > old
+                   && !__atomic_compare_exchange_n(&e->value, &old, l->value, 1,
+                                                   __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+                ;
+        } else {
+            __atomic_fetch_add(&e->value, l->value, __ATOMIC_RELAXED);
+            __atomic_fetch_add(&e->count, l->count, __ATOMIC_RELAXED);
+        }
+        l->value = l->count = 0;
+    }
+}
+
+/* write the entries of one kind as the JSON object called title */
+static void report_kind(const char *title, int kind, double seconds_per_tick)
+{
+    struct stats_entry *e;
+    const char *sep = "";
+
+    fprintf(stderr, ", \"%s\": {", title);
+    for (e = __start_stats_entries; e < __stop_stats_entries; e++) {
+        if (e->kind != kind)
+            continue;
+        fprintf(stderr, "%s\"%s\": ", sep, e->name);
+        if (kind == STATS_KIND_TIMER)
+            fprintf(stderr, "{\"calls\": %llu, \"ticks\": %llu, \"seconds\": %.9g}",
+                    (unsigned long long)e->count, (unsigned long long)e->value,
+                    e->value * seconds_per_tick);
+        else
+            fprintf(stderr, "%llu", (unsigned long long)e->value);
+        sep = ", ";
+    }
+    fprintf(stderr, "}");
+}
+
+/* write every value to standard error as one line of JSON */
+void stats_report(void)
+{
+    double seconds = now() - start_time;
+    uint64_t ticks = stats_clock() - start_ticks;
+    double per_tick = ticks > 0 ? seconds / ticks : 0;
+
+    stats_flush();
+    fprintf(stderr, "{\"enabled\": true, \"seconds\": %.6f, \"ticks_per_second\": %.6g",
+            seconds, per_tick > 0 ? 1 / per_tick : 0);
+    report_kind("counters", STATS_KIND_COUNTER, per_tick);
+    report_kind("maxima", STATS_KIND_MAXIMUM, per_tick);
+    report_kind("timers", STATS_KIND_TIMER, per_tick);
+    fprintf(stderr, "}\n");
+}
+#else
+void stats_flush(void)
+{
+}
+
+void stats_report(void)
+{
+    fprintf(stderr, "{\"enabled\": false}\n");
+}
+#endif
+
+static void report_at_exit(void)
+{
+    stats_report();
+}
+
+/* if --stats is among the arguments, take it out and report at exit;
+ * return 1 if it was there */
+int stats_option(int *argc, char *argv[])
+{
+    int i, j;
+
+    for (i = j = 1; i < *argc; i++)
+        if (strcmp(argv[i], "--stats") == 0)
+            reporting = 1;
+        else
+            argv[j++] = argv[i];
+    argv[j] = NULL;
+    *argc = j;
+    if (reporting)
+        atexit(report_at_exit);
+    return reporting;
+}
@@ -0,0 +1,122 @@
+/* counters and timers for the hot paths, compiled in only on request.
+ *
+ * Built with -DSTATS (make STATS=1), a file declares what it keeps:
+ *
+ *     STATS_COUNTER(getline_bytes);     a running total
+ *     STATS_MAXIMUM(stack_depth);       the largest value seen
+ *     STATS_TIMER(ins_read);            calls and time spent
+ *
+ * and updates them where things happen:
+ *
+ *     STATS_ADD(getline_bytes, n);
+ *     STATS_MAX(stack_depth, sp);
+ *     STATS_SCOPE(ins_read);            at the top of a block: times
+ *                                       the rest of it, however it ends
+ *
+ * Without -DSTATS every one of these is nothing at all, not even a
+ * function call, so the normal build costs nothing.
+ *
+ * An update touches only the calling thread's own copy of the value,
+ * so it needs no lock or atomic instruction. Each thread adds its copies
+ * into the shared totals with stats_flush once it is done; run_parallel
+ * does this for its threads, and the report does it for the main one.
+ * Timers read the CPU's time-stamp counter twice a call, which is
+ * cheaper than clock_gettime but still some nanoseconds each time
+ * (about 18 in a VM here), so time whole calls, not single bytes, and
+ * not a call made once a line either: a short line takes no longer than
+ * the timer itself, which would double the time of a tool like grep.
+ * Count those calls instead, and time what is done once a buffer.
+ *
+ * A tool calls stats_option(&argc, argv) first thing in main: if the
+ * arguments include --stats, it takes it out and arranges for the
+ * values to be written to standard error as JSON when the program
+ * exits. Without -DSTATS, --stats reports that there is nothing to say.
+ */
+#ifndef STATS_H
+#define STATS_H
+
+#include <stdint.h>
+
+int stats_option(int *argc, char *argv[]);
+void stats_flush(void);
+void stats_report(void);
+
+#if defined(STATS)
+
+#if defined(__x86_64__) || defined(__i386__)
+/* the builtin rather than x86intrin.h's __rdtsc, whose header brings in
+ * stdlib.h, and with it an atof that calculator.c declares its own way */
+#define stats_clock() __builtin_ia32_rdtsc()
+#else
+uint64_t stats_clock(void);     /* nanoseconds, where there is no TSC */
+#endif
+
+enum { STATS_KIND_COUNTER, STATS_KIND_MAXIMUM, STATS_KIND_TIMER };
+
+#define STATS_MAXENTRIES 256
+
+/* a declared value and its total over the threads that have flushed.
+ * The entries of all the files are put together by the linker into the
+ * section stats_entries, so they can be found without registering them;
+ * the aligned size keeps them evenly spaced there, like an array. */
+struct stats_entry {
+    const char *name;
+    int kind;
+    uint64_t value;         /* total, maximum, or timer cycles */
+    uint64_t count;         /* timer calls */
+} __attribute__((aligned(32)));
+
+/* each thread's copies, indexed by the entry's place in the section */
+struct stats_local {
+    uint64_t value;
+    uint64_t count;
+};
+
+extern struct stats_entry __start_stats_entries[] __attribute__((weak));
+extern __thread struct stats_local stats_local[STATS_MAXENTRIES];
+
+#define STATS_ENTRY(name, kind)                                               \
+    static struct stats_entry stats_##name                                    \
+        __attribute__((section("stats_entries"), used)) = { #name, kind, 0, 0 }
+#define STATS_COUNTER(name) STATS_ENTRY(name, STATS_KIND_COUNTER)
+#define STATS_MAXIMUM(name) STATS_ENTRY(name, STATS_KIND_MAXIMUM)
+#define STATS_TIMER(name) STATS_ENTRY(name, STATS_KIND_TIMER)
+
+#define STATS_SLOT(name) (stats_local[&stats_##name - __start_stats_entries])
+
+#define STATS_ADD(name, n) ((void)(STATS_SLOT(name).value += (n)))
+#define STATS_MAX(name, v)                                                    \
+    do {                                                                      \
+        uint64_t stats_v_ = (v);                                              \
+        if (stats_v_ > STATS_SLOT(name).value)                                \
+            STATS_SLOT(name).value = stats_v_;                                \
+    } while (0)
+
+/* the cleanup attribute calls stats_stop when the block is left */
+struct stats_scope {
+    struct stats_local *slot;
+    uint64_t start;
+};
+
+static inline void stats_stop(struct stats_scope *s)
+{
+    s->slot->value += stats_clock() - s->start;
+    s->slot->count++;
+}
+
+#define STATS_SCOPE(name)                                                     \
+    struct stats_scope stats_scope_##name __attribute__((cleanup(stats_stop))) \
+        = { &STATS_SLOT(name), stats_clock() }
+
+#else
+
+#define STATS_COUNTER(name) struct stats_unused_##name
+#define STATS_MAXIMUM(name) struct stats_unused_##name
+#define STATS_TIMER(name) struct stats_unused_##name
+#define STATS_ADD(name, n) ((void)0)
+#define STATS_MAX(name, v) ((void)0)
+#define STATS_SCOPE(name) struct stats_unused_##name
+
+#endif
+
+#endif
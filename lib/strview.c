@@ -0,0 +1,100 @@
+#include <string.h>
+#include "strview.h"
+#include "stats.h"
+
+STATS_COUNTER(sv_find_calls);
+STATS_COUNTER(sv_find_candidates);     /* places the first character matched */
+
+/* make a view of the len characters at ptr */
+struct strview sv_make(const char *ptr, size_t len)
+{
+    struct strview v;
+
+    v.ptr = ptr;
+    v.len = len;
+    return v;
+}
+
+/* make a view of the C string s; this is the only place we call strlen */
+struct strview sv_fromstr(const char *s)
+{
+    return sv_make(s, strlen(s));
+}
+
+/* return the characters [start, end) of v
+ * Out-of-range positions are clamped to the end of v,
+ * so slicing never reaches outside the original view.
+ */
+struct strview sv_slice(struct strview v, size_t start, size_t end)
+{
+    if (end > v.len)
+        end = v.len;
+    if (start > end)
+        start = end;
+    return sv_make(v.ptr + start, end - start);
+}
+
+/* return index of the first c in v, -1 if none */
+long sv_findchr(struct strview v, int c)
+{
+    const char *p = memchr(v.ptr, c, v.len);
+
+    return p != NULL ? p - v.ptr : -1;
+}
+
+/* return index of pat in v, -1 if none
+ * memchr jumps to each place the first character of pat occurs,
+ * and only there do we compare the rest.
+ */
+long sv_find(struct strview v, struct strview pat)
+{
+    const char *p, *last;
+
+    STATS_ADD(sv_find_calls, 1);
+    if (pat.len == 0)
+        return 0;
+    if (pat.len > v.len)
+        return -1;
+    last = v.ptr + (v.len - pat.len);
+    for (p = v.ptr; p <= last; p++) {
+        p = memchr(p, pat.ptr[0], last - p + 1);
+        if (p == NULL)
+            break;
+        STATS_ADD(sv_find_candidates, 1);
+        if (memcmp(p + 1, pat.ptr + 1, pat.len - 1) == 0)
+            return p - v.ptr;
+    }
+    return -1;
+}
+
+/* return <0 if a<b, 0 if a==b, >0 if a>b, like strcmp;
+ * a view that is a prefix of the other sorts first */
+int sv_cmp(struct strview a, struct strview b)
+{
+    int cmp = memcmp(a.ptr, b.ptr, a.len < b.len ? a.len : b.len);
+
+    if (cmp != 0)
+        return cmp;
+    return (a.len > b.len) - (a.len < b.len);
+}
+
+/* return 1 if a and b hold the same characters, 0 if not */
+int sv_eq(struct strview a, struct strview b)
+{
+    return a.len == b.len && memcmp(a.ptr, b.ptr, a.len) == 0;
+}
+
+/* copy v into dst as a C string, never writing more than size bytes;
+ * return the number of characters copied, which is less than v.len
+ * if dst was too small */
+size_t sv_copy(char *dst, size_t size, struct strview v)
+{
+    size_t n;
+
+    if (size == 0)
+        return 0;
+    n = v.len < size - 1 ? v.len : size - 1;
+    memcpy(dst, v.ptr, n);
+    dst[n] = '\0';
+    return n;
+}
@@ -0,0 +1,33 @@
+/* a string view: a pointer to some characters and how many there are.
+ *
+ * A C string only knows where it ends by its '\0', so every strlen,
+ * strcat or strstr has to walk the whole string again to find it.
+ * A view carries its length with it, which lets the loops below run
+ * a known number of times (and lets the compiler vectorize them),
+ * and lets a view point into the middle of a larger buffer
+ * without copying or terminating anything.
+ *
+ * Views are two words, so they are passed and returned by value,
+ * just like struct point in c-structs. A view never owns its characters:
+ * they must outlive it, and they need not end with '\0'.
+ */
+#ifndef STRVIEW_H
+#define STRVIEW_H
+
+#include <stddef.h>
+
+struct strview {
+    const char *ptr;    /* first character */
+    size_t len;         /* number of characters */
+};
+
+struct strview sv_make(const char *ptr, size_t len);
+struct strview sv_fromstr(const char *s);
+struct strview sv_slice(struct strview v, size_t start, size_t end);
+long sv_findchr(struct strview v, int c);
+long sv_find(struct strview v, struct strview pat);
+int sv_cmp(struct strview a, struct strview b);
+int sv_eq(struct strview a, struct strview b);
+size_t sv_copy(char *dst, size_t size, struct strview v);
+
+#endif
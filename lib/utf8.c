@@ -0,0 +1,334 @@
+#include <string.h>
+#include "utf8.h"
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+static int iscont(unsigned char c)
+{
+    return (c & 0xC0) == 0x80;
+}
+
+/* how many bytes the character starting with c claims to have */
+static size_t seqlen(unsigned char c)
+{
+    if (c < 0xC0)
+        return 1;
+    if (c < 0xE0)
+        return 2;
+    if (c < 0xF0)
+        return 3;
+    return 4;
+}
+
+/* validate a byte at a time; the fallback, and the reference
+ * the vector version must agree with */
+static int valid_bytes(const unsigned char *p, size_t n)
+{
+    size_t i, len, k;
+    unsigned char lo, hi;
+
+    for (i = 0; i < n; i += len) {
+        if (p[i] < 0x80) {
+            len = 1;
+            continue;
+        }
+        len = seqlen(p[i]);
+        if (p[i] < 0xC2 || p[i] > 0xF4 || n - i < len)
+            return 0;
+        /* the second byte's range is what rules out overlong spellings,
+         * surrogates and values past U+10FFFF */
+        lo = 0x80;
+        hi = 0xBF;
+        if (p[i] == 0xE0)
+            lo = 0xA0;
+        else if (p[i] == 0xED)
+            hi = 0x9F;
+        else if (p[i] == 0xF0)
+            lo = 0x90;
+        else if (p[i] == 0xF4)
+            hi = 0x8F;
+        if (p[i + 1] < lo || p[i + 1] > hi)
+            return 0;
+        for (k = 2; k < len; k++)
+            if (!iscont(p[i + k]))
+                return 0;
+    }
+    return 1;
+}
+
+/* count the non-continuation bytes one at a time */
+static size_t count_bytes(const unsigned char *p, size_t n)
+{
+    size_t i, count = 0;
+
+    for (i = 0; i < n; i++)
+        count += !iscont(p[i]);
+    return count;
+}
+
+#if defined(__x86_64__)
+
+/* The error bits of the lookup tables: each names one way the
+ * (first byte, second byte) pair at some position can be wrong.
+ * A pair is bad when all three tables agree on some bit.
+ */
+#define TOO_SHORT   (1 << 0)    /* lead byte not followed by a continuation */
+#define TOO_LONG    (1 << 1)    /* ASCII followed by a continuation */
+#define OVERLONG_3  (1 << 2)    /* E0 80..9F */
+#define TOO_LARGE   (1 << 3)    /* F4 90..BF, or F5..FF */
+#define SURROGATE   (1 << 4)    /* ED A0..BF */
+#define OVERLONG_2  (1 << 5)    /* C0..C1 */
+#define TOO_LARGE_1000 (1 << 6) /* F5..FF 80..8F */
+#define OVERLONG_4  (1 << 6)    /* F0 80..8F */
+#define TWO_CONTS   (1 << 7)    /* continuation after continuation */
+#define CARRY (TOO_SHORT | TOO_LONG | TWO_CONTS)
+
+/* a 16-entry table, repeated in both halves of a register
+ * because vpshufb looks up each 128-bit half separately */
+#define TABLE16(a, b, c, d, e, f, g, h, i, j, k, l, m, n, o, p) \
+    _mm256_setr_epi8(B(a), B(b), B(c), B(d), B(e), B(f), B(g), B(h), \
+                     B(i), B(j), B(k), B(l), B(m), B(n), B(o), B(p), \
+                     B(a), B(b), B(c), B(d), B(e), B(f), B(g), B(h), \
+                     B(i), B(j), B(k), B(l), B(m), B(n), B(o), B(p))
+#define B(x) ((char)(unsigned char)(x))
+
+/* the 32 bytes ending n bytes before the end of in, where prev is
+ * the block before in: the bytes that came n positions earlier */
+#define PREV(in, prev, n) \
+    _mm256_alignr_epi8(in, _mm256_permute2x128_si256(prev, in, 0x21), 16 - (n))
+
+struct utf8_check {
+    __m256i prev;           /* the previous block */
+    __m256i error;          /* non-zero once anything was wrong */
+    __m256i incomplete;     /* previous block ended inside a character */
+};
+
+__attribute__((target("avx2")))
+static __m256i high_nibbles(__m256i v)
+{
+    return _mm256_and_si256(_mm256_srli_epi16(v, 4), _mm256_set1_epi8(0x0F));
+}
+
+/* the error bits for each (previous byte, byte) pair of in */
+__attribute__((target("avx2")))
+static __m256i special_cases(__m256i in, __m256i prev1)
+{
+    const __m256i byte_1_high = TABLE16(
+        /* 0xxx: ASCII */
+        TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+        TOO_LONG, TOO_LONG, TOO_LONG, TOO_LONG,
+        /* 10xx: continuation */
+        TWO_CONTS, TWO_CONTS, TWO_CONTS, TWO_CONTS,
+        /* 1100, 1101: two-byte lead */
+        TOO_SHORT | OVERLONG_2,
+        TOO_SHORT,
+        /* 1110: three-byte lead */
+        TOO_SHORT | OVERLONG_3 | SURROGATE,
+        /* 1111: four-byte lead */
+        TOO_SHORT | TOO_LARGE | TOO_LARGE_1000 | OVERLONG_4);
+    const __m256i byte_1_low = TABLE16(
+        CARRY | OVERLONG_3 | OVERLONG_2 | OVERLONG_4,
+        CARRY | OVERLONG_2,
+        CARRY,
+        CARRY,
+        CARRY | TOO_LARGE,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000 | SURROGATE,
+        CARRY | TOO_LARGE | TOO_LARGE_1000,
+        CARRY | TOO_LARGE | TOO_LARGE_1000);
+    const __m256i byte_2_high = TABLE16(
+        /* 0xxx: ASCII */
+        TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+        TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT,
+        /* 1000, 1001, 101x: continuation */
+        TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE_1000 | OVERLONG_4,
+        TOO_LONG | OVERLONG_2 | TWO_CONTS | OVERLONG_3 | TOO_LARGE,
+        TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+        TOO_LONG | OVERLONG_2 | TWO_CONTS | SURROGATE | TOO_LARGE,
+        /* 11xx: lead */
+        TOO_SHORT, TOO_SHORT, TOO_SHORT, TOO_SHORT);
+
+    return _mm256_and_si256(_mm256_and_si256(
+        _mm256_shuffle_epi8(byte_1_high, high_nibbles(prev1)),
+        _mm256_shuffle_epi8(byte_1_low,
+                            _mm256_and_si256(prev1, _mm256_set1_epi8(0x0F)))),
+        _mm256_shuffle_epi8(byte_2_high, high_nibbles(in)));
+}
+
+/* check one block of 32 bytes, carrying state into the next */
+__attribute__((target("avx2")))
+static void check_block(struct utf8_check *c, __m256i in)
+{
+    const __m256i max = _mm256_setr_epi8(
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+        (char)(0xF0 - 1), (char)(0xE0 - 1), (char)(0xC0 - 1));
+    __m256i prev1, prev2, prev3, third, fourth, must23;
+
+    if (_mm256_movemask_epi8(in) == 0) {
+        /* all ASCII: fine, unless the last block left a character open */
+        c->error = _mm256_or_si256(c->error, c->incomplete);
+        c->prev = in;
+        return;
+    }
+    prev1 = PREV(in, c->prev, 1);
+    prev2 = PREV(in, c->prev, 2);
+    prev3 = PREV(in, c->prev, 3);
+    /* a byte two after a three- or four-byte lead, or three after a
+     * four-byte lead, must be a continuation; the subtraction leaves the
+     * high bit set exactly there */
+    third = _mm256_subs_epu8(prev2, _mm256_set1_epi8((char)(0xE0 - 0x80)));
+    fourth = _mm256_subs_epu8(prev3, _mm256_set1_epi8((char)(0xF0 - 0x80)));
+    must23 = _mm256_and_si256(_mm256_or_si256(third, fourth),
+                              _mm256_set1_epi8((char)0x80));
+    c->error = _mm256_or_si256(c->error,
+                               _mm256_xor_si256(must23, special_cases(in, prev1)));
+    /* a lead byte too close to the end to finish its character */
+    c->incomplete = _mm256_subs_epu8(in, max);
+    c->prev = in;
+}
+
+__attribute__((target("avx2")))
+static int valid_avx2(const unsigned char *p, size_t n)
+{
+    struct utf8_check c;
+    unsigned char last[32];
+    size_t i;
+
+    c.prev = c.error = c.incomplete = _mm256_setzero_si256();
+    for (i = 0; i + 32 <= n; i += 32)
+        check_block(&c, _mm256_loadu_si256((const __m256i *)(p + i)));
+    /* pad the rest with ASCII zeros, which cannot hide an error */
+    memset(last, 0, sizeof(last));
+    memcpy(last, p + i, n - i);
+    check_block(&c, _mm256_loadu_si256((const __m256i *)last));
+    c.error = _mm256_or_si256(c.error, c.incomplete);
+    return _mm256_testz_si256(c.error, c.error);
+}
+
+/* a continuation byte is -65 or less as a signed char */
+__attribute__((target("avx2,popcnt")))
+static size_t count_avx2(const unsigned char *p, size_t n)
+{
+    const __m256i limit = _mm256_set1_epi8(-65);
+    __m256i v;
+    size_t i, count = 0;
+
+    for (i = 0; i + 32 <= n; i += 32) {
+        v = _mm256_loadu_si256((const __m256i *)(p + i));
+        count += __builtin_popcount(_mm256_movemask_epi8(_mm256_cmpgt_epi8(v, limit)));
+    }
+    return count + count_bytes(p + i, n - i);
+}
+
+static int use_avx2(void)
+{
+    return __builtin_cpu_supports("avx2");
+}
+
+#else
+
+static int use_avx2(void)
+{
+    return 0;
+}
+
+#define valid_avx2 valid_bytes
+#define count_avx2 count_bytes
+
+#endif
+
+/* return 1 if the n bytes at p are valid UTF-8, 0 if not */
+int utf8_valid(const unsigned char *p, size_t n)
+{
+    return use_avx2() ? valid_avx2(p, n) : valid_bytes(p, n);
+}
+
+/* return the number of characters in the n bytes at p,
+ * assuming they are valid UTF-8 */
+size_t utf8_count(const unsigned char *p, size_t n)
+{
+    return use_avx2() ? count_avx2(p, n) : count_bytes(p, n);
+}
+
+/* return a place at or up to 3 bytes before pos where the n bytes at p
+ * can be cut in two without splitting a character. Cutting valid UTF-8
+ * there gives two valid halves, so the halves can be checked apart.
+ */
+size_t utf8_boundary(const unsigned char *p, size_t n, size_t pos)
+{
+    size_t m;
+
+    for (m = pos; m < n && m + 3 > pos && m > 0 && iscont(p[m]); m--)
+        ;
+    return m < n && iscont(p[m]) ? pos : m;
+}
+
+void utf8_stream_init(struct utf8_stream *s)
+{
+    s->npending = 0;
+    s->valid = 1;
+}
+
+/* validate the next n bytes of the stream */
+void utf8_stream_feed(struct utf8_stream *s, const unsigned char *p, size_t n)
+{
+    size_t head, end;
+
+    head = utf8_stream_head(s, p, n);
+    end = head + utf8_stream_tail(s, p + head, n - head);
+    s->valid &= utf8_valid(p + head, end - head);
+}
+
+/* the first half of utf8_stream_feed, for callers that check the middle
+ * of a piece themselves (in parallel, say): finish the character the
+ * last piece cut off with the first bytes of this piece, and return
+ * how many bytes that took */
+size_t utf8_stream_head(struct utf8_stream *s, const unsigned char *p, size_t n)
+{
+    size_t want;
+
+    if (s->npending == 0)
+        return 0;
+    want = seqlen(s->pending[0]) - s->npending;
+    if (want > n)
+        want = n;
+    memcpy(s->pending + s->npending, p, want);
+    s->npending += want;
+    if ((size_t)s->npending == seqlen(s->pending[0])) {
+        s->valid &= valid_bytes(s->pending, s->npending);
+        s->npending = 0;
+    }
+    return want;
+}
+
+/* the second half: hold back a character the n bytes at p start
+ * but do not finish, and return how many bytes are left to check */
+size_t utf8_stream_tail(struct utf8_stream *s, const unsigned char *p, size_t n)
+{
+    size_t cut;
+
+    if (n == 0)
+        return 0;
+    cut = utf8_boundary(p, n, n - 1);
+    if (seqlen(p[cut]) <= n - cut)
+        return n;
+    memcpy(s->pending + s->npending, p + cut, n - cut);
+    s->npending += n - cut;
+    return cut;
+}
+
+/* return 1 if the whole stream was valid UTF-8, 0 if not */
+int utf8_stream_finish(struct utf8_stream *s)
+{
+    return s->valid && s->npending == 0;
+}
@@ -0,0 +1,39 @@
+/* UTF-8 validation and code-point counting.
+ *
+ * UTF-8 spells each character (code point) with 1 to 4 bytes:
+ *   0xxxxxxx                             U+0000..U+007F (ASCII)
+ *   110xxxxx 10xxxxxx                    U+0080..U+07FF
+ *   1110xxxx 10xxxxxx 10xxxxxx           U+0800..U+FFFF
+ *   11110xxx 10xxxxxx 10xxxxxx 10xxxxxx  U+10000..U+10FFFF
+ * A byte that starts 10 is a continuation byte; every other byte starts
+ * a character, so counting characters is counting non-continuation bytes.
+ *
+ * Valid also rules out the spellings that are too long for their value
+ * (overlong), the UTF-16 surrogates U+D800..U+DFFF, and values past
+ * U+10FFFF. The AVX2 validator checks all of these 32 bytes at a time
+ * with three 16-entry lookup tables, following Keiser and Lemire,
+ * "Validating UTF-8 in less than one instruction per byte" (2021).
+ */
+#ifndef UTF8_H
+#define UTF8_H
+
+#include <stddef.h>
+
+/* validates a stream that arrives in pieces that may split a character */
+struct utf8_stream {
+    unsigned char pending[4];   /* start of a character cut off by a piece */
+    int npending;
+    int valid;                  /* 0 once anything invalid has been seen */
+};
+
+int utf8_valid(const unsigned char *p, size_t n);
+size_t utf8_count(const unsigned char *p, size_t n);
+size_t utf8_boundary(const unsigned char *p, size_t n, size_t pos);
+
+void utf8_stream_init(struct utf8_stream *s);
+void utf8_stream_feed(struct utf8_stream *s, const unsigned char *p, size_t n);
+size_t utf8_stream_head(struct utf8_stream *s, const unsigned char *p, size_t n);
+size_t utf8_stream_tail(struct utf8_stream *s, const unsigned char *p, size_t n);
+int utf8_stream_finish(struct utf8_stream *s);
+
+#endif